@@ -3,11 +3,16 @@
 #include <Arduino.h>
 
 #include "app/drive_controller.h"
+#include "app/latency_histogram.h"
 #include "app/navigation_controller.h"
 #include "app/led_controller.h"
 #include "app/robot_state.h"
 #include "app/sensor_suite.h"
 #include "drivers/i2s_audio.h"
+#include "net/state_schema.h"
+#include "net/control_commands.h"
+#include "net/link_monitor.h"
+#include "net/metrics.h"
 
 class BackendCoordinator
 {
@@ -17,12 +22,39 @@ public:
     void begin();
     void handle();
 
-    void registerTask(uint32_t nowMs);
     void stateTask(uint32_t nowMs);
     void eventTask(uint32_t nowMs);
     void pushState();
+    // Queues a backend event and pushes it to /events subscribers right away.
+    void raiseEvent(const char *name);
+
+    // LAN push: STATE frames when a subscriber is due one, plus sampling and
+    // batching of the high-rate telemetry channels.
+    void telemetryTask(uint32_t nowMs);
+
+    // Hands the HTTP server a snapshot for GET /status; it only re-serializes
+    // when something changed.
+    void httpStatusTask(uint32_t nowMs);
+
+    // Call after drive.update(): acks the last drive command once its duty
+    // reached the motors (or timed out) and records its latency.
+    void driveAckTask(uint32_t nowMs);
+
+    void captureState(StateSchema::Snapshot &out) const;
+
+    // Percentiles of the rolling latency windows, as gauges (a Metrics::Collector).
+    void writeLatencyMetrics(Metrics::Writer &w);
 
 private:
+    void handleDriveCommand(const ControlCommands::DriveCommand &cmd);
+    void handleStop(const char *source);
+    // LED_PATTERN frames and POST /led; false with `error` for an unknown pattern.
+    bool handleLedPattern(const ControlCommands::LedPatternCommand &cmd, String &error);
+    void sampleTelemetryChannels();
+    void finishDriveAck(uint32_t nowMs);
+    // Scales the state heartbeat and urgent-push gap to the link quality.
+    static void stateTiming(LinkMonitor::Quality quality, uint32_t &heartbeatMs, uint32_t &minGapMs);
+
     RobotState &state;
     DriveController &drive;
     SensorSuite &sensors;
@@ -30,13 +62,26 @@ private:
     LedController &leds;
     I2sAudio &audio;
 
-    uint32_t lastBackendRegisterMs;
     uint32_t lastBackendStateMs;
     uint32_t lastBackendEventMs;
 
     bool stateDirty;
     bool stateUrgent;
 
+    StateSchema::Snapshot currentState;
+    StateSchema::Snapshot lastQueuedState;
+    bool hasQueuedState;
+
     bool eventPending;
     String pendingEvent;
+
+    LatencyHistogram rxToDispatchLatency;
+    LatencyHistogram rxToApplyLatency;
+    StateSchema::Snapshot telemetryState;
+    ControlCommands::DriveAck pendingDriveAck;
+    uint32_t driveAckBaseApplyUs;
+    bool driveAckPending;
+    uint32_t lastHttpStatusMs;
+    bool httpStatusDirty;
+    StateSchema::Snapshot httpStatusState;
 };
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "net/metrics.h"
+
+// Boot split into named stages. Stages the robot needs to drive and to get
+// on the network run inline from setup(); slow peripheral bring-up is
+// deferred and advanced one stage per control loop pass, so it overlaps
+// WiFi association instead of delaying it. Stage durations and boot
+// milestones are exported on /metrics.
+class BootSequence
+{
+public:
+    using StageFn = bool (*)();
+
+    static constexpr uint8_t MAX_STAGES = 16;
+    static constexpr uint8_t MAX_MILESTONES = 4;
+
+    BootSequence();
+
+    bool run(const char *name, StageFn fn);
+    void defer(const char *name, StageFn fn);
+
+    // Runs the next deferred stage. Returns false once none are left.
+    bool step();
+
+    // Records millis() under `name` (static storage).
+    void milestone(const char *name);
+
+    void writeMetrics(Metrics::Writer &w) const;
+
+private:
+    struct Stage
+    {
+        const char *name;
+        StageFn fn;
+        uint32_t durationMs;
+        bool ran;
+        bool ok;
+    };
+
+    struct Milestone
+    {
+        const char *name;
+        uint32_t atMs;
+    };
+
+    bool execute(Stage &stage);
+
+    Stage stages[MAX_STAGES];
+    uint8_t stageCount;
+    uint8_t nextStage;
+
+    Milestone milestones[MAX_MILESTONES];
+    uint8_t milestoneCount;
+};
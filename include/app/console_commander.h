@@ -20,6 +20,7 @@ public:
 
 private:
     void printBackendPing();
+    void printJsonPools();
 
     SerialConsole console;
     DriveController &drive;
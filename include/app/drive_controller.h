@@ -24,6 +24,21 @@ public:
 
     bool obstacleFrontActive() const;
 
+    // micros() of the last PWM write that changed the motor duty.
+    uint32_t lastApplyUs() const;
+
+    struct Telemetry
+    {
+        float leftDuty;
+        float rightDuty;
+        float targetThrottle;
+        float targetSteer;
+        float smoothedThrottle;
+        float smoothedSteer;
+    };
+
+    Telemetry telemetry() const;
+
 private:
     struct DriveConfig
     {
@@ -68,6 +83,7 @@ private:
     uint32_t lastDriveUpdateMs;
 
     uint32_t lastMotorApplyMs;
+    uint32_t lastMotorApplyUs;
     float lastAppliedLeft;
     float lastAppliedRight;
 
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Fixed-bucket latency histogram over a rolling window. Samples land in the
+// current window; reads merge it with the previous one, so the figures cover
+// the last one to two windows and old spikes age out on their own. The
+// counts drop on every rotation: export the percentiles as gauges, and keep
+// a Metrics::Histogram next to it for the cumulative distribution.
+class LatencyHistogram
+{
+public:
+    static constexpr uint8_t BUCKET_COUNT = 12; // last bucket is +Inf
+
+    struct Summary
+    {
+        uint32_t count;
+        uint32_t p50Us;
+        uint32_t p90Us;
+        uint32_t p99Us;
+        uint32_t maxUs;
+        uint64_t sumUs;
+    };
+
+    explicit LatencyHistogram(uint32_t windowMs);
+
+    void record(uint32_t us, uint32_t nowMs);
+
+    Summary summary(uint32_t nowMs);
+
+    static uint32_t bucketUpperUs(uint8_t index);
+
+private:
+    struct Window
+    {
+        uint32_t counts[BUCKET_COUNT];
+        uint32_t count;
+        uint32_t maxUs;
+        uint64_t sumUs;
+    };
+
+    void rotate(uint32_t nowMs);
+    void merged(Window &out) const;
+    static uint32_t percentile(const Window &w, float q);
+
+    Window windows[2];
+    uint8_t current;
+    uint32_t windowStartMs;
+    uint32_t windowMs;
+};
@@ -1,41 +1,159 @@
 #pragma once
 
 #include <Arduino.h>
-#include <Adafruit_NeoPixel.h>
-
+#include <atomic>
 #include "app/sensor_suite.h"
+#include "app/led_renderer.h"
+#include "drivers/ws2812_strip.h"
+
+// Status patterns, in the order automatic selection prefers them (the first
+// one whose condition holds is shown). Obstacle and LowBattery are safety
+// warnings and show even while the strip is disabled; the others, and
+// Solid (the plain light, the color from setColor()), only while it is
+// enabled. A pinned pattern shows regardless, except Solid.
+enum class LedPattern : uint8_t
+{
+    Obstacle,    // whole strip flashes
+    LowBattery,  // whole strip breathes
+    WsOffline,   // `width` pixels bounce end to end
+    Turn,        // `width` pixels sweep from the middle to the turn side
+    NavProgress, // bar over the completed share of the route, breathing head
+    Solid,
+    Count
+};
+
+// Per-pattern parameters; the renderer only does integer math on these.
+struct LedPatternParams
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t width;     // pixels, where the pattern has a moving part
+    uint16_t periodMs; // one flash/breath/sweep
+};
+
+// Robot state the status patterns follow, offered by the control task.
+struct LedStatus
+{
+    bool obstacle;
+    bool lowBattery;
+    bool wsOffline;
+    int8_t turn;         // -1 left, 1 right, 0 none
+    bool navActive;
+    uint8_t navProgress; // 0..255
+};
 
+// Owns the strip. Frames are rendered at AppConfig::LED_FRAME_HZ by a
+// low-priority task on the network core; the control task only edits a
+// small scene (settings, pattern parameters, status) that the render task
+// copies at the start of each frame, so animation costs the control loop
+// nothing. Patterns draw into an LedRenderer, which applies gamma,
+// brightness and dithering on the way to the strip. Unchanged frames are
+// never sent (see Ws2812Strip).
+//
+// Power limiter: the strip's current is estimated from the sum of the
+// levels it is sent, at a mA-per-level gain that powerTask() fits against
+// the INA226 while the motors are idle. A frame over the current budget is
+// scaled down before it goes out. The budget shrinks with motor load and
+// with whatever the rest of the robot draws, so the strip only ever gets
+// the battery current the drive leaves over.
 class LedController
 {
 public:
     explicit LedController(SensorSuite &sensors);
 
-    void begin();
+    bool begin();
 
-    void autoTask();
+    // Auto brightness (AppConfig::LED_AUTO_*): on/off at the lux
+    // hysteresis, brightness from filtered lux in between.
+    void autoTask(uint32_t nowMs);
 
     void setAutoEnabled(bool enabled);
     void setEnabled(bool enabled);
     void setColor(uint8_t r, uint8_t g, uint8_t b);
     void setBrightness(uint8_t v);
 
+    // Pins one pattern regardless of status; Count returns to automatic
+    // selection.
+    void selectPattern(LedPattern pattern);
+    void setPatternParams(LedPattern pattern, const LedPatternParams &params);
+    LedPatternParams patternParams(LedPattern pattern) const;
+    void setStatus(const LedStatus &status);
+
+    // Control task, every loop pass (runs every AppConfig::LED_POWER_PERIOD_MS).
+    // motorLoad is the larger motor duty magnitude, 0..1.
+    void powerTask(uint32_t nowMs, float motorLoad);
+
     bool isEnabled() const;
     bool isAutoEnabled() const;
-    uint8_t brightness() const;
+    uint8_t brightness() const; // perceptual, see LedRenderer
 
+    // Hands the current settings to the render task.
     void apply();
 
+    uint32_t framesSent() const;
+    uint32_t framesSkipped() const;
+
+    static const char *patternName(LedPattern pattern);
+    // Accepts the names above and "AUTO" (-> Count); false if unknown.
+    static bool patternFromName(const char *name, LedPattern &out);
+
 private:
     static constexpr uint16_t LED_COUNT = 144;
+    static constexpr size_t PATTERN_COUNT = static_cast<size_t>(LedPattern::Count);
+
+    struct Scene
+    {
+        bool enabled;
+        uint8_t brightness;
+        LedPattern pinned; // Count = automatic
+        LedStatus status;
+        LedPatternParams params[PATTERN_COUNT];
+        uint32_t maxLevels; // power budget, in summed frame levels
+    };
+
+    // Least-squares fit of battery current against strip levels with
+    // exponential forgetting; only fed while the motors are idle.
+    struct PowerModel
+    {
+        float maPerLevel;
+        float meanLevels;
+        float meanMa;
+        float varLevels;
+        float covLevelsMa;
+    };
+
+    static void renderTask(void *arg);
+    void renderLoop();
+    void render(const Scene &scene, uint32_t nowMs);
+    LedPattern activePattern(const Scene &scene) const;
+    void calibrate(float levels, float measuredMa);
+    // False while a sample is held back as an outlier.
+    bool filterLux(float lux);
+    uint8_t autoBrightness() const;
 
     SensorSuite &sensors;
-    Adafruit_NeoPixel ledStrip;
+    Ws2812Strip ledStrip;
+    LedRenderer renderer; // render task only
 
-    bool ledEnabled;
     bool ledAutoEnabled;
+    uint32_t lastAutoMs;
+    float luxLog; // filtered log(1 + lux)
+    bool luxReady;
+    uint8_t luxOutliers;
+
+    Scene scene;  // control task's copy
+    Scene shared; // under sceneMux
+    portMUX_TYPE sceneMux;
+    TaskHandle_t renderHandle;
+    TaskHandle_t beginCaller; // waits in begin() for the strip to start
+
+    // Render task -> powerTask(): running totals, read as differences.
+    std::atomic<uint32_t> levelsSent;
+    std::atomic<uint32_t> framesRendered;
 
-    uint8_t ledBrightness;
-    uint8_t ledR;
-    uint8_t ledG;
-    uint8_t ledB;
+    PowerModel power;
+    uint32_t lastPowerMs;
+    uint32_t lastLevelsSent;
+    uint32_t lastFramesRendered;
 };
@@ -0,0 +1,40 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Last stage before the strip. Patterns draw full-scale colors into the
+// canvas; render() maps every subpixel through one 256-entry table (gamma
+// curve times brightness, 8.8 fixed point). In pixels whose subpixels are
+// all below level 16, where one step is visible, the fraction is kept for
+// the next frame and levels between two steps are dithered over time, so
+// dim colors and slow fades near black don't step or flicker. Brighter
+// pixels are rounded: a static scene there renders identical frames, which
+// the strip doesn't resend.
+//
+// No Arduino dependencies: tools/led_bench builds it on the host.
+class LedRenderer
+{
+public:
+    explicit LedRenderer(uint16_t ledCount);
+    ~LedRenderer();
+
+    // Canvas edits; colors are perceptual 0..255.
+    void setPixel(uint16_t i, uint8_t r, uint8_t g, uint8_t b);
+    void fill(uint8_t r, uint8_t g, uint8_t b);
+    void clear();
+
+    // Perceptual 0..255, on the same gamma curve as the colors. Rebuilds
+    // the table only when the value changes.
+    void setBrightness(uint8_t v);
+
+    // Writes ledCount * 3 bytes in wire order (GRB) to out and returns
+    // their sum, which is what the strip's current follows.
+    uint32_t render(uint8_t *out);
+
+private:
+    uint16_t ledCount;
+    uint8_t *canvas;  // GRB, so render() is one pass over the bytes
+    uint8_t *residue; // fraction carried per subpixel
+    uint8_t brightnessLevel;
+    uint16_t levels[256];
+};
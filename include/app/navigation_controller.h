@@ -40,6 +40,11 @@ public:
 
     bool requestNavigation(const String &startNodeId, const String &targetNodeId, String *errorMessage = nullptr);
     void cancel(const char *navigationStatus = "IDLE", bool clearTargetNode = true);
+    bool isActive() const;
+    // Share of the planned steps completed, 0..255; 0 when idle.
+    uint8_t progress() const;
+    // -1 turning left, 1 turning right, 0 otherwise.
+    int8_t turnDirection() const;
 
     void setStateChangedCallback(StateChangedCallback callback);
 
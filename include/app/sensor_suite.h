@@ -11,6 +11,13 @@
 class SensorSuite
 {
 public:
+    struct I2cErrors
+    {
+        uint32_t lux;
+        uint32_t power;
+        uint32_t imu;
+    };
+
     SensorSuite();
 
     void beginIr();
@@ -34,6 +41,10 @@ public:
     void setPowerPeriodic(bool on);
     void setRfidWatch(bool on);
 
+    // Shortens the IMU / power monitor sample periods while a telemetry
+    // stream needs them; both fall back to the default periods when off.
+    void setFastSampling(bool imu, bool power);
+
     bool frontObstacleNow() const;
     bool isIrLeftObstacle() const;
     bool isIrMidObstacle() const;
@@ -57,6 +68,8 @@ public:
     uint8_t rfidVersion() const;
     const RfidRc522Sensor::Reading &rfid() const;
 
+    I2cErrors i2cErrors() const;
+
 private:
     ObstacleSensor irLeft;
     ObstacleSensor irMid;
@@ -74,6 +87,9 @@ private:
     bool powerPeriodic;
     bool rfidWatch;
 
+    bool imuFast;
+    bool powerFast;
+
     uint32_t lastIrPrintMs;
     uint32_t lastLuxPrintMs;
     uint32_t lastImuPrintMs;
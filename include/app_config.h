@@ -7,6 +7,15 @@ namespace AppConfig
 
     constexpr uint32_t HEARTBEAT_PERIOD_MS = 500;
     constexpr uint32_t STATUS_PRINT_PERIOD_MS = 1000;
+    // Full 0x01..0x7E bus scan during boot; the sensor stages probe their
+    // own addresses either way.
+    constexpr bool BOOT_I2C_SCAN = false;
+
+    // WiFi station (net/wifi_manager.h): per-attempt timeout and the retry
+    // backoff range; the delay doubles per failed attempt.
+    constexpr uint32_t WIFI_CONNECT_TIMEOUT_MS = 15000;
+    constexpr uint32_t WIFI_BACKOFF_MIN_MS = 500;
+    constexpr uint32_t WIFI_BACKOFF_MAX_MS = 30000;
 
     // WebSocket/Backend tuning
     constexpr bool WS_LOG_RX = false;
@@ -14,6 +23,97 @@ namespace AppConfig
     constexpr uint32_t BACKEND_STATE_MIN_GAP_MS = 200;
     constexpr uint32_t BACKEND_EVENT_MIN_GAP_MS = 200;
 
+    // Backend circuit breaker (net/backend_client.h): consecutive failed
+    // POSTs that open it and the pause before the probe, which doubles per
+    // failed probe up to the max.
+    constexpr uint8_t BACKEND_BREAKER_FAILURES = 3;
+    constexpr uint32_t BACKEND_BREAKER_OPEN_MS = 5000;
+    constexpr uint32_t BACKEND_BREAKER_OPEN_MAX_MS = 60000;
+
+    // Scripted network faults under the backend HTTP and WS clients
+    // (net/fault_injection.h), started from the console. Bench builds only.
+    constexpr bool NET_FAULT_INJECTION = false;
+
+    // Link monitor (net/link_monitor.h): background ICMP probes to the
+    // backend and the window the RTT/loss figures are computed over.
+    constexpr uint32_t LINK_PING_INTERVAL_MS = 2000;
+    constexpr uint32_t LINK_PING_TIMEOUT_MS = 1000;
+    constexpr uint8_t LINK_WINDOW = 16;
+    constexpr bool UDP_TELEOP_ENABLED = false; // optional channel, see net/udp_teleop.h
+
+    // Fixed JSON memory per hot path (see net/json_pool.h)
+    constexpr size_t WS_JSON_POOL_BYTES = 3072;
+    constexpr size_t WS_JSON_OUT_BYTES = 512;
+    constexpr size_t BACKEND_JSON_POOL_BYTES = 4096;
+    constexpr size_t BACKEND_JSON_OUT_BYTES = 1024;
+    constexpr size_t HTTP_JSON_POOL_BYTES = 4096;
+    constexpr size_t HTTP_CONTROL_JSON_POOL_BYTES = 1024;
+    constexpr size_t HTTP_JSON_OUT_BYTES = 1536;
+    constexpr size_t HTTP_METRICS_OUT_BYTES = 4096; // one /metrics chunk; the largest single metric must fit
+    constexpr size_t ROBOT_WS_JSON_POOL_BYTES = 4096;
+    constexpr size_t ROBOT_WS_FRAME_BYTES = 1536;
+    constexpr size_t TELEMETRY_FRAME_BYTES = 1024;
+    constexpr uint8_t TELEMETRY_MAX_SUBSCRIBERS = 2;
+
+    // Robot HTTP server (net/robot_http_server.h): fixed connection table,
+    // per-connection request/response buffers, and how often the control
+    // loop offers a fresh /status snapshot. Long-polls and /events streams
+    // hold a connection each.
+    constexpr uint8_t HTTP_MAX_CONNECTIONS = 6;
+    constexpr size_t HTTP_RX_BYTES = 1024;
+    constexpr size_t HTTP_CONN_OUT_BYTES = 256;
+    constexpr uint32_t HTTP_KEEPALIVE_TIMEOUT_MS = 5000;
+    constexpr uint32_t HTTP_REQUEST_TIMEOUT_MS = 2000;
+    constexpr uint32_t HTTP_STATUS_REFRESH_MS = 100;
+    constexpr uint32_t HTTP_LONG_POLL_DEFAULT_MS = 20000;
+    constexpr uint32_t HTTP_LONG_POLL_MAX_MS = 55000;
+    constexpr uint32_t HTTP_EVENTS_PING_MS = 15000;
+
+    // On-robot WS server telemetry push (SUBSCRIBE periodMs is clamped to this range)
+    constexpr uint32_t ROBOT_WS_DEFAULT_PERIOD_MS = 200;
+    constexpr uint32_t ROBOT_WS_MIN_PERIOD_MS = 50;
+    constexpr uint32_t ROBOT_WS_MAX_PERIOD_MS = 10000;
+    // One LAN client drives at a time; it keeps the drive until it disconnects
+    // or sends no DRIVE_COMMAND for this long.
+    constexpr uint32_t ROBOT_WS_DRIVE_OWNER_IDLE_MS = 1000;
+
+    // Teleop latency: window of the rolling histograms, and how long a drive
+    // command may wait for a PWM change before it is acked as not applied.
+    constexpr uint32_t TELEOP_LATENCY_WINDOW_MS = 60000;
+    constexpr uint32_t DRIVE_ACK_TIMEOUT_MS = 100;
+
+    // LED strip (app/led_controller.h): render rate of the animation task,
+    // and the charge below which the low-battery pattern takes over.
+    constexpr uint32_t LED_FRAME_HZ = 100; // dithering needs the rate
+    constexpr int LED_LOW_BATTERY_PERCENT = 20;
+
+    // LED power limiter: strip current budget with the motors idle and at
+    // full duty (interpolated in between), the floor that keeps status
+    // patterns visible, and the battery current the strip must leave to
+    // everything else. The current per channel at full level is the
+    // starting point of the calibration against the INA226.
+    constexpr float LED_BUDGET_IDLE_MA = 1500.0f;
+    constexpr float LED_BUDGET_DRIVING_MA = 400.0f;
+    constexpr float LED_BUDGET_FLOOR_MA = 60.0f;
+    constexpr float BATTERY_CURRENT_LIMIT_MA = 5000.0f;
+    constexpr float LED_CHANNEL_FULL_MA = 15.0f;
+    constexpr uint32_t LED_POWER_PERIOD_MS = 250;
+
+    // LED auto brightness: lux is read at the BH1750's sample rate and
+    // smoothed by an EMA on log(lux); a sample more than the outlier ratio
+    // off the filter is dropped unless that many arrive in a row (then the
+    // filter jumps to it). Filtered lux between the dark point and
+    // BoardPins::LED_LUX_ON_THRESHOLD maps onto max..min brightness,
+    // quantized to the step so the scene only changes when the light does.
+    constexpr uint32_t LED_AUTO_PERIOD_MS = 250;
+    constexpr float LED_AUTO_EMA_ALPHA = 0.2f;
+    constexpr float LED_AUTO_OUTLIER_RATIO = 4.0f;
+    constexpr uint8_t LED_AUTO_OUTLIER_SAMPLES = 4;
+    constexpr float LED_AUTO_LUX_DARK = 2.0f;
+    constexpr uint8_t LED_AUTO_BRIGHTNESS_MAX = 200;
+    constexpr uint8_t LED_AUTO_BRIGHTNESS_MIN = 60;
+    constexpr uint8_t LED_AUTO_BRIGHTNESS_STEP = 4;
+
     constexpr uint32_t MOTOR_PWM_FREQ_HZ = 20000;
     constexpr uint8_t MOTOR_PWM_RES_BITS = 10; // 0..1023
 }
@@ -25,6 +25,8 @@ public:
 
     bool hasReading() const;
     float lux() const;
+    // Failed I2C reads since boot.
+    uint32_t errorCount() const;
 
 private:
     Config cfg_;
@@ -33,6 +35,7 @@ private:
     uint32_t last_sample_ms_ = 0;
     bool has_reading_ = false;
     float lux_ = 0.0f;
+    uint32_t i2c_errors_ = 0;
 
     bool startContinuousHighRes_();
     bool readLux_();
@@ -1,6 +1,12 @@
 #pragma once
 #include <Arduino.h>
+#include <atomic>
 
+// Tone output on I2S_NUM_0. A task owns the I2S driver and plays requests
+// from a queue, so playBeep() returns at once whatever the duration; the
+// caller's loop never waits on the DMA. A preempting request (the default)
+// drops whatever is queued and cuts the current sound within one chunk
+// (~12 ms at 22.05 kHz); stop() does the same without a new sound.
 class I2sAudio
 {
 public:
@@ -12,16 +18,45 @@ public:
         uint32_t sample_rate_hz;
     };
 
+    enum class Mode : uint8_t
+    {
+        Preempt, // replace the current sound and anything queued
+        Queue,   // play after what is already queued
+    };
+
     explicit I2sAudio(const Config &cfg);
 
     bool begin();
     void setVolume(float v); // 0..1
     float volume() const;
 
-    void playBeep(uint16_t freq_hz, uint16_t duration_ms);
+    // Any task. False if audio is not running or the queue is full.
+    bool playBeep(uint16_t freq_hz, uint16_t duration_ms, Mode mode = Mode::Preempt);
+    void stop();
+    bool isPlaying() const;
+    // The playback task, null until begin() started it.
+    TaskHandle_t taskHandle() const;
 
 private:
+    struct Request
+    {
+        uint16_t freq_hz;
+        uint16_t duration_ms;
+        uint32_t generation; // stale once stop()/a preempting request moved on
+    };
+
+    static void task_(void *arg);
+    void run_();
+    // False if cancelled before the end.
+    bool synthesize_(const Request &req);
+    bool cancelled_(const Request &req) const;
+
     Config cfg_;
-    float volume_ = 0.2f;
+    std::atomic<float> volume_{0.2f};
     bool ok_ = false;
+
+    QueueHandle_t queue_ = nullptr;
+    TaskHandle_t task_handle_ = nullptr;
+    std::atomic<uint32_t> generation_{0};
+    std::atomic<bool> playing_{false};
 };
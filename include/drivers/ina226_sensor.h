@@ -30,9 +30,13 @@ public:
     bool begin();
     void update(uint32_t now_ms);
 
+    void setSamplePeriodMs(uint32_t period_ms);
+
     bool isOk() const;
     bool hasReading() const;
     const Reading &reading() const;
+    // Failed I2C register transfers since boot.
+    uint32_t errorCount() const;
 
 private:
     Config cfg_;
@@ -40,6 +44,7 @@ private:
     bool has_reading_ = false;
     uint32_t last_sample_ms_ = 0;
     Reading reading_;
+    uint32_t i2c_errors_ = 0;
 
     bool writeRegister_(uint8_t reg, uint16_t value);
     bool readRegister_(uint8_t reg, uint16_t &value);
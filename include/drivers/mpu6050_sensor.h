@@ -40,9 +40,13 @@ public:
     void setAddress(uint8_t address);
     uint8_t address() const;
 
+    void setSamplePeriodMs(uint32_t period_ms);
+
     bool isOk() const;
     bool hasReading() const;
     const Reading &reading() const;
+    // Failed I2C register transfers since boot.
+    uint32_t errorCount() const;
 
 private:
     Config cfg_;
@@ -50,6 +54,7 @@ private:
     bool has_reading_ = false;
     uint32_t last_sample_ms_ = 0;
     Reading reading_;
+    uint32_t i2c_errors_ = 0;
 
     bool writeRegister_(uint8_t reg, uint8_t value);
     bool readRegisters_(uint8_t start_reg, uint8_t *buffer, size_t len);
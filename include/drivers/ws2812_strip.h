@@ -0,0 +1,54 @@
+#pragma once
+#include <Arduino.h>
+#include <driver/rmt.h>
+
+// WS2812B strip on one RMT channel. The RMT ISR translates the frame into
+// pulses while it goes out, so show() returns at once and interrupts stay
+// enabled; the CPU only refills the channel memory every few pixels.
+//
+// Two frame buffers: RMT reads the one on the wire until it is done, the
+// other is the draft that setPixel()/fill() edit. A draft identical to the
+// frame on the wire is not sent again.
+class Ws2812Strip
+{
+public:
+    struct Config
+    {
+        gpio_num_t data_pin;
+        uint16_t led_count;
+        rmt_channel_t channel;
+    };
+
+    explicit Ws2812Strip(const Config &cfg);
+
+    bool begin();
+
+    // Edit the draft; nothing is sent until show().
+    void setPixel(uint16_t i, uint8_t r, uint8_t g, uint8_t b);
+    void fill(uint8_t r, uint8_t g, uint8_t b);
+    void clear();
+    // The draft itself, 3 bytes per LED in wire order (GRB), for callers
+    // that render whole frames; null before begin().
+    uint8_t *pixels();
+
+    // Queues the draft for sending and tries to start it. Never waits: if
+    // the previous frame is still on the wire, update() sends it later.
+    void show();
+    void update();
+
+    uint32_t framesSent() const;
+    uint32_t framesSkipped() const; // show() with nothing changed
+
+private:
+    size_t frameBytes_() const;
+    uint8_t *draft_();
+
+    Config cfg_;
+    uint8_t *frames_[2] = {nullptr, nullptr};
+    uint8_t wire_ = 0; // index of the buffer RMT reads
+    bool ok_ = false;
+    bool hasSent_ = false;
+    bool showRequested_ = false;
+    uint32_t sent_ = 0;
+    uint32_t skipped_ = 0;
+};
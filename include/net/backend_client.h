@@ -1,76 +1,41 @@
 #pragma once
 #include <Arduino.h>
 
+#include "net/json_pool.h"
+#include "net/state_schema.h"
+
+// POSTs to the backend. The blocking calls run on the caller's task; the
+// queue* calls hand the request to a worker task, which retries failures
+// per request class with exponential backoff and jitter. Register and state
+// are latest-wins, so queueing again while one is outstanding only updates
+// it; a register is retried until the backend accepts it, refusals
+// included. Events are queued and dropped after a few failed attempts.
+//
+// A circuit breaker in the worker stops posting after
+// AppConfig::BACKEND_BREAKER_FAILURES consecutive transport errors or 5xx
+// replies, then lets a single probe through once the pause has passed.
 namespace BackendClient
 {
-    struct PingResult
+    enum class Circuit : uint8_t
     {
-        bool wifiConnected;
-        bool targetValid;
-        bool sessionStarted;
-        bool sessionFinished;
-        uint32_t transmitted;
-        uint32_t received;
-        uint32_t durationMs;
-        uint32_t minTimeMs;
-        uint32_t maxTimeMs;
-        uint32_t avgTimeMs;
+        Closed,
+        Open,
+        HalfOpen
     };
 
     void begin();
 
-    PingResult ping();
-
     bool registerRobot(uint16_t robotPort);
     bool queueRegisterRobot(uint16_t robotPort);
 
-    bool postState(const String &systemHealth,
-                   int batteryLevel,
-                   const String &driveMode,
-                   const String &cargoStatus,
-                   const String &currentPosition,
-                   const String &lastNode,
-                   const String &targetNode,
-                   bool hasGyroscope,
-                   float gyroXDps,
-                   float gyroYDps,
-                   float gyroZDps,
-                   bool hasRfid,
-                   const String &lastReadUuid,
-                   bool hasLux,
-                   float lux,
-                   bool hasInfrared,
-                   bool infraredFront,
-                   bool infraredLeft,
-                   bool infraredRight,
-                   bool hasPower,
-                   float voltageV,
-                   float currentA,
-                   float powerW);
-    bool queueState(const String &systemHealth,
-                    int batteryLevel,
-                    const String &driveMode,
-                    const String &cargoStatus,
-                    const String &currentPosition,
-                    const String &lastNode,
-                    const String &targetNode,
-                    bool hasGyroscope,
-                    float gyroXDps,
-                    float gyroYDps,
-                    float gyroZDps,
-                    bool hasRfid,
-                    const String &lastReadUuid,
-                    bool hasLux,
-                    float lux,
-                    bool hasInfrared,
-                    bool infraredFront,
-                    bool infraredLeft,
-                    bool infraredRight,
-                    bool hasPower,
-                    float voltageV,
-                    float currentA,
-                    float powerW);
+    bool postState(const StateSchema::Snapshot &state);
+    bool queueState(const StateSchema::Snapshot &state);
 
     bool postEvent(const String &eventName);
     bool queueEvent(const String &eventName);
+
+    Circuit circuit();
+    const char *circuitName(Circuit c);
+
+    JsonPool::Stats jsonPoolStats();
 }
@@ -11,4 +11,6 @@ namespace BackendConfig
     constexpr bool TLS_INSECURE = true;
     static const char *TLS_CA_CERT = nullptr;
     constexpr uint16_t ROBOT_PORT = 8080;
+    constexpr uint16_t UDP_TELEOP_PORT = 8081;
+    constexpr uint16_t ROBOT_WS_PORT = 8082;
 }
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+
+#include "net/state_schema.h"
+#include "net/telemetry_stream.h"
+
+// Control command set shared by every channel that can drive the robot (the
+// backend WS link, the on-robot WS server). Messages are decoded on the
+// network task into POD Commands and dispatched on the control task.
+namespace ControlCommands
+{
+    constexpr size_t TEXT_CAP = 32;
+
+    // Sent as a text frame when a session opens. Clients that understand it
+    // may switch DRIVE_COMMAND to the binary frame below; everything else
+    // (and any client that ignores HELLO) stays on JSON.
+    constexpr char HELLO_JSON[] = "{\"type\":\"HELLO\",\"protocol\":1,\"binary\":{\"DRIVE_COMMAND\":1}}";
+
+    // Binary DRIVE_COMMAND frame (little-endian, 14 bytes):
+    //   0  u8  opcode (BINARY_OP_DRIVE)
+    //   1  u8  flags (bit0 = seq valid, bit1 = ts valid)
+    //   2  i16 linear velocity, -32767..32767 -> -1..1
+    //   4  i16 angular velocity, same scale
+    //   6  u32 seq, +1 per frame
+    //  10  u32 sender timestamp, echoed in DRIVE_ACK like the JSON "ts"
+    constexpr uint8_t BINARY_OP_DRIVE = 0x01;
+    constexpr size_t BINARY_DRIVE_BYTES = 14;
+
+    enum class CommandType : uint8_t
+    {
+        Connected,
+        Disconnected,
+        Navigate,
+        Drive,
+        Led,
+        LedPattern,
+        AudioBeep,
+        AudioVolume,
+        Stop,
+        SetMode,
+        Subscribe,
+        Telemetry,
+        Unknown,
+    };
+
+    enum class Source : uint8_t
+    {
+        Backend,
+        Lan,
+        Udp,
+    };
+
+    struct DriveCommand
+    {
+        float linearVelocity;
+        float angularVelocity;
+        bool hasSeq;
+        bool hasTs;
+        uint32_t seq;      // optional "seq", increments per frame
+        uint32_t senderTs; // optional "ts", sender clock, echoed untouched
+        uint32_t rxUs;     // micros() when the frame reached the network task
+        Source source;     // where a DRIVE_ACK has to go
+        uint8_t clientId;  // LAN client slot, unused for other sources
+    };
+
+    // LED_PATTERN: "pattern" names a status pattern, or "AUTO" to return to
+    // status-driven selection. "r"/"g"/"b", "width" and "periodMs" replace
+    // that pattern's parameters where present; "select" (default true) pins
+    // the pattern. Also the body of POST /led.
+    struct LedPatternCommand
+    {
+        char pattern[TEXT_CAP];
+        bool select;
+        bool hasColor;
+        uint8_t r;
+        uint8_t g;
+        uint8_t b;
+        bool hasWidth;
+        uint8_t width;
+        bool hasPeriod;
+        uint16_t periodMs;
+    };
+
+    // Robot-side timestamps for one drive command, all in local micros().
+    // The sender gets hop durations from differences and the network share
+    // from its own round trip minus (sentUs - rxUs).
+    struct DriveAck
+    {
+        DriveCommand command;
+        uint32_t dispatchUs; // handed to the control task
+        uint32_t applyUs;    // first PWM write after dispatch, 0 if none
+        bool applied;
+    };
+
+    struct Command
+    {
+        CommandType type;
+        uint8_t clientId;
+        union
+        {
+            struct
+            {
+                char start[TEXT_CAP];
+                char destination[TEXT_CAP];
+            } navigate;
+            DriveCommand drive;
+            struct
+            {
+                bool enabled;
+                uint8_t r;
+                uint8_t g;
+                uint8_t b;
+                uint8_t brightness;
+            } led;
+            LedPatternCommand ledPattern;
+            struct
+            {
+                uint32_t hz;
+                uint32_t ms;
+                bool queue; // "mode":"queue"; otherwise it preempts
+            } beep;
+            struct
+            {
+                float value;
+            } volume;
+            struct
+            {
+                char mode[TEXT_CAP];
+            } setMode;
+            struct
+            {
+                StateSchema::FieldMask mask; // 0 = unsubscribe
+                uint32_t periodMs;
+            } subscribe;
+            struct
+            {
+                uint16_t rateHz[TelemetryStream::CHANNEL_COUNT]; // 0 = off
+                uint16_t batchMs;
+            } telemetry;
+            struct
+            {
+                char command[TEXT_CAP];
+            } unknown;
+        };
+    };
+
+    struct Handlers
+    {
+        std::function<void()> onConnected;
+        std::function<void()> onDisconnected;
+
+        std::function<void(const char *startNode, const char *destinationNode)> onNavigate;
+        std::function<void(const DriveCommand &command)> onDriveCommand;
+        std::function<void(bool enabled, uint8_t r, uint8_t g, uint8_t b, uint8_t brightness)> onLed;
+        std::function<void(const LedPatternCommand &command)> onLedPattern;
+        // hz or ms of 0 stops the current sound.
+        std::function<void(uint32_t hz, uint32_t ms, bool queue)> onAudioBeep;
+        std::function<void(float value)> onAudioVolume;
+
+        std::function<void()> onStop;
+        std::function<void(const char *mode)> onSetMode;
+
+        std::function<void(const char *command)> onUnknownCommand;
+    };
+
+    struct DriveStats
+    {
+        uint32_t received;
+        uint32_t applied;
+        uint32_t coalesced; // superseded by a newer frame in the same tick
+        uint32_t stale;     // older seq/ts than the last applied frame
+        uint32_t refused;   // LAN client that does not hold the drive
+    };
+
+    // Parses one JSON text frame into `out`. `doc` supplies the allocator;
+    // false if the frame is not valid JSON or lacks "command". The command
+    // name is looked up in a compile-time perfect hash, and the frame is
+    // deserialized with that command's filter, so members nobody reads are
+    // never stored.
+    bool decode(JsonDocument &doc, const char *payload, size_t len, uint32_t rxUs, Source source, Command &out);
+
+    // Decodes one binary frame without touching the heap or a JSON pool;
+    // false for an unknown opcode or a frame of the wrong size.
+    bool decodeBinary(const uint8_t *payload, size_t len, uint32_t rxUs, Source source, Command &out);
+
+    void dispatch(const Command &cmd, const Handlers &handlers);
+
+    // Reads an LED_PATTERN message (or POST /led body) into `out`.
+    void readLedPattern(JsonVariantConst msg, LedPatternCommand &out);
+
+    // DRIVE_ACK reply body, identical on every channel.
+    void writeDriveAck(const DriveAck &ack, JsonObject out);
+
+    // Feeds the commands drained in one control tick through to the handlers
+    // in order, except that only the newest drive command is applied (at
+    // flush() or before the next non-drive command) and drive frames not
+    // newer than the last applied or the held one are dropped.
+    class Coalescer
+    {
+    public:
+        Coalescer();
+
+        void accept(const Command &cmd, const Handlers &handlers);
+        void flush(const Handlers &handlers);
+        // Forgets the held frame and the seq/ts watermark, for a new sender
+        // on the same channel; stats keep counting.
+        void reset();
+
+        DriveStats stats() const;
+
+    private:
+        bool isStale(const DriveCommand &drive) const;
+        void apply(const Handlers &handlers);
+
+        Command pending;
+        bool hasPending;
+
+        bool hasLastSeq;
+        bool hasLastTs;
+        uint32_t lastSeq;
+        uint32_t lastTs;
+
+        DriveStats driveStats;
+    };
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+
+// Scripted network faults for bench runs, compiled in only when
+// AppConfig::NET_FAULT_INJECTION is set (every hook is a constant false
+// otherwise). start() runs a fixed schedule of phases (clean, slow, narrow,
+// lossy, TLS failures, half-open) on repeat; the current phase shapes every
+// backend HTTP connection through FaultyClient and the backend WS task
+// through rollDrop()/rollTlsFailure()/profile(). Comparing
+// robot_loop_duration_us per phase shows what leaks into the control loop.
+namespace FaultInjection
+{
+    struct Profile
+    {
+        const char *name;
+        uint32_t delayMs;     // added to every connect and write
+        uint32_t bytesPerSec; // 0 = unlimited
+        uint8_t dropPct;      // reads/writes that stall like a TCP retransmit; WS frames lost
+        uint8_t tlsFailPct;   // secure connects that fail their handshake
+        bool halfOpen;        // peer silently gone: writes vanish, reads never see data
+    };
+
+    // Any task.
+    void start();
+    void stop();
+    bool active();
+    Profile profile();
+
+    bool rollDrop();
+    bool rollTlsFailure();
+
+    // Wraps the client HTTPClient is handed. HTTPClient only reaches the
+    // socket through the virtual Client interface, so socket options set
+    // via WiFiClient's non-virtual members stay on the wrapper; the wrapped
+    // client keeps its defaults.
+    class FaultyClient : public WiFiClient
+    {
+    public:
+        FaultyClient(WiFiClient &inner, bool secure);
+
+        int connect(IPAddress ip, uint16_t port) override;
+        int connect(const char *host, uint16_t port) override;
+        int connect(IPAddress ip, uint16_t port, int32_t timeout) override;
+        int connect(const char *host, uint16_t port, int32_t timeout) override;
+
+        size_t write(uint8_t b) override;
+        size_t write(const uint8_t *buf, size_t size) override;
+        int available() override;
+        int read() override;
+        int read(uint8_t *buf, size_t size) override;
+        int peek() override;
+        void flush() override;
+        void stop() override;
+        uint8_t connected() override;
+        operator bool() override;
+
+        using Print::write;
+
+    private:
+        // False if the connect must fail; otherwise the connect goes ahead.
+        bool beforeConnect();
+        void shape(size_t bytes, bool outgoing);
+
+        WiFiClient &inner_;
+        bool secure_;
+        bool halfOpen_ = false;
+        uint32_t owedBytes_ = 0;
+    };
+}
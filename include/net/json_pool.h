@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Bump allocator for ArduinoJson documents backed by a fixed buffer.
+// Blocks are released LIFO and the whole pool rewinds once every block is
+// freed, so a document that is cleared/destroyed per message never touches
+// the heap. If the buffer is too small the allocator falls back to malloc and
+// counts it, which makes undersized pools visible instead of dropping data.
+// A pool must only be used from one task.
+class JsonPool : public ArduinoJson::Allocator
+{
+public:
+    struct Stats
+    {
+        size_t capacity;
+        size_t highWater;
+        uint32_t heapFallbacks;
+    };
+
+    JsonPool(uint8_t *buffer, size_t capacity);
+
+    void *allocate(size_t size) override;
+    void deallocate(void *ptr) override;
+    void *reallocate(void *ptr, size_t newSize) override;
+
+    Stats stats() const;
+
+private:
+    struct BlockHeader
+    {
+        uint32_t size;
+        uint32_t reserved;
+    };
+
+    static constexpr size_t ALIGNMENT = 8;
+
+    static size_t alignUp(size_t v);
+    bool owns(const void *ptr) const;
+    BlockHeader *headerOf(void *ptr) const;
+    bool isTopBlock(const BlockHeader *header) const;
+
+    uint8_t *buffer_;
+    size_t capacity_;
+    size_t top_ = 0;
+    size_t highWater_ = 0;
+    uint32_t liveBlocks_ = 0;
+    uint32_t heapFallbacks_ = 0;
+};
+
+template <size_t N>
+class StaticJsonPool : public JsonPool
+{
+public:
+    StaticJsonPool() : JsonPool(storage_, N) {}
+
+private:
+    alignas(8) uint8_t storage_[N];
+};
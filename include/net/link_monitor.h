@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+
+// Background ICMP echo to the backend host (the gateway when HOST is not an
+// IP literal), one probe every AppConfig::LINK_PING_INTERVAL_MS while WiFi
+// is up. Replies land on the esp_ping task; stats() summarises the last
+// LINK_WINDOW probes for the console, OLED, /metrics and heartbeat tuning.
+namespace LinkMonitor
+{
+    enum class Quality : uint8_t
+    {
+        Unknown, // not running, or too few probes yet
+        Good,
+        Degraded,
+        Poor,
+        Down // the most recent probes all timed out
+    };
+
+    struct Stats
+    {
+        bool running;
+        uint8_t probes; // in the window
+        uint8_t lost;
+        uint8_t lossPct;
+        uint32_t rttMinMs;
+        uint32_t rttAvgMs;
+        uint32_t rttMaxMs;
+        uint32_t rttLastMs;
+        float jitterMs; // RFC 3550 style smoothed RTT variation
+        Quality quality;
+    };
+
+    // Control task; call when the station got / lost its address.
+    void start();
+    void stop();
+
+    Stats stats();
+    Quality quality();
+    const char *qualityName(Quality q);
+}
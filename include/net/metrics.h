@@ -0,0 +1,179 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+// Firmware-wide metrics for GET /metrics (Prometheus text exposition).
+// Every metric is an object with static storage that links itself into the
+// registry when constructed, so nothing is allocated after boot. Metrics
+// that share a name form one family; define them next to each other (same
+// translation unit, consecutive) so HELP/TYPE is emitted once.
+//
+// Counters and gauges may be updated from any task. Histograms and status
+// tables expect a single writer task each; scrapes run on the control task
+// and tolerate a sample that is mid-update.
+namespace Metrics
+{
+    // Appends exposition text to a fixed buffer. Output that doesn't fit is
+    // dropped whole and so is everything after it, until rewind(): the
+    // buffer always ends with the last complete line.
+    class Writer
+    {
+    public:
+        Writer(char *out, size_t size);
+
+        void family(const char *name, const char *type, const char *help);
+        void sample(const char *name, const char *labels, uint32_t value);
+        void sample(const char *name, const char *labels, float value);
+        void printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+        size_t length() const;
+        bool overflowed() const;
+        // Drops the output past `length` and accepts more again.
+        void rewind(size_t length);
+
+    private:
+        char *out_;
+        size_t size_;
+        size_t length_ = 0;
+        bool overflowed_ = false;
+    };
+
+    class Metric
+    {
+    public:
+        Metric(const Metric &) = delete;
+        Metric &operator=(const Metric &) = delete;
+
+        const char *name() const;
+        const Metric *next() const;
+
+        // Writes the samples only; HELP/TYPE come from the registry.
+        virtual void write(Writer &w) const = 0;
+        virtual const char *type() const = 0;
+        const char *help() const;
+
+    protected:
+        Metric(const char *name, const char *help);
+        ~Metric() = default;
+
+    private:
+        const char *name_;
+        const char *help_;
+        Metric *next_ = nullptr;
+    };
+
+    // `labels` is the rendered label set without braces, e.g. "outcome=\"arrived\"".
+    class Counter : public Metric
+    {
+    public:
+        Counter(const char *name, const char *help, const char *labels = nullptr);
+
+        void inc(uint32_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+        uint32_t value() const { return value_.load(std::memory_order_relaxed); }
+
+        void write(Writer &w) const override;
+        const char *type() const override { return "counter"; }
+
+    private:
+        const char *labels_;
+        std::atomic<uint32_t> value_{0};
+    };
+
+    class Gauge : public Metric
+    {
+    public:
+        Gauge(const char *name, const char *help, const char *labels = nullptr);
+
+        void set(float v) { value_.store(v, std::memory_order_relaxed); }
+        float value() const { return value_.load(std::memory_order_relaxed); }
+
+        void write(Writer &w) const override;
+        const char *type() const override { return "gauge"; }
+
+    private:
+        const char *labels_;
+        std::atomic<float> value_{0.0f};
+    };
+
+    // Cumulative since boot. `bounds` are ascending bucket upper edges with
+    // static storage; +Inf is implicit.
+    class Histogram : public Metric
+    {
+    public:
+        static constexpr uint8_t MAX_BOUNDS = 15;
+
+        Histogram(const char *name, const char *help, const float *bounds, uint8_t boundCount);
+
+        void observe(float v);
+
+        void write(Writer &w) const override;
+        const char *type() const override { return "histogram"; }
+
+    private:
+        const float *bounds_;
+        uint8_t boundCount_;
+        uint32_t counts_[MAX_BOUNDS + 1] = {};
+        uint32_t count_ = 0;
+        double sum_ = 0.0;
+    };
+
+    // Response counts per (endpoint, status code), for HTTP clients and
+    // servers. Endpoint strings must have static storage; cells are claimed
+    // as new pairs show up, pairs beyond SLOTS are counted under code="other".
+    class StatusTable : public Metric
+    {
+    public:
+        static constexpr uint8_t SLOTS = 16;
+
+        StatusTable(const char *name, const char *help, const char *endpointLabel);
+
+        void inc(const char *endpoint, int code);
+
+        void write(Writer &w) const override;
+        const char *type() const override { return "counter"; }
+
+    private:
+        struct Slot
+        {
+            const char *endpoint;
+            int code;
+            std::atomic<uint32_t> count;
+        };
+
+        const char *endpointLabel_;
+        Slot slots_[SLOTS];
+        std::atomic<uint8_t> used_{0};
+        std::atomic<uint32_t> overflow_{0};
+    };
+
+    // Scrape-time hook for values that are read rather than counted. The
+    // callback writes complete families (Writer::family + samples).
+    class Collector : public Metric
+    {
+    public:
+        using Fn = void (*)(Writer &w);
+
+        explicit Collector(Fn fn);
+
+        void write(Writer &w) const override;
+        const char *type() const override { return nullptr; }
+
+    private:
+        Fn fn_;
+    };
+
+    // Exports the task's stack high-water mark (robot_task_stack_free_bytes).
+    void trackTask(TaskHandle_t task);
+
+    // writeAll() cursor once the whole exposition is out.
+    constexpr uint16_t END = 0xFFFF;
+
+    // Registry plus heap, uptime and tracked task stacks, in pieces that
+    // each fit `outSize`: start with `cursor` 0 and call again until it is
+    // END. Pieces only split between metrics, so the samples of one metric
+    // always come from a single pass. A metric larger than a whole piece is
+    // cut after its last complete line and counted in
+    // robot_metrics_truncated_total. Returns the bytes written.
+    size_t writeAll(char *out, size_t outSize, uint16_t &cursor);
+}
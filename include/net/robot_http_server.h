@@ -2,6 +2,29 @@
 #include <Arduino.h>
 #include <functional>
 
+#include "net/control_commands.h"
+#include "net/json_pool.h"
+#include "net/state_schema.h"
+
+// Robot REST API (GET /status, /events, /health, /metrics; POST /mode, /select, /led).
+// Sockets are served by a select() loop on a network-core task with a fixed
+// connection table, so clients never run on the control loop:
+//   - /status and /health are answered on the server task; /status comes from
+//     a pre-serialized body that is rebuilt only when publishStatus() saw a change
+//   - /mode, /select, /led and /metrics touch control state, so the request is handed
+//     to handle() on the control task and answered once it ran
+// Requests (headers + body) must fit AppConfig::HTTP_RX_BYTES; HTTP/1.1
+// keep-alive and pipelining are supported.
+//
+// Every /status response carries X-State-Version. GET /status?since=N&timeoutMs=T
+// long-polls: it answers once the version differs from N, or with the
+// unchanged state after T ms (default/max in AppConfig).
+//
+// GET /events is a Server-Sent Events stream:
+//   id: <version>  event: state  data: {changed fields, /status layout}
+//   event: event   data: {"event":"START_BUTTON_PRESSED","version":N}
+// The first state frame carries every field; so does the next one after a
+// client fell too far behind to buffer the deltas in between.
 namespace RobotHttpServer
 {
 
@@ -12,50 +35,28 @@ namespace RobotHttpServer
         AUTO
     };
 
-    struct StatusSnapshot
-    {
-        const char *systemHealth; // e.g. "OK"
-        int batteryLevel;         // 0..100
-        DriveMode driveMode;      // IDLE/MANUAL/AUTO
-        const char *cargoStatus;  // e.g. "IN_TRANSIT"
-
-        const char *lastRouteStart; // nullable
-        const char *lastRouteEnd;   // nullable
-        const char *position;       // nullable
-        const char *currentNode;    // nullable
-        const char *targetNode;     // nullable
-        const char *navigationStatus;
-
-        bool irLeft;
-        bool irMid;
-        bool irRight;
-
-        float lux;
-        bool luxValid;
+    using ModeSetter = std::function<void(DriveMode)>;
+    using RouteSetter = std::function<bool(const String &startNode, const String &endNode, String &error)>;
+    // POST /led, body as the LED_PATTERN command (net/control_commands.h).
+    using LedPatternSetter = std::function<bool(const ControlCommands::LedPatternCommand &command, String &error)>;
 
-        float batteryVoltage;
-        float batteryCurrentA;
-        float batteryPowerW;
-        bool powerValid;
+    const char *driveModeName(DriveMode m);
 
-        float gyroXDps;
-        float gyroYDps;
-        float gyroZDps;
-        bool gyroValid;
+    void begin(uint16_t port, ModeSetter modeSetter, RouteSetter routeSetter);
 
-        const char *lastReadUuid; // nullable
+    // Control task: answers queued /mode, /select, /led and /metrics requests.
+    void handle();
 
-        bool ledEnabled;
-        bool ledAutoEnabled;
+    // Control task: offers the current state for /status. The version only
+    // moves (and the body is only re-serialized) when a field changed.
+    void publishStatus(const StateSchema::Snapshot &s);
+    uint32_t statusVersion();
 
-        float audioVolume; // 0..1
-    };
+    // Control task: pushes a named event to /events subscribers.
+    void publishEvent(const char *name);
 
-    using StatusProvider = std::function<StatusSnapshot()>;
-    using ModeSetter = std::function<void(DriveMode)>;
-    using RouteSetter = std::function<bool(const String &startNode, const String &endNode, String &error)>;
+    void setLedPatternSetter(LedPatternSetter setter);
 
-    void begin(uint16_t port, StatusProvider statusProvider, ModeSetter modeSetter, RouteSetter routeSetter);
-    void handle();
+    JsonPool::Stats jsonPoolStats();
 
 }
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "net/control_commands.h"
+#include "net/json_pool.h"
+#include "net/state_schema.h"
+
+// WebSocket endpoint on the robot for direct LAN teleop. Accepts the same
+// command set as WsControlClient plus
+//   {"command":"SUBSCRIBE","fields":["batteryLevel",...],"periodMs":200}
+//   {"command":"UNSUBSCRIBE"}
+// after which the client receives {"type":"STATE","state":{...}} frames
+// carrying only the subscribed fields that changed since its last frame.
+// High-rate sampled channels are requested with TELEMETRY (net/telemetry_stream.h).
+// Every client is greeted with ControlCommands::HELLO_JSON and may then send
+// DRIVE_COMMAND as a binary frame instead of JSON.
+// Only one client drives at a time: the first to send DRIVE_COMMAND holds
+// the drive until it disconnects or goes quiet for
+// AppConfig::ROBOT_WS_DRIVE_OWNER_IDLE_MS; other clients' drive frames are
+// dropped (STOP is always accepted). Each client has its own seq/ts
+// watermark.
+// Clients authenticate with HTTP basic auth, user "robot", password
+// LAN_API_KEY. ws:// carries it in clear on the LAN, so it is a key of its
+// own, shared with neither the backend nor UDP teleop.
+namespace RobotWsServer
+{
+    // Handler semantics match WsControlClient::begin; connect/disconnect of
+    // individual LAN clients is handled internally.
+    void begin(uint16_t port, const ControlCommands::Handlers &handlers);
+
+    // Control task: runs handlers for received commands.
+    void loop();
+
+    // True if some subscriber is due a STATE frame; lets the caller skip
+    // capturing a snapshot nobody will read.
+    bool wantsState(uint32_t nowMs);
+    void publishState(const StateSchema::Snapshot &s, uint32_t nowMs);
+
+    bool sendDriveAck(uint8_t clientId, const ControlCommands::DriveAck &ack);
+    bool sendBinary(uint8_t clientId, const uint8_t *data, size_t len);
+
+    uint8_t clientCount();
+    // Summed over clients; drive frames from non-owners count as received
+    // and refused.
+    ControlCommands::DriveStats driveStats();
+    JsonPool::Stats jsonPoolStats();
+}
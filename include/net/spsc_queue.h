@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring of POD items. push() may only
+// be called from one task and pop() from one (other) task. N must be a power
+// of two; one slot is never used so head == tail means empty.
+template <typename T, size_t N>
+class SpscQueue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    bool push(const T &item)
+    {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        const uint32_t next = (head + 1) & (N - 1);
+        if (next == tail_.load(std::memory_order_acquire))
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        slots_[head] = item;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &out)
+    {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire))
+            return false;
+
+        out = slots_[tail];
+        tail_.store((tail + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    // Items rejected by push() because the ring was full.
+    uint32_t dropped() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+private:
+    T slots_[N];
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+    std::atomic<uint32_t> dropped_{0};
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <cstddef>
+
+// Robot state schema. Every field is declared exactly once here; the snapshot
+// struct, the field table, the JSON/binary encoders and the delta comparator
+// are all generated from this list.
+//
+//   X(name, type, capacity, presence, deadband, statusGroup, statusKey, backendGroup, backendKey, flags)
+//
+// type      Bool/Int/Float/Text, capacity only applies to Text (incl. NUL)
+// presence  SS_ALWAYS or SS_WHEN(boolField); absent fields are left out of the backend post
+// deadband  smallest Float change diff() reports
+// groups    JSON object the field is written to per target, None = not emitted
+#define ROBOT_STATE_FIELDS(X)                                                                                          \
+    X(systemHealth, Text, 16, SS_ALWAYS, 0.0f, Root, "systemHealth", Root, "systemHealth", 0)                          \
+    X(batteryLevel, Int, 0, SS_ALWAYS, 0.0f, Root, "batteryLevel", Root, "batteryLevel", 0)                            \
+    X(driveMode, Text, 8, SS_ALWAYS, 0.0f, Root, "driveMode", None, nullptr, 0)                                        \
+    X(backendDriveMode, Text, 12, SS_ALWAYS, 0.0f, None, nullptr, Root, "driveMode", 0)                                \
+    X(cargoStatus, Text, 16, SS_ALWAYS, 0.0f, Root, "cargoStatus", Root, "cargoStatus", 0)                             \
+    X(lastRouteStart, Text, 32, SS_ALWAYS, 0.0f, LastRoute, "startNode", None, nullptr, 0)                             \
+    X(lastRouteEnd, Text, 32, SS_ALWAYS, 0.0f, LastRoute, "endNode", None, nullptr, 0)                                 \
+    X(position, Text, 32, SS_ALWAYS, 0.0f, Root, "position", Root, "currentPosition", 0)                               \
+    X(currentNode, Text, 32, SS_ALWAYS, 0.0f, Root, "currentNode", Root, "lastNode", 0)                                \
+    X(targetNode, Text, 32, SS_ALWAYS, 0.0f, Root, "targetNode", Root, "targetNode", 0)                                \
+    X(navigationStatus, Text, 16, SS_ALWAYS, 0.0f, Root, "navigationStatus", None, nullptr, 0)                         \
+    X(irLeft, Bool, 0, SS_ALWAYS, 0.0f, SensorsIr, "left", Infrared, "left", 0)                                        \
+    X(irMid, Bool, 0, SS_ALWAYS, 0.0f, SensorsIr, "middle", Infrared, "front", 0)                                      \
+    X(irRight, Bool, 0, SS_ALWAYS, 0.0f, SensorsIr, "right", Infrared, "right", 0)                                     \
+    X(luxValid, Bool, 0, SS_ALWAYS, 0.0f, SensorsLight, "luxValid", None, nullptr, 0)                                  \
+    X(lux, Float, 0, SS_WHEN(luxValid), 5.0f, SensorsLight, "lux", Root, "lux", 0)                                     \
+    X(powerValid, Bool, 0, SS_ALWAYS, 0.0f, SensorsPower, "valid", None, nullptr, 0)                                   \
+    X(batteryVoltage, Float, 0, SS_WHEN(powerValid), 0.05f, SensorsPower, "batteryVoltage", Root, "voltageV", 0)       \
+    X(batteryCurrentA, Float, 0, SS_WHEN(powerValid), 0.05f, SensorsPower, "currentA", Root, "currentA", 0)            \
+    X(batteryPowerW, Float, 0, SS_WHEN(powerValid), 0.5f, SensorsPower, "powerW", Root, "powerW", 0)                   \
+    X(gyroValid, Bool, 0, SS_ALWAYS, 0.0f, SensorsGyroscope, "valid", None, nullptr, 0)                                \
+    X(gyroXDps, Float, 0, SS_WHEN(gyroValid), 2.0f, SensorsGyroscope, "xDps", Gyroscope, "xDps", 0)                    \
+    X(gyroYDps, Float, 0, SS_WHEN(gyroValid), 2.0f, SensorsGyroscope, "yDps", Gyroscope, "yDps", 0)                    \
+    X(gyroZDps, Float, 0, SS_WHEN(gyroValid), 2.0f, SensorsGyroscope, "zDps", Gyroscope, "zDps", 0)                    \
+    X(rfidValid, Bool, 0, SS_ALWAYS, 0.0f, None, nullptr, None, nullptr, 0)                                            \
+    X(lastReadUuid, Text, 32, SS_WHEN(rfidValid), 0.0f, SensorsRfid, "lastReadUuid", Root, "lastReadUuid", NULL_IF_EMPTY) \
+    X(ledEnabled, Bool, 0, SS_ALWAYS, 0.0f, Led, "enabled", None, nullptr, 0)                                          \
+    X(ledAutoEnabled, Bool, 0, SS_ALWAYS, 0.0f, Led, "autoEnabled", None, nullptr, 0)                                  \
+    X(audioVolume, Float, 0, SS_ALWAYS, 0.01f, Audio, "volume", None, nullptr, 0)
+
+namespace StateSchema
+{
+#define STATE_SCHEMA_MEMBER_Bool(name, capacity) bool name;
+#define STATE_SCHEMA_MEMBER_Int(name, capacity) int32_t name;
+#define STATE_SCHEMA_MEMBER_Float(name, capacity) float name;
+#define STATE_SCHEMA_MEMBER_Text(name, capacity) char name[capacity];
+#define STATE_SCHEMA_MEMBER(name, type, capacity, ...) STATE_SCHEMA_MEMBER_##type(name, capacity)
+
+    struct Snapshot
+    {
+        ROBOT_STATE_FIELDS(STATE_SCHEMA_MEMBER)
+    };
+
+#define STATE_SCHEMA_ID(name, ...) name,
+
+    enum class Field : uint8_t
+    {
+        ROBOT_STATE_FIELDS(STATE_SCHEMA_ID) Count
+    };
+
+    enum class FieldType : uint8_t
+    {
+        Bool,
+        Int,
+        Float,
+        Text,
+    };
+
+    enum class Group : uint8_t
+    {
+        None,
+        Root,
+        LastRoute,
+        Sensors,
+        SensorsIr,
+        SensorsLight,
+        SensorsPower,
+        SensorsGyroscope,
+        SensorsRfid,
+        Led,
+        Audio,
+        Gyroscope,
+        Infrared,
+        Count,
+    };
+
+    enum class Target : uint8_t
+    {
+        Status,
+        Backend,
+    };
+
+    constexpr uint8_t NULL_IF_EMPTY = 0x01;
+    constexpr size_t ALWAYS_PRESENT = SIZE_MAX;
+
+    struct FieldInfo
+    {
+        const char *name;
+        FieldType type;
+        uint16_t offset;
+        uint16_t size;
+        size_t presenceOffset;
+        float deadband;
+        Group statusGroup;
+        const char *statusKey;
+        Group backendGroup;
+        const char *backendKey;
+        uint8_t flags;
+    };
+
+    constexpr size_t FIELD_COUNT = static_cast<size_t>(Field::Count);
+    static_assert(FIELD_COUNT <= 64, "field masks are 64 bits wide");
+
+    using FieldMask = uint64_t;
+    constexpr FieldMask ALL_FIELDS = (FIELD_COUNT == 64) ? ~0ULL : ((1ULL << FIELD_COUNT) - 1ULL);
+
+    constexpr FieldMask bit(Field f)
+    {
+        return 1ULL << static_cast<uint8_t>(f);
+    }
+
+    const FieldInfo &info(Field f);
+
+    void copyText(char *dest, size_t destSize, const char *src);
+
+    // Writes the fields in `mask` in the JSON layout of `target`.
+    void writeJson(const Snapshot &s, JsonObject root, Target target, FieldMask mask = ALL_FIELDS);
+
+    // Compact little-endian form: version, 64-bit field mask, then each masked
+    // field in schema order (bool 1 B, int/float 4 B, text length byte + bytes).
+    // Returns 0 if `outSize` is too small.
+    size_t encodeBinary(const Snapshot &s, uint8_t *out, size_t outSize, FieldMask mask = ALL_FIELDS);
+
+    // Fields that differ between a and b; floats within their deadband count as equal.
+    FieldMask diff(const Snapshot &a, const Snapshot &b);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+
+// High-rate telemetry for LAN subscribers of RobotWsServer. The control task
+// offers one sample per channel at the channel's source rate; every
+// subscriber decimates that stream to its own rate (boxcar average over the
+// decimation window) and receives the results in batched binary frames.
+//
+// Subscribe: {"command":"TELEMETRY","channels":{"imu":100,"motor":50,"power":10},"batchMs":50}
+// Rate 0 or a missing channel turns it off; no channels at all unsubscribes.
+//
+// Binary frame (little-endian):
+//   u8 'T' (0x54), u8 version (1), u16 frame seq, u16 record count,
+//   then per record: u8 channel, u8 value count, u32 micros(), f32 values[]
+namespace TelemetryStream
+{
+    enum class Channel : uint8_t
+    {
+        Imu,   // gyro x/y/z dps, accel x/y/z g
+        Motor, // applied left/right duty, target throttle/steer, smoothed throttle/steer
+        Power, // bus voltage V, current A, power W
+        Light, // lux
+        Ir,    // left/middle/right obstacle, 0 or 1
+        Count,
+    };
+
+    constexpr size_t CHANNEL_COUNT = static_cast<size_t>(Channel::Count);
+    constexpr uint8_t MAX_VALUES = 6;
+
+    struct ChannelInfo
+    {
+        const char *name;
+        uint8_t valueCount;
+        uint16_t sourceHz; // rate offer() is fed at; requests above it are capped
+    };
+
+    struct Stats
+    {
+        uint32_t framesSent;
+        uint32_t framesDropped; // tx queue full
+        uint32_t recordsSent;
+        uint8_t subscribers;
+    };
+
+    const ChannelInfo &info(Channel c);
+    bool channelFromName(const char *name, Channel &out);
+
+    void subscribe(uint8_t clientId, const uint16_t *rateHz, uint16_t batchMs);
+    void unsubscribe(uint8_t clientId);
+
+    // True if someone subscribed to `c`.
+    bool active(Channel c);
+
+    // True if `c` is active and its next source sample is due.
+    bool due(Channel c, uint32_t nowUs);
+    void offer(Channel c, const float *values, uint32_t nowUs);
+
+    // Sends every batch that is full or older than its batchMs.
+    void flush(uint32_t nowMs);
+
+    Stats stats();
+}
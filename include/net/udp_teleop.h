@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+// Optional connectionless drive channel. Each datagram is a complete, fixed
+// size setpoint, so a lost packet never delays the next one the way a TCP
+// retransmit does. Only the newest valid datagram per poll is handed on;
+// the drive command timeout stops the robot when the stream dries up.
+//
+// Wire format (little-endian, 28 bytes):
+//   0  u16 magic 0x5454 ("TT")
+//   2  u8  version (2)
+//   3  u8  flags (bit0 = stop)
+//   4  u32 session nonce, as announced by the robot
+//   8  u32 seq, +1 per datagram
+//  12  u32 sender timestamp, ms
+//  16  i16 throttle, -32767..32767 -> -1..1
+//  18  i16 steer, same scale
+//  20  8 B tag = first 8 bytes of HMAC-SHA256(UDP_TELEOP_KEY, bytes 0..19)
+//
+// Sessions: the robot draws a random nonce at boot, and a new one whenever
+// a session lapses (no datagram accepted for SESSION_TIMEOUT_MS) or its seq
+// reaches the top. A correctly tagged datagram carrying any other nonce is
+// not applied; the sender gets a NONCE reply (16 bytes) instead:
+//   0  u16 magic, 2 u8 version, 3 u8 flags = 0x02, 4 u32 nonce,
+//   8  8 B tag = first 8 bytes of HMAC-SHA256(UDP_TELEOP_KEY, bytes 0..7)
+// Senders start with nonce 0, which the robot never uses, to ask for it.
+// A recorded datagram is therefore worthless once its session has ended,
+// and within a session seq must strictly increase and the sender clock
+// must not fall behind by more than MAX_DELAY_MS (delayed replays).
+// UDP_TELEOP_KEY is used for nothing else.
+namespace UdpTeleop
+{
+    constexpr size_t PACKET_BYTES = 28;
+    constexpr size_t NONCE_REPLY_BYTES = 16;
+
+    struct Handlers
+    {
+        std::function<void(float throttle, float steer, uint32_t rxUs)> onDrive;
+        std::function<void()> onStop;
+    };
+
+    struct Stats
+    {
+        uint32_t received;
+        uint32_t accepted;
+        uint32_t superseded; // valid, but a newer datagram arrived in the same poll
+        uint32_t stale;      // seq not newer than the last accepted one
+        uint32_t delayed;    // sender timestamp too far behind the session's clock
+        uint32_t wrongNonce; // signed for another (or no) session; answered with NONCE
+        uint32_t lost;       // seq gaps between accepted datagrams
+        uint32_t malformed;
+        uint32_t authFailed;
+        float jitterMs; // RFC 3550 interarrival jitter estimate
+        uint32_t lastSeq;
+    };
+
+    bool begin(uint16_t port, const Handlers &handlers);
+
+    // Drains the socket without blocking; call once per control tick.
+    void poll();
+
+    bool isActive();
+    Stats stats();
+}
@@ -1,9 +1,33 @@
 #pragma once
 #include <Arduino.h>
+#include <functional>
 
+// Station connection that never blocks the caller. begin() starts the first
+// attempt and returns; SDK events (on the WiFi event task) drive the state,
+// and loop() on the control task retries with exponential backoff plus
+// jitter and dispatches the handlers.
+//
+// The AP's BSSID and channel are cached in NVS after each successful join,
+// so the next boot or reconnect skips the full channel scan. If a cached
+// join fails, the cache is dropped and the next attempt scans.
 namespace WifiManager
 {
-    bool begin(const char *ssid, const char *pass, uint32_t timeout_ms);
+    struct Handlers
+    {
+        // Both run on the control task, from loop().
+        std::function<void()> onConnected;
+        std::function<void(uint8_t reason)> onDisconnected;
+    };
+
+    void begin(const char *ssid, const char *pass);
+    void setHandlers(const Handlers &handlers);
+
+    // Control task: applies queued SDK events, times out stuck attempts and
+    // starts the next one when its backoff expired.
+    void loop(uint32_t nowMs);
+
+    // Safe from any task.
     bool isConnected();
     String ip();
+    int8_t rssi();
 }
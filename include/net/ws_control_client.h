@@ -4,32 +4,34 @@
 #include <ArduinoJson.h>
 #include <functional>
 
+#include "net/control_commands.h"
+#include "net/json_pool.h"
+
 namespace WsControlClient
 {
-    struct Handlers
-    {
-        std::function<void()> onConnected;
-        std::function<void()> onDisconnected;
-
-        std::function<void(const String &startNode, const String &destinationNode)> onNavigate;
-        std::function<void(float linearVelocity, float angularVelocity)> onDriveCommand;
-        std::function<void(bool enabled, uint8_t r, uint8_t g, uint8_t b, uint8_t brightness)> onLed;
-        std::function<void(uint32_t hz, uint32_t ms)> onAudioBeep;
-        std::function<void(float value)> onAudioVolume;
-
-        std::function<void()> onStop;
-        std::function<void(const String &mode)> onSetMode;
-
-        std::function<void(const String &command, const JsonDocument &raw)> onUnknownCommand;
-    };
+    using Handlers = ControlCommands::Handlers;
+    using DriveCommand = ControlCommands::DriveCommand;
+    using DriveAck = ControlCommands::DriveAck;
+    using DriveStats = ControlCommands::DriveStats;
 
+    // Starts the socket on its own task. Handlers are only ever invoked from
+    // loop(), i.e. on the task that calls it.
     void begin(const Handlers &handlers);
+
+    // Runs handlers for every command received since the last call. Drive
+    // commands are coalesced: only the newest one per call reaches
+    // onDriveCommand, and frames older than the last applied one are dropped.
     void loop();
 
     bool isConnected();
 
+    // Queue a text frame for the WS task; false if the tx ring is full.
     bool sendJson(const JsonDocument &doc);
     bool sendText(const String &text);
+    bool sendDriveAck(const DriveAck &ack);
 
     void disconnect();
+
+    JsonPool::Stats jsonPoolStats();
+    DriveStats driveStats();
 }
@@ -0,0 +1,23 @@
+#pragma once
+
+// Template for include/secrets.h, which is not tracked: copy this file to
+// include/secrets.h and fill in every value. The firmware does not build
+// without it, and each key below is used by some part of it.
+namespace Secrets
+{
+    // WiFi station (net/wifi_manager.h).
+    constexpr char WIFI_SSID[] = "your-ssid";
+    constexpr char WIFI_PASS[] = "your-password";
+
+    // X-Api-Key on every POST to the backend (net/backend_client.h).
+    constexpr char ROBOT_API_KEY[] = "change-me";
+
+    // HTTP basic auth password of the on-robot WS server, user "robot"
+    // (net/robot_ws_server.h). Give each robot its own.
+    constexpr char LAN_API_KEY[] = "change-me";
+
+    // HMAC key of the UDP teleop channel (net/udp_teleop.h). Needed to
+    // build even while AppConfig::UDP_TELEOP_ENABLED is false; use a value
+    // no other key shares.
+    constexpr char UDP_TELEOP_KEY[] = "change-me";
+}
@@ -1,6 +1,7 @@
 #include "app/app.h"
 
 #include "app/backend_coordinator.h"
+#include "app/boot_sequence.h"
 #include "app/console_commander.h"
 #include "app/drive_controller.h"
 #include "app/led_controller.h"
@@ -16,6 +17,7 @@
 
 #include "net/backend_client.h"
 #include "net/backend_config.h"
+#include "net/metrics.h"
 #include "net/wifi_manager.h"
 #include "net/ws_control_client.h"
 
@@ -40,6 +42,43 @@ namespace
     ConsoleCommander console(drive, sensors, leds, audio);
     BackendCoordinator backend(state, drive, sensors, navigation, leds, audio);
 
+    constexpr float LOOP_BUCKETS_US[] = {100, 250, 500, 1000, 2000, 5000, 10000, 20000, 50000};
+    Metrics::Histogram loopDuration("robot_loop_duration_us", "Control loop pass, excluding the trailing delay",
+                                    LOOP_BUCKETS_US, sizeof(LOOP_BUCKETS_US) / sizeof(LOOP_BUCKETS_US[0]));
+
+    void writeI2cErrors(Metrics::Writer &w)
+    {
+        const SensorSuite::I2cErrors errors = sensors.i2cErrors();
+        w.family("robot_i2c_errors_total", "counter", "Failed I2C transfers per device");
+        w.sample("robot_i2c_errors_total", "device=\"bh1750\"", errors.lux);
+        w.sample("robot_i2c_errors_total", "device=\"ina226\"", errors.power);
+        w.sample("robot_i2c_errors_total", "device=\"mpu6050\"", errors.imu);
+    }
+    Metrics::Collector i2cErrors(writeI2cErrors);
+
+    void writeLedFrames(Metrics::Writer &w)
+    {
+        w.family("robot_led_frames_total", "counter", "LED strip frames by whether they changed");
+        w.sample("robot_led_frames_total", "result=\"sent\"", leds.framesSent());
+        w.sample("robot_led_frames_total", "result=\"unchanged\"", leds.framesSkipped());
+    }
+    Metrics::Collector ledFrames(writeLedFrames);
+
+    void writeTeleopLatency(Metrics::Writer &w)
+    {
+        backend.writeLatencyMetrics(w);
+    }
+    Metrics::Collector teleopLatency(writeTeleopLatency);
+
+    BootSequence boot;
+    bool peripheralsReady = false;
+
+    void writeBootMetrics(Metrics::Writer &w)
+    {
+        boot.writeMetrics(w);
+    }
+    Metrics::Collector bootMetrics(writeBootMetrics);
+
     void statusPrintTask(uint32_t nowMs)
     {
         if (nowMs - lastStatusPrintMs < 2000)
@@ -57,6 +96,35 @@ namespace
                       sensors.batteryLevel(),
                       static_cast<double>(sensors.batteryVoltage()),
                       static_cast<double>(sensors.batteryCurrentA()));
+
+        const WsControlClient::DriveStats ds = WsControlClient::driveStats();
+        if (ds.coalesced || ds.stale)
+        {
+            Serial.printf("[status] drive rx=%lu applied=%lu coalesced=%lu stale=%lu\n",
+                          static_cast<unsigned long>(ds.received),
+                          static_cast<unsigned long>(ds.applied),
+                          static_cast<unsigned long>(ds.coalesced),
+                          static_cast<unsigned long>(ds.stale));
+        }
+    }
+
+    // Only reaches the render task when something changed.
+    void ledStatusTask()
+    {
+        LedStatus status{};
+        status.obstacle = drive.obstacleFrontActive() && state.driveMode() != RobotHttpServer::DriveMode::IDLE;
+        status.lowBattery = sensors.hasPowerMonitor() && sensors.batteryLevel() < AppConfig::LED_LOW_BATTERY_PERCENT;
+        status.wsOffline = !WsControlClient::isConnected();
+        status.turn = navigation.turnDirection();
+        status.navActive = navigation.isActive();
+        status.navProgress = navigation.progress();
+        leds.setStatus(status);
+    }
+
+    float motorLoad()
+    {
+        const DriveController::Telemetry t = drive.telemetry();
+        return fmaxf(fabsf(t.leftDuty), fabsf(t.rightDuty));
     }
 
     void scanI2C()
@@ -75,43 +143,101 @@ namespace
         if (!count)
             Serial.println("[i2c] no devices found");
     }
-}
 
-namespace App
-{
-    void setup()
-    {
-        Serial.begin(AppConfig::SERIAL_BAUD);
-        delay(50);
-        BackendClient::begin();
+    // Inline stages: everything needed to drive and to get on the network.
 
-        const uint32_t bootMs = millis();
-        drive.begin(bootMs);
+    bool bootDrive()
+    {
+        drive.begin(millis());
+        sensors.beginIr();
+        return true;
+    }
 
+    bool bootConsole()
+    {
         console.begin();
+        return true;
+    }
 
-        sensors.beginIr();
+    bool bootLeds()
+    {
+        return leds.begin();
+    }
+
+    bool bootAudio()
+    {
+        const bool aok = audio.begin();
+        Serial.printf("[audio] init %s\n", aok ? "ok" : "fail");
+        Metrics::trackTask(audio.taskHandle());
+        audio.setVolume(0.20f);
+        return aok;
+    }
+
+    bool bootNavigation()
+    {
+        navigation.begin();
+        return true;
+    }
+
+    bool bootWifi()
+    {
+        // Joins in the background; the backend registers once it is up.
+        WifiManager::begin(Secrets::WIFI_SSID, Secrets::WIFI_PASS);
+        return true;
+    }
+
+    bool bootBackend()
+    {
+        BackendClient::begin();
+        backend.begin();
+        return true;
+    }
+
+    // Deferred stages: bus peripherals, one per loop pass.
 
+    bool bootI2c()
+    {
         Wire.begin(static_cast<int>(BoardPins::I2C_SDA), static_cast<int>(BoardPins::I2C_SCL));
         Wire.setClock(100000);
         delay(50);
 
-        scanI2C();
+        if (AppConfig::BOOT_I2C_SCAN)
+            scanI2C();
+        return true;
+    }
 
+    bool bootOled()
+    {
         const bool dok = oled.begin();
         Serial.printf("[oled] init %s (addr=0x%02X)\n", dok ? "ok" : "fail", BoardPins::OLED_I2C_ADDRESS);
         if (dok)
             oled.bootScreen();
+        return dok;
+    }
 
+    bool bootLux()
+    {
         const bool lok = sensors.beginLux();
         Serial.printf("[bh1750] init %s (addr=0x%02X)\n", lok ? "ok" : "fail", BoardPins::BH1750_I2C_ADDRESS);
+        return lok;
+    }
 
+    bool bootPower()
+    {
         const bool pok = sensors.beginPowerMonitor();
         Serial.printf("[ina226] init %s (addr=0x%02X)\n", pok ? "ok" : "fail", BoardPins::INA226_I2C_ADDRESS);
+        return pok;
+    }
 
+    bool bootImu()
+    {
         const bool mok = sensors.beginImu();
         Serial.printf("[mpu6050] init %s (addr=0x%02X)\n", mok ? "ok" : "fail", sensors.imuAddress());
+        return mok;
+    }
 
+    bool bootRfid()
+    {
         const bool rok = sensors.beginRfid();
         Serial.printf("[rc522] init %s (ver=0x%02X ss=%d rst=%d sck=%d miso=%d mosi=%d)\n",
                       rok ? "ok" : "fail",
@@ -121,51 +247,74 @@ namespace App
                       static_cast<int>(BoardPins::RC522_SCK),
                       static_cast<int>(BoardPins::RC522_MISO),
                       static_cast<int>(BoardPins::RC522_MOSI));
+        return rok;
+    }
+}
 
-        leds.begin();
-
-        navigation.begin();
-
-        const bool aok = audio.begin();
-        Serial.printf("[audio] init %s\n", aok ? "ok" : "fail");
-        audio.setVolume(0.20f);
-
-        const bool wok = WifiManager::begin(Secrets::WIFI_SSID, Secrets::WIFI_PASS, 15000);
-        Serial.printf("[wifi] %s ip=%s\n", wok ? "connected" : "failed", WifiManager::ip().c_str());
-
-        backend.begin();
-
-        if (wok)
-        {
-            backend.registerTask(millis());
-            backend.pushState();
-        }
+namespace App
+{
+    void setup()
+    {
+        Serial.begin(AppConfig::SERIAL_BAUD);
+        delay(50);
+        Metrics::trackTask(xTaskGetCurrentTaskHandle());
+
+        boot.run("drive", bootDrive);
+        boot.run("console", bootConsole);
+        boot.run("leds", bootLeds);
+        boot.run("audio", bootAudio);
+        boot.run("navigation", bootNavigation);
+        boot.run("wifi", bootWifi);
+        boot.run("backend", bootBackend);
+
+        boot.defer("i2c", bootI2c);
+        boot.defer("oled", bootOled);
+        boot.defer("lux", bootLux);
+        boot.defer("power", bootPower);
+        boot.defer("imu", bootImu);
+        boot.defer("rfid", bootRfid);
 
         Serial.println("[boot] motors + IR(front) + BH1750 + INA226 + MPU-6050 + RC522 + WS2812B + I2S audio + OLED + backend ws/http");
         Serial.println("[boot] obstacle policy: blocks FORWARD, reverse allowed");
         console.printHelp();
+        boot.milestone("drivable");
     }
 
     void loop()
     {
+        const uint32_t startUs = micros();
         const uint32_t nowMs = millis();
 
+        if (!peripheralsReady && !boot.step())
+        {
+            peripheralsReady = true;
+            boot.milestone("peripherals");
+        }
+
+        WifiManager::loop(nowMs);
         backend.handle();
 
         statusPrintTask(nowMs);
 
         sensors.update(nowMs);
         navigation.update(nowMs);
-        oled.update(nowMs);
-        leds.autoTask();
+        // Its recovery path would probe the bus before the I2C stage ran.
+        if (peripheralsReady)
+            oled.update(nowMs);
+        leds.autoTask(nowMs);
+        ledStatusTask();
+        leds.powerTask(nowMs, motorLoad());
 
         console.handle();
         drive.update(nowMs, state.driveMode());
+        backend.driveAckTask(nowMs);
 
-        backend.registerTask(nowMs);
         backend.stateTask(nowMs);
         backend.eventTask(nowMs);
+        backend.telemetryTask(nowMs);
+        backend.httpStatusTask(nowMs);
 
+        loopDuration.observe(static_cast<float>(micros() - startUs));
         delay(1);
     }
 }
@@ -4,11 +4,38 @@
 #include "app_config.h"
 #include "net/backend_client.h"
 #include "net/backend_config.h"
+#include "net/link_monitor.h"
+#include "net/metrics.h"
 #include "net/robot_http_server.h"
+#include "net/robot_ws_server.h"
+#include "net/telemetry_stream.h"
+#include "net/udp_teleop.h"
 #include "net/wifi_manager.h"
 #include "net/ws_control_client.h"
 
 #include <cmath>
+#include <cstring>
+
+namespace
+{
+    // Cumulative since boot; the rolling LatencyHistograms only feed the
+    // windowed percentile gauges.
+    constexpr float TELEOP_LATENCY_BUCKETS_US[] = {500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000};
+    Metrics::Histogram g_rxToDispatch("robot_teleop_rx_to_dispatch_us", "Receive to control-task dispatch of a drive command",
+                                      TELEOP_LATENCY_BUCKETS_US, sizeof(TELEOP_LATENCY_BUCKETS_US) / sizeof(TELEOP_LATENCY_BUCKETS_US[0]));
+    Metrics::Histogram g_rxToApply("robot_teleop_rx_to_apply_us", "Receive to first PWM write of a drive command",
+                                   TELEOP_LATENCY_BUCKETS_US, sizeof(TELEOP_LATENCY_BUCKETS_US) / sizeof(TELEOP_LATENCY_BUCKETS_US[0]));
+
+    void writeLatencyWindow(Metrics::Writer &w, LatencyHistogram &latency, const char *name, const char *help, uint32_t nowMs)
+    {
+        const LatencyHistogram::Summary s = latency.summary(nowMs);
+        w.family(name, "gauge", help);
+        w.sample(name, "quantile=\"0.5\"", s.p50Us);
+        w.sample(name, "quantile=\"0.9\"", s.p90Us);
+        w.sample(name, "quantile=\"0.99\"", s.p99Us);
+        w.sample(name, "quantile=\"1\"", s.maxUs);
+    }
+}
 
 BackendCoordinator::BackendCoordinator(RobotState &stateRef, DriveController &driveRef, SensorSuite &sensorsRef, NavigationController &navigationRef, LedController &ledsRef, I2sAudio &audioRef)
     : state(stateRef),
@@ -17,13 +44,24 @@ BackendCoordinator::BackendCoordinator(RobotState &stateRef, DriveController &dr
       navigation(navigationRef),
       leds(ledsRef),
       audio(audioRef),
-      lastBackendRegisterMs(0),
       lastBackendStateMs(0),
       lastBackendEventMs(0),
       stateDirty(false),
       stateUrgent(false),
+      currentState{},
+      lastQueuedState{},
+      hasQueuedState(false),
       eventPending(false),
-      pendingEvent("")
+      pendingEvent(""),
+      rxToDispatchLatency(AppConfig::TELEOP_LATENCY_WINDOW_MS),
+      rxToApplyLatency(AppConfig::TELEOP_LATENCY_WINDOW_MS),
+      telemetryState{},
+      pendingDriveAck{},
+      driveAckBaseApplyUs(0),
+      driveAckPending(false),
+      lastHttpStatusMs(0),
+      httpStatusDirty(false),
+      httpStatusState{}
 {
 }
 
@@ -32,48 +70,26 @@ void BackendCoordinator::begin()
     navigation.setStateChangedCallback([this]()
                                        { pushState(); });
 
-    RobotHttpServer::begin(
-        BackendConfig::ROBOT_PORT,
-        [this]() -> RobotHttpServer::StatusSnapshot
+    WifiManager::setHandlers(WifiManager::Handlers{
+        .onConnected = [this]()
         {
-            RobotHttpServer::StatusSnapshot s{};
-            s.systemHealth = "OK";
-            s.batteryLevel = sensors.batteryLevel();
-            s.driveMode = state.driveMode();
-            s.cargoStatus = "EMPTY";
-
-            s.lastRouteStart = state.lastRouteStart().length() ? state.lastRouteStart().c_str() : nullptr;
-            s.lastRouteEnd = state.lastRouteEnd().length() ? state.lastRouteEnd().c_str() : nullptr;
-            s.position = state.position().length() ? state.position().c_str() : nullptr;
-            s.currentNode = state.currentNode().length() ? state.currentNode().c_str() : nullptr;
-            s.targetNode = state.targetNode().length() ? state.targetNode().c_str() : nullptr;
-            s.navigationStatus = state.navigationStatus().length() ? state.navigationStatus().c_str() : "IDLE";
-
-            s.irLeft = sensors.isIrLeftObstacle();
-            s.irMid = sensors.isIrMidObstacle();
-            s.irRight = sensors.isIrRightObstacle();
-
-            s.luxValid = sensors.hasLux();
-            s.lux = s.luxValid ? sensors.lux() : 0.0f;
-
-            s.powerValid = sensors.hasPowerMonitor();
-            s.batteryVoltage = s.powerValid ? sensors.batteryVoltage() : 0.0f;
-            s.batteryCurrentA = s.powerValid ? sensors.batteryCurrentA() : 0.0f;
-            s.batteryPowerW = s.powerValid ? sensors.batteryPowerW() : 0.0f;
-
-            s.gyroValid = sensors.hasImu();
-            s.gyroXDps = s.gyroValid ? sensors.imu().gyro_x_dps : 0.0f;
-            s.gyroYDps = s.gyroValid ? sensors.imu().gyro_y_dps : 0.0f;
-            s.gyroZDps = s.gyroValid ? sensors.imu().gyro_z_dps : 0.0f;
-
-            s.lastReadUuid = sensors.hasRfid() ? sensors.rfid().uid_hex.c_str() : nullptr;
-
-            s.ledEnabled = leds.isEnabled();
-            s.ledAutoEnabled = leds.isAutoEnabled();
-
-            s.audioVolume = audio.volume();
-            return s;
+            // Register once per link-up and follow up with the full state.
+            // The backend keeps a registration until the robot registers
+            // again, and the state heartbeat already shows it is alive, so
+            // there is no periodic refresh. The worker retries a register
+            // that failed or was refused.
+            BackendClient::queueRegisterRobot(BackendConfig::ROBOT_PORT);
+            hasQueuedState = false;
+            pushState();
+            LinkMonitor::start();
         },
+        .onDisconnected = [](uint8_t)
+        {
+            LinkMonitor::stop();
+        }});
+
+    RobotHttpServer::begin(
+        BackendConfig::ROBOT_PORT,
         [this](RobotHttpServer::DriveMode m)
         {
             if (m == RobotHttpServer::DriveMode::MANUAL)
@@ -102,46 +118,31 @@ void BackendCoordinator::begin()
             return accepted;
         });
 
-    WsControlClient::begin(
-        WsControlClient::Handlers{
+    const ControlCommands::Handlers commandHandlers{
             .onConnected = [this]()
             {
                 pushState();
             },
             .onDisconnected = []() {},
-            .onNavigate = [this](const String &startNode, const String &destNode)
+            .onNavigate = [this](const char *startNode, const char *destNode)
             {
                 String error;
                 if (!navigation.requestNavigation(startNode, destNode, &error))
                 {
                     Serial.printf("[ws] NAVIGATE rejected %s -> %s (%s)\n",
-                                  startNode.c_str(),
-                                  destNode.c_str(),
+                                  startNode,
+                                  destNode,
                                   error.c_str());
                     return;
                 }
 
-                Serial.printf("[ws] NAVIGATE %s -> %s\n", startNode.c_str(), destNode.c_str());
-                pendingEvent = "START_BUTTON_PRESSED";
-                eventPending = true;
+                Serial.printf("[ws] NAVIGATE %s -> %s\n", startNode, destNode);
+                raiseEvent("START_BUTTON_PRESSED");
                 pushState();
             },
-            .onDriveCommand = [this](float linear, float angular)
+            .onDriveCommand = [this](const WsControlClient::DriveCommand &cmd)
             {
-                navigation.cancel("IDLE");
-                state.setDriveMode(RobotHttpServer::DriveMode::MANUAL);
-
-                if (!std::isfinite(linear))
-                    linear = 0.0f;
-                if (!std::isfinite(angular))
-                    angular = 0.0f;
-
-                linear = clampf(linear, -1.0f, 1.0f);
-                angular = clampf(angular, -1.0f, 1.0f);
-
-                drive.setTargets(linear, angular, false);
-
-                pushState();
+                handleDriveCommand(cmd);
             },
             .onLed = [this](bool enabled, uint8_t r, uint8_t g, uint8_t b, uint8_t brightness)
             {
@@ -160,15 +161,32 @@ void BackendCoordinator::begin()
                               static_cast<unsigned>(b),
                               static_cast<unsigned>(scaledBrightness));
             },
-            .onAudioBeep = [this](uint32_t hz, uint32_t ms)
+            .onLedPattern = [this](const ControlCommands::LedPatternCommand &cmd)
+            {
+                String error;
+                if (!handleLedPattern(cmd, error))
+                    Serial.printf("[ws] LED_PATTERN rejected (%s)\n", error.c_str());
+            },
+            .onAudioBeep = [this](uint32_t hz, uint32_t ms, bool queue)
             {
+                if (hz == 0 || ms == 0)
+                {
+                    audio.stop();
+                    Serial.println("[ws] AUDIO_BEEP stop");
+                    return;
+                }
+
                 hz = static_cast<uint32_t>(clampf(static_cast<float>(hz), 20.0f, 20000.0f));
                 ms = static_cast<uint32_t>(clampf(static_cast<float>(ms), 10.0f, 5000.0f));
 
-                audio.playBeep(static_cast<uint16_t>(hz), static_cast<uint16_t>(ms));
-                Serial.printf("[ws] AUDIO_BEEP hz=%lu ms=%lu\n",
+                // Returns at once; the audio task plays it.
+                const bool queued = audio.playBeep(static_cast<uint16_t>(hz), static_cast<uint16_t>(ms),
+                                                   queue ? I2sAudio::Mode::Queue : I2sAudio::Mode::Preempt);
+                Serial.printf("[ws] AUDIO_BEEP hz=%lu ms=%lu%s%s\n",
                               static_cast<unsigned long>(hz),
-                              static_cast<unsigned long>(ms));
+                              static_cast<unsigned long>(ms),
+                              queue ? " queued" : "",
+                              queued ? "" : " (dropped, queue full)");
             },
             .onAudioVolume = [this](float value)
             {
@@ -178,60 +196,288 @@ void BackendCoordinator::begin()
             },
             .onStop = [this]()
             {
-                navigation.cancel("IDLE");
-                state.setDriveMode(RobotHttpServer::DriveMode::IDLE);
-
-                Serial.println("[ws] STOP");
-                pushState();
+                handleStop("ws");
             },
-            .onSetMode = [this](const String &mode)
+            .onSetMode = [this](const char *mode)
             {
-                if (mode == "IDLE")
+                if (strcmp(mode, "IDLE") == 0)
                 {
                     navigation.cancel("IDLE");
                     state.setDriveMode(RobotHttpServer::DriveMode::IDLE);
                 }
-                else if (mode == "MANUAL")
+                else if (strcmp(mode, "MANUAL") == 0)
                 {
                     navigation.cancel("IDLE");
                     state.setDriveMode(RobotHttpServer::DriveMode::MANUAL);
                 }
-                else if (mode == "AUTO")
+                else if (strcmp(mode, "AUTO") == 0)
                 {
                     state.setDriveMode(RobotHttpServer::DriveMode::AUTO);
                 }
 
-                Serial.printf("[ws] SET_MODE %s\n", mode.c_str());
+                Serial.printf("[ws] SET_MODE %s\n", mode);
                 pushState();
             },
-            .onUnknownCommand = [](const String &cmd, const JsonDocument &)
-            { Serial.printf("[ws] unknown command: %s\n", cmd.c_str()); }});
+            .onUnknownCommand = [](const char *cmd)
+            { Serial.printf("[ws] unknown command: %s\n", cmd); }};
+
+    // The backend relay and the LAN server share one command set and one set
+    // of handlers; both are dispatched on this (the control) task.
+    WsControlClient::begin(commandHandlers);
+    RobotWsServer::begin(BackendConfig::ROBOT_WS_PORT, commandHandlers);
+
+    if (AppConfig::UDP_TELEOP_ENABLED)
+    {
+        UdpTeleop::begin(
+            BackendConfig::UDP_TELEOP_PORT,
+            UdpTeleop::Handlers{
+                .onDrive = [this](float throttle, float steer, uint32_t rxUs)
+                {
+                    // Untagged, so it is measured but not acked over WS.
+                    ControlCommands::DriveCommand cmd{};
+                    cmd.source = ControlCommands::Source::Udp;
+                    cmd.linearVelocity = throttle;
+                    cmd.angularVelocity = steer;
+                    cmd.rxUs = rxUs;
+                    handleDriveCommand(cmd);
+                },
+                .onStop = [this]()
+                {
+                    handleStop("udp-teleop");
+                }});
+    }
+
+    RobotHttpServer::setLedPatternSetter([this](const ControlCommands::LedPatternCommand &cmd, String &error) -> bool
+                                         { return handleLedPattern(cmd, error); });
+}
+
+void BackendCoordinator::handleDriveCommand(const ControlCommands::DriveCommand &cmd)
+{
+    const uint32_t dispatchUs = micros();
+    const uint32_t latencyUs = dispatchUs - cmd.rxUs;
+    g_rxToDispatch.observe(static_cast<float>(latencyUs));
+    rxToDispatchLatency.record(latencyUs, millis());
+
+    if (driveAckPending)
+        finishDriveAck(millis());
+
+    pendingDriveAck.command = cmd;
+    pendingDriveAck.dispatchUs = dispatchUs;
+    pendingDriveAck.applyUs = 0;
+    pendingDriveAck.applied = false;
+    driveAckBaseApplyUs = drive.lastApplyUs();
+    driveAckPending = true;
+
+    // Joystick frames stream continuously; only the first one of a
+    // manual session changes mode or interrupts navigation.
+    const bool modeChanged = navigation.isActive() || state.driveMode() != RobotHttpServer::DriveMode::MANUAL;
+    if (modeChanged)
+    {
+        navigation.cancel("IDLE");
+        state.setDriveMode(RobotHttpServer::DriveMode::MANUAL);
+    }
+
+    float linear = cmd.linearVelocity;
+    float angular = cmd.angularVelocity;
+
+    if (!std::isfinite(linear))
+        linear = 0.0f;
+    if (!std::isfinite(angular))
+        angular = 0.0f;
+
+    linear = clampf(linear, -1.0f, 1.0f);
+    angular = clampf(angular, -1.0f, 1.0f);
+
+    drive.setTargets(linear, angular, false);
+
+    if (modeChanged)
+        pushState();
+}
+
+bool BackendCoordinator::handleLedPattern(const ControlCommands::LedPatternCommand &cmd, String &error)
+{
+    LedPattern pattern;
+    if (!LedController::patternFromName(cmd.pattern, pattern))
+    {
+        error = "unknown pattern";
+        return false;
+    }
+
+    if (pattern != LedPattern::Count)
+    {
+        LedPatternParams params = leds.patternParams(pattern);
+        if (cmd.hasColor)
+        {
+            params.r = cmd.r;
+            params.g = cmd.g;
+            params.b = cmd.b;
+        }
+        if (cmd.hasWidth)
+            params.width = cmd.width;
+        if (cmd.hasPeriod)
+            params.periodMs = cmd.periodMs;
+        leds.setPatternParams(pattern, params);
+    }
+
+    if (cmd.select)
+        leds.selectPattern(pattern);
+    leds.apply();
+
+    Serial.printf("[led] pattern %s%s\n", LedController::patternName(pattern), cmd.select ? " selected" : " updated");
+    return true;
+}
+
+void BackendCoordinator::handleStop(const char *source)
+{
+    navigation.cancel("IDLE");
+    state.setDriveMode(RobotHttpServer::DriveMode::IDLE);
+
+    Serial.printf("[%s] STOP\n", source);
+    pushState();
+}
+
+void BackendCoordinator::driveAckTask(uint32_t nowMs)
+{
+    if (!driveAckPending)
+        return;
+
+    if (drive.lastApplyUs() == driveAckBaseApplyUs &&
+        (micros() - pendingDriveAck.dispatchUs) < AppConfig::DRIVE_ACK_TIMEOUT_MS * 1000UL)
+        return;
+
+    finishDriveAck(nowMs);
+}
+
+void BackendCoordinator::finishDriveAck(uint32_t nowMs)
+{
+    driveAckPending = false;
+
+    // A duty change since dispatch is attributed to this command; without one
+    // (same setpoint, or superseded before the next drive tick) it is acked unapplied.
+    const uint32_t applyUs = drive.lastApplyUs();
+    if (applyUs != driveAckBaseApplyUs)
+    {
+        pendingDriveAck.applied = true;
+        pendingDriveAck.applyUs = applyUs;
+        const uint32_t latencyUs = applyUs - pendingDriveAck.command.rxUs;
+        g_rxToApply.observe(static_cast<float>(latencyUs));
+        rxToApplyLatency.record(latencyUs, nowMs);
+    }
+
+    // Only senders that tag their frames can correlate an ack.
+    if (!pendingDriveAck.command.hasSeq && !pendingDriveAck.command.hasTs)
+        return;
+
+    switch (pendingDriveAck.command.source)
+    {
+    case ControlCommands::Source::Backend:
+        WsControlClient::sendDriveAck(pendingDriveAck);
+        break;
+    case ControlCommands::Source::Lan:
+        RobotWsServer::sendDriveAck(pendingDriveAck.command.clientId, pendingDriveAck);
+        break;
+    case ControlCommands::Source::Udp:
+        break;
+    }
+}
+
+void BackendCoordinator::writeLatencyMetrics(Metrics::Writer &w)
+{
+    const uint32_t nowMs = millis();
+    writeLatencyWindow(w, rxToDispatchLatency, "robot_teleop_rx_to_dispatch_window_us",
+                       "Receive to dispatch of a drive command, percentiles over the rolling window", nowMs);
+    writeLatencyWindow(w, rxToApplyLatency, "robot_teleop_rx_to_apply_window_us",
+                       "Receive to first PWM write of a drive command, percentiles over the rolling window", nowMs);
 }
 
 void BackendCoordinator::handle()
 {
     RobotHttpServer::handle();
     WsControlClient::loop();
+    RobotWsServer::loop();
+    UdpTeleop::poll();
 }
 
-void BackendCoordinator::registerTask(uint32_t nowMs)
+void BackendCoordinator::telemetryTask(uint32_t nowMs)
 {
-    if (!WifiManager::isConnected())
-        return;
+    if (RobotWsServer::wantsState(nowMs))
+    {
+        captureState(telemetryState);
+        RobotWsServer::publishState(telemetryState, nowMs);
+    }
 
-    if (lastBackendRegisterMs != 0 && (nowMs - lastBackendRegisterMs) < 30000)
-        return;
+    sampleTelemetryChannels();
+    TelemetryStream::flush(nowMs);
+}
 
-    if (!BackendClient::queueRegisterRobot(BackendConfig::ROBOT_PORT))
+void BackendCoordinator::httpStatusTask(uint32_t nowMs)
+{
+    // A pushed change goes out on this pass so long-polls and /events see
+    // it within a loop iteration; sensor drift is picked up by the refresh.
+    if (!httpStatusDirty && (nowMs - lastHttpStatusMs) < AppConfig::HTTP_STATUS_REFRESH_MS)
         return;
+    lastHttpStatusMs = nowMs;
+    httpStatusDirty = false;
 
-    lastBackendRegisterMs = nowMs;
+    captureState(httpStatusState);
+    RobotHttpServer::publishStatus(httpStatusState);
+}
+
+void BackendCoordinator::sampleTelemetryChannels()
+{
+    using TelemetryStream::Channel;
+
+    sensors.setFastSampling(TelemetryStream::active(Channel::Imu), TelemetryStream::active(Channel::Power));
+
+    const uint32_t nowUs = micros();
+
+    if (TelemetryStream::due(Channel::Imu, nowUs) && sensors.hasImu())
+    {
+        const Mpu6050Sensor::Reading &imu = sensors.imu();
+        const float values[] = {imu.gyro_x_dps, imu.gyro_y_dps, imu.gyro_z_dps, imu.accel_x_g, imu.accel_y_g, imu.accel_z_g};
+        TelemetryStream::offer(Channel::Imu, values, nowUs);
+    }
+
+    if (TelemetryStream::due(Channel::Motor, nowUs))
+    {
+        const DriveController::Telemetry d = drive.telemetry();
+        const float values[] = {d.leftDuty, d.rightDuty, d.targetThrottle, d.targetSteer, d.smoothedThrottle, d.smoothedSteer};
+        TelemetryStream::offer(Channel::Motor, values, nowUs);
+    }
+
+    if (TelemetryStream::due(Channel::Power, nowUs) && sensors.hasPowerMonitor())
+    {
+        const float values[] = {sensors.batteryVoltage(), sensors.batteryCurrentA(), sensors.batteryPowerW()};
+        TelemetryStream::offer(Channel::Power, values, nowUs);
+    }
+
+    if (TelemetryStream::due(Channel::Light, nowUs) && sensors.hasLux())
+    {
+        const float values[] = {sensors.lux()};
+        TelemetryStream::offer(Channel::Light, values, nowUs);
+    }
+
+    if (TelemetryStream::due(Channel::Ir, nowUs))
+    {
+        const float values[] = {sensors.isIrLeftObstacle() ? 1.0f : 0.0f,
+                                sensors.isIrMidObstacle() ? 1.0f : 0.0f,
+                                sensors.isIrRightObstacle() ? 1.0f : 0.0f};
+        TelemetryStream::offer(Channel::Ir, values, nowUs);
+    }
 }
 
 void BackendCoordinator::pushState()
 {
     stateDirty = true;
     stateUrgent = true;
+    httpStatusDirty = true;
+}
+
+void BackendCoordinator::raiseEvent(const char *name)
+{
+    pendingEvent = name;
+    eventPending = true;
+    RobotHttpServer::publishEvent(name);
 }
 
 void BackendCoordinator::stateTask(uint32_t nowMs)
@@ -239,8 +485,12 @@ void BackendCoordinator::stateTask(uint32_t nowMs)
     if (!WifiManager::isConnected())
         return;
 
-    const bool heartbeatDue = (nowMs - lastBackendStateMs) >= AppConfig::BACKEND_STATE_HEARTBEAT_MS;
-    const bool minGapMet = (nowMs - lastBackendStateMs) >= AppConfig::BACKEND_STATE_MIN_GAP_MS;
+    uint32_t heartbeatMs = AppConfig::BACKEND_STATE_HEARTBEAT_MS;
+    uint32_t minGapMs = AppConfig::BACKEND_STATE_MIN_GAP_MS;
+    stateTiming(LinkMonitor::quality(), heartbeatMs, minGapMs);
+
+    const bool heartbeatDue = (nowMs - lastBackendStateMs) >= heartbeatMs;
+    const bool minGapMet = (nowMs - lastBackendStateMs) >= minGapMs;
 
     if (!stateDirty && !heartbeatDue)
         return;
@@ -248,39 +498,87 @@ void BackendCoordinator::stateTask(uint32_t nowMs)
     if (stateUrgent && !minGapMet)
         return;
 
-    if (!BackendClient::queueState(
-            "OK",
-            sensors.batteryLevel(),
-            state.driveModeToBackend(),
-            "EMPTY",
-            state.position().length() ? state.position() : String(""),
-            state.currentNode().length() ? state.currentNode() : String(""),
-            state.targetNode().length() ? state.targetNode() : String(""),
-            sensors.hasImu(),
-            sensors.hasImu() ? sensors.imu().gyro_x_dps : 0.0f,
-            sensors.hasImu() ? sensors.imu().gyro_y_dps : 0.0f,
-            sensors.hasImu() ? sensors.imu().gyro_z_dps : 0.0f,
-            sensors.hasRfid(),
-            sensors.hasRfid() ? sensors.rfid().uid_hex : String(""),
-            sensors.hasLux(),
-            sensors.hasLux() ? sensors.lux() : 0.0f,
-            true,
-            sensors.isIrMidObstacle(),
-            sensors.isIrLeftObstacle(),
-            sensors.isIrRightObstacle(),
-            sensors.hasPowerMonitor(),
-            sensors.hasPowerMonitor() ? sensors.batteryVoltage() : 0.0f,
-            sensors.hasPowerMonitor() ? sensors.batteryCurrentA() : 0.0f,
-            sensors.hasPowerMonitor() ? sensors.batteryPowerW() : 0.0f))
+    captureState(currentState);
+
+    // A push with nothing new to report is answered by the heartbeat instead.
+    if (!heartbeatDue && hasQueuedState && StateSchema::diff(currentState, lastQueuedState) == 0)
     {
+        stateDirty = false;
+        stateUrgent = false;
         return;
     }
 
+    if (!BackendClient::queueState(currentState))
+        return;
+
+    lastQueuedState = currentState;
+    hasQueuedState = true;
     lastBackendStateMs = nowMs;
     stateDirty = false;
     stateUrgent = false;
 }
 
+void BackendCoordinator::stateTiming(LinkMonitor::Quality quality, uint32_t &heartbeatMs, uint32_t &minGapMs)
+{
+    // A struggling link gets fewer, fuller updates: urgent pushes coalesce
+    // over a longer gap instead of queueing behind retransmits.
+    switch (quality)
+    {
+    case LinkMonitor::Quality::Degraded:
+        minGapMs = minGapMs * 2;
+        break;
+    case LinkMonitor::Quality::Poor:
+    case LinkMonitor::Quality::Down:
+        heartbeatMs = heartbeatMs * 2;
+        minGapMs = minGapMs * 5;
+        break;
+    default:
+        break;
+    }
+}
+
+void BackendCoordinator::captureState(StateSchema::Snapshot &s) const
+{
+    StateSchema::copyText(s.systemHealth, sizeof(s.systemHealth), "OK");
+    s.batteryLevel = sensors.batteryLevel();
+    StateSchema::copyText(s.driveMode, sizeof(s.driveMode), RobotHttpServer::driveModeName(state.driveMode()));
+    StateSchema::copyText(s.backendDriveMode, sizeof(s.backendDriveMode), state.driveModeToBackend());
+    StateSchema::copyText(s.cargoStatus, sizeof(s.cargoStatus), "EMPTY");
+
+    StateSchema::copyText(s.lastRouteStart, sizeof(s.lastRouteStart), state.lastRouteStart().c_str());
+    StateSchema::copyText(s.lastRouteEnd, sizeof(s.lastRouteEnd), state.lastRouteEnd().c_str());
+    StateSchema::copyText(s.position, sizeof(s.position), state.position().c_str());
+    StateSchema::copyText(s.currentNode, sizeof(s.currentNode), state.currentNode().c_str());
+    StateSchema::copyText(s.targetNode, sizeof(s.targetNode), state.targetNode().c_str());
+    StateSchema::copyText(s.navigationStatus, sizeof(s.navigationStatus),
+                          state.navigationStatus().length() ? state.navigationStatus().c_str() : "IDLE");
+
+    s.irLeft = sensors.isIrLeftObstacle();
+    s.irMid = sensors.isIrMidObstacle();
+    s.irRight = sensors.isIrRightObstacle();
+
+    s.luxValid = sensors.hasLux();
+    s.lux = s.luxValid ? sensors.lux() : 0.0f;
+
+    s.powerValid = sensors.hasPowerMonitor();
+    s.batteryVoltage = s.powerValid ? sensors.batteryVoltage() : 0.0f;
+    s.batteryCurrentA = s.powerValid ? sensors.batteryCurrentA() : 0.0f;
+    s.batteryPowerW = s.powerValid ? sensors.batteryPowerW() : 0.0f;
+
+    s.gyroValid = sensors.hasImu();
+    s.gyroXDps = s.gyroValid ? sensors.imu().gyro_x_dps : 0.0f;
+    s.gyroYDps = s.gyroValid ? sensors.imu().gyro_y_dps : 0.0f;
+    s.gyroZDps = s.gyroValid ? sensors.imu().gyro_z_dps : 0.0f;
+
+    s.rfidValid = sensors.hasRfid();
+    StateSchema::copyText(s.lastReadUuid, sizeof(s.lastReadUuid), s.rfidValid ? sensors.rfid().uid_hex.c_str() : "");
+
+    s.ledEnabled = leds.isEnabled();
+    s.ledAutoEnabled = leds.isAutoEnabled();
+
+    s.audioVolume = audio.volume();
+}
+
 void BackendCoordinator::eventTask(uint32_t nowMs)
 {
     if (!WifiManager::isConnected())
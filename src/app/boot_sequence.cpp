@@ -0,0 +1,85 @@
+#include "app/boot_sequence.h"
+
+BootSequence::BootSequence()
+    : stages{},
+      stageCount(0),
+      nextStage(0),
+      milestones{},
+      milestoneCount(0)
+{
+}
+
+bool BootSequence::run(const char *name, StageFn fn)
+{
+    if (stageCount >= MAX_STAGES)
+        return fn();
+
+    Stage &stage = stages[stageCount++];
+    stage = Stage{name, fn, 0, false, false};
+    return execute(stage);
+}
+
+void BootSequence::defer(const char *name, StageFn fn)
+{
+    if (stageCount >= MAX_STAGES)
+    {
+        Serial.printf("[boot] too many stages, running %s now\n", name);
+        fn();
+        return;
+    }
+
+    stages[stageCount++] = Stage{name, fn, 0, false, false};
+}
+
+bool BootSequence::step()
+{
+    while (nextStage < stageCount && stages[nextStage].ran)
+        ++nextStage;
+
+    if (nextStage >= stageCount)
+        return false;
+
+    execute(stages[nextStage++]);
+    return true;
+}
+
+void BootSequence::milestone(const char *name)
+{
+    const uint32_t nowMs = millis();
+    Serial.printf("[boot] %s after %lu ms\n", name, static_cast<unsigned long>(nowMs));
+
+    if (milestoneCount < MAX_MILESTONES)
+        milestones[milestoneCount++] = Milestone{name, nowMs};
+}
+
+void BootSequence::writeMetrics(Metrics::Writer &w) const
+{
+    w.family("robot_boot_stage_ms", "gauge", "Time spent in each boot stage");
+    for (uint8_t i = 0; i < stageCount; ++i)
+    {
+        const Stage &stage = stages[i];
+        if (stage.ran)
+            w.printf("robot_boot_stage_ms{stage=\"%s\",ok=\"%d\"} %lu\n",
+                     stage.name, stage.ok ? 1 : 0, static_cast<unsigned long>(stage.durationMs));
+    }
+
+    if (milestoneCount == 0)
+        return;
+
+    w.family("robot_boot_milestone_ms", "gauge", "Milliseconds from power-on to each boot milestone");
+    for (uint8_t i = 0; i < milestoneCount; ++i)
+        w.printf("robot_boot_milestone_ms{milestone=\"%s\"} %lu\n",
+                 milestones[i].name, static_cast<unsigned long>(milestones[i].atMs));
+}
+
+bool BootSequence::execute(Stage &stage)
+{
+    const uint32_t startMs = millis();
+    stage.ok = stage.fn();
+    stage.durationMs = millis() - startMs;
+    stage.ran = true;
+
+    Serial.printf("[boot] %s %s in %lu ms\n", stage.name, stage.ok ? "ok" : "failed",
+                  static_cast<unsigned long>(stage.durationMs));
+    return stage.ok;
+}
@@ -2,7 +2,12 @@
 
 #include "app/app_utils.h"
 #include "net/backend_config.h"
+#include "net/fault_injection.h"
+#include "net/link_monitor.h"
+#include "net/robot_http_server.h"
+#include "net/robot_ws_server.h"
 #include "net/wifi_manager.h"
+#include "net/ws_control_client.h"
 
 ConsoleCommander::ConsoleCommander(DriveController &driveRef, SensorSuite &sensorsRef, LedController &ledsRef, I2sAudio &audioRef)
     : drive(driveRef), sensors(sensorsRef), leds(ledsRef), audio(audioRef)
@@ -38,10 +43,14 @@ void ConsoleCommander::printHelp()
     Serial.println("  ledauto on|off             - enable/disable auto LED control");
     Serial.println("  ledcolor <r> <g> <b>       - set LED color (0..255)");
     Serial.println("  ledbri <x>                 - set LED brightness (0..255)");
+    Serial.println("  ledpattern <name>|auto     - pin an LED pattern (SOLID, TURN, ...)");
     Serial.println("  vol <0..100>               - set audio volume percent");
     Serial.println("  beep                       - play short test beep");
     Serial.println("  beep <hz> <ms>             - play beep with frequency and duration");
-    Serial.println("  backendping                - ICMP ping backend host");
+    Serial.println("  beep stop                  - cut the current sound");
+    Serial.println("  backendping                - backend link RTT/jitter/loss (background ICMP)");
+    Serial.println("  jsonpool                   - JSON pool usage and heap fallbacks");
+    Serial.println("  faults on|off              - scripted network faults (NET_FAULT_INJECTION builds)");
 }
 
 void ConsoleCommander::handle()
@@ -252,6 +261,25 @@ void ConsoleCommander::handle()
         return;
     }
 
+    if (trimmed.startsWith("ledpattern "))
+    {
+        String name = trimmed.substring(11);
+        name.trim();
+        name.toUpperCase();
+        LedPattern pattern;
+        if (LedController::patternFromName(name.c_str(), pattern))
+        {
+            leds.selectPattern(pattern);
+            leds.apply();
+            Serial.printf("[led] pattern %s\n", LedController::patternName(pattern));
+        }
+        else
+        {
+            Serial.println("[led] patterns: AUTO OBSTACLE LOW_BATTERY WS_OFFLINE TURN NAV_PROGRESS SOLID");
+        }
+        return;
+    }
+
     if (trimmed.startsWith("led "))
     {
         int sp = trimmed.indexOf(' ');
@@ -277,6 +305,8 @@ void ConsoleCommander::handle()
 
     if (sscanf(trimmed.c_str(), "ledbri %d", &ia) == 1)
     {
+        // Auto brightness would overwrite it on the next lux change.
+        leds.setAutoEnabled(false);
         leds.setBrightness(static_cast<uint8_t>(clampf(ia, 0, 255)));
         leds.apply();
         return;
@@ -296,6 +326,12 @@ void ConsoleCommander::handle()
         return;
     }
 
+    if (trimmed.equalsIgnoreCase("beep stop"))
+    {
+        audio.stop();
+        return;
+    }
+
     if (sscanf(trimmed.c_str(), "beep %d %d", &ia, &ib) == 2)
     {
         ia = static_cast<int>(clampf(ia, 20, 20000));
@@ -310,49 +346,90 @@ void ConsoleCommander::handle()
         return;
     }
 
+    if (trimmed.equalsIgnoreCase("jsonpool"))
+    {
+        printJsonPools();
+        return;
+    }
+
+    if (trimmed.startsWith("faults"))
+    {
+        int sp = trimmed.indexOf(' ');
+        bool on = false;
+        if (sp > 0 && parseOnOffOr01(trimmed.substring(sp + 1), on))
+        {
+            if (on)
+                FaultInjection::start();
+            else
+                FaultInjection::stop();
+            return;
+        }
+        if (FaultInjection::active())
+            Serial.printf("[faults] phase %s\n", FaultInjection::profile().name);
+        else
+            Serial.println("[faults] off; usage: faults on|off");
+        return;
+    }
+
     Serial.printf("[console] unknown: %s\n", trimmed.c_str());
 }
 
 void ConsoleCommander::printBackendPing()
 {
-    Serial.printf("PING %s: 64 data bytes\n", BackendConfig::HOST);
-
-    const BackendClient::PingResult result = BackendClient::ping();
-    if (!result.wifiConnected)
+    if (!WifiManager::isConnected())
     {
-        Serial.printf("[backend] ping fail: wifi=disconnected ip=%s\n", WifiManager::ip().c_str());
+        Serial.printf("[link] wifi=disconnected ip=%s\n", WifiManager::ip().c_str());
         return;
     }
 
-    if (!result.targetValid)
-    {
-        Serial.printf("[backend] ping fail: invalid target=%s\n", BackendConfig::HOST);
-        return;
-    }
+    Serial.printf("[backend] circuit=%s\n", BackendClient::circuitName(BackendClient::circuit()));
 
-    if (!result.sessionStarted)
+    const LinkMonitor::Stats s = LinkMonitor::stats();
+    if (!s.running)
     {
-        Serial.println("[backend] ping fail: session start failed");
+        Serial.println("[link] monitor not running");
         return;
     }
 
-    Serial.printf("--- %s ping statistics ---\n", BackendConfig::HOST);
+    Serial.printf("[link] %s: %u probes, %u lost (%u%%), quality=%s\n",
+                  BackendConfig::HOST,
+                  static_cast<unsigned>(s.probes),
+                  static_cast<unsigned>(s.lost),
+                  static_cast<unsigned>(s.lossPct),
+                  LinkMonitor::qualityName(s.quality));
 
-    const uint32_t packetLossPct = (result.transmitted > 0)
-                                       ? ((result.transmitted - result.received) * 100U) / result.transmitted
-                                       : 0;
-
-    Serial.printf("%lu packets transmitted, %lu received, %lu%% packet loss, time %lums\n",
-                  static_cast<unsigned long>(result.transmitted),
-                  static_cast<unsigned long>(result.received),
-                  static_cast<unsigned long>(packetLossPct),
-                  static_cast<unsigned long>(result.durationMs));
+    if (s.probes > s.lost)
+    {
+        Serial.printf("[link] rtt min/avg/max/last = %lu/%lu/%lu/%lu ms jitter=%.1f ms\n",
+                      static_cast<unsigned long>(s.rttMinMs),
+                      static_cast<unsigned long>(s.rttAvgMs),
+                      static_cast<unsigned long>(s.rttMaxMs),
+                      static_cast<unsigned long>(s.rttLastMs),
+                      static_cast<double>(s.jitterMs));
+    }
+}
 
-    if (result.received > 0)
+void ConsoleCommander::printJsonPools()
+{
+    struct PoolRow
+    {
+        const char *name;
+        JsonPool::Stats stats;
+    };
+
+    const PoolRow rows[] = {
+        {"ws-rx", WsControlClient::jsonPoolStats()},
+        {"backend", BackendClient::jsonPoolStats()},
+        {"http", RobotHttpServer::jsonPoolStats()},
+        {"robot-ws", RobotWsServer::jsonPoolStats()},
+    };
+
+    for (const PoolRow &row : rows)
     {
-        Serial.printf("round-trip min/avg/max = %lums/%lums/%lums\n",
-                      static_cast<unsigned long>(result.minTimeMs),
-                      static_cast<unsigned long>(result.avgTimeMs),
-                      static_cast<unsigned long>(result.maxTimeMs));
+        Serial.printf("[json] %-8s peak=%u/%u heap_fallbacks=%lu\n",
+                      row.name,
+                      static_cast<unsigned>(row.stats.highWater),
+                      static_cast<unsigned>(row.stats.capacity),
+                      static_cast<unsigned long>(row.stats.heapFallbacks));
     }
 }
@@ -43,6 +43,7 @@ DriveController::DriveController(SensorSuite &sensorsRef)
       lastDriveCmdMs(0),
       lastDriveUpdateMs(0),
       lastMotorApplyMs(0),
+      lastMotorApplyUs(0),
       lastAppliedLeft(0.0f),
       lastAppliedRight(0.0f),
       lastDriveDebugMs(0),
@@ -117,6 +118,21 @@ void DriveController::update(uint32_t nowMs, RobotHttpServer::DriveMode mode)
     float maxThrottleStep = cfg.throttle_slew_rate * dt;
     float maxSteerStep = cfg.steer_slew_rate * dt;
 
+    // Teleop failsafe: a manual stream that stops (link loss, UDP drop-out)
+    // brakes to zero instead of holding the last setpoint. Signed, because a
+    // command handled earlier in this loop pass may be stamped after nowMs.
+    const int32_t sinceCmdMs = static_cast<int32_t>(nowMs - lastDriveCmdMs);
+    if (mode == RobotHttpServer::DriveMode::MANUAL && sinceCmdMs > static_cast<int32_t>(cfg.manual_cmd_timeout_ms))
+    {
+        if (cfg.drive_debug && (targetThrottle != 0.0f || targetSteer != 0.0f))
+            Serial.println("[drive] manual command timeout -> brake");
+
+        targetThrottle = 0.0f;
+        targetSteer = 0.0f;
+        maxThrottleStep = cfg.timeout_brake_slew_rate * dt;
+        maxSteerStep = cfg.timeout_brake_slew_rate * dt;
+    }
+
     smoothedThrottle = slewTowards(smoothedThrottle, targetThrottle, maxThrottleStep);
     smoothedSteer = slewTowards(smoothedSteer, targetSteer, maxSteerStep);
 
@@ -151,6 +167,16 @@ bool DriveController::obstacleFrontActive() const
     return obstacleFront;
 }
 
+uint32_t DriveController::lastApplyUs() const
+{
+    return lastMotorApplyUs;
+}
+
+DriveController::Telemetry DriveController::telemetry() const
+{
+    return Telemetry{lastAppliedLeft, lastAppliedRight, targetThrottle, targetSteer, smoothedThrottle, smoothedSteer};
+}
+
 void DriveController::applyTank(float throttle, float steer, uint32_t nowMs)
 {
     throttle = clampf(throttle, -1.0f, 1.0f);
@@ -225,6 +251,7 @@ void DriveController::applyTank(float throttle, float steer, uint32_t nowMs)
     lastAppliedLeft = left;
     lastAppliedRight = right;
     lastMotorApplyMs = nowMs;
+    lastMotorApplyUs = micros();
 
     if (cfg.drive_debug && (nowMs - lastDriveDebugMs) >= cfg.drive_debug_interval_ms)
     {
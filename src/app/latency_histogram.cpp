@@ -0,0 +1,116 @@
+#include "app/latency_histogram.h"
+
+#include <cstring>
+
+namespace
+{
+    // Upper bounds in microseconds; the final bucket is open-ended.
+    const uint32_t BUCKET_UPPER_US[LatencyHistogram::BUCKET_COUNT - 1] = {
+        500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000};
+}
+
+LatencyHistogram::LatencyHistogram(uint32_t windowMsValue)
+    : windows{},
+      current(0),
+      windowStartMs(0),
+      windowMs(windowMsValue)
+{
+}
+
+uint32_t LatencyHistogram::bucketUpperUs(uint8_t index)
+{
+    if (index >= BUCKET_COUNT - 1)
+        return UINT32_MAX;
+    return BUCKET_UPPER_US[index];
+}
+
+void LatencyHistogram::rotate(uint32_t nowMs)
+{
+    const uint32_t elapsed = nowMs - windowStartMs;
+    if (elapsed < windowMs)
+        return;
+
+    // More than two windows idle: both are stale.
+    if (elapsed >= 2 * windowMs)
+        memset(&windows[current], 0, sizeof(Window));
+
+    current ^= 1;
+    memset(&windows[current], 0, sizeof(Window));
+    windowStartMs = nowMs;
+}
+
+void LatencyHistogram::record(uint32_t us, uint32_t nowMs)
+{
+    rotate(nowMs);
+
+    uint8_t bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 && us > BUCKET_UPPER_US[bucket])
+        ++bucket;
+
+    Window &w = windows[current];
+    ++w.counts[bucket];
+    ++w.count;
+    w.sumUs += us;
+    if (us > w.maxUs)
+        w.maxUs = us;
+}
+
+void LatencyHistogram::merged(Window &out) const
+{
+    out = windows[0];
+    const Window &other = windows[1];
+    for (uint8_t i = 0; i < BUCKET_COUNT; ++i)
+        out.counts[i] += other.counts[i];
+    out.count += other.count;
+    out.sumUs += other.sumUs;
+    if (other.maxUs > out.maxUs)
+        out.maxUs = other.maxUs;
+}
+
+uint32_t LatencyHistogram::percentile(const Window &w, float q)
+{
+    if (w.count == 0)
+        return 0;
+
+    const float rank = q * static_cast<float>(w.count);
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        const uint32_t inBucket = w.counts[i];
+        if (inBucket == 0 || static_cast<float>(cumulative + inBucket) < rank)
+        {
+            cumulative += inBucket;
+            continue;
+        }
+
+        // Interpolate inside the bucket; the open bucket is capped by the max seen.
+        const uint32_t lower = (i == 0) ? 0 : BUCKET_UPPER_US[i - 1];
+        uint32_t upper = (i < BUCKET_COUNT - 1) ? BUCKET_UPPER_US[i] : w.maxUs;
+        if (upper > w.maxUs)
+            upper = w.maxUs;
+        if (upper <= lower)
+            return upper;
+
+        const float fraction = (rank - static_cast<float>(cumulative)) / static_cast<float>(inBucket);
+        return lower + static_cast<uint32_t>(fraction * static_cast<float>(upper - lower));
+    }
+
+    return w.maxUs;
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary(uint32_t nowMs)
+{
+    rotate(nowMs);
+
+    Window w;
+    merged(w);
+
+    Summary s;
+    s.count = w.count;
+    s.p50Us = percentile(w, 0.50f);
+    s.p90Us = percentile(w, 0.90f);
+    s.p99Us = percentile(w, 0.99f);
+    s.maxUs = w.maxUs;
+    s.sumUs = w.sumUs;
+    return s;
+}
@@ -1,48 +1,361 @@
 #include "app/led_controller.h"
 
+#include "app_config.h"
 #include "board_pins.h"
+#include "net/metrics.h"
+#include <cstring>
+
+namespace
+{
+    constexpr uint32_t RENDER_TASK_STACK = 2048;
+    constexpr UBaseType_t RENDER_TASK_PRIORITY = 1;
+    constexpr BaseType_t RENDER_TASK_CORE = 0;
+    constexpr uint32_t STRIP_START_TIMEOUT_MS = 1000;
+
+    constexpr float NOMINAL_MA_PER_LEVEL = AppConfig::LED_CHANNEL_FULL_MA / 255.0f;
+    // Forgetting factor of the fit, per power period (~8 s memory).
+    constexpr float FIT_ALPHA = 1.0f / 32.0f;
+    // The gain is only refit once the strip's share has varied this much,
+    // and never leaves [0.5, 2] x nominal.
+    constexpr float FIT_MIN_SPREAD_MA = 50.0f;
+    // Below this duty the motors count as idle and the fit runs.
+    constexpr float MOTOR_IDLE_LOAD = 0.02f;
+
+    Metrics::Gauge g_ledEstimate("robot_led_current_ma", "LED strip current: estimate from frame content and the budget", "kind=\"estimate\"");
+    Metrics::Gauge g_ledBudget("robot_led_current_ma", "LED strip current: estimate from frame content and the budget", "kind=\"budget\"");
+    Metrics::Gauge g_ledGain("robot_led_ma_per_level", "Fitted strip current per unit of summed frame level");
+    Metrics::Counter g_ledLimited("robot_led_frames_limited_total", "LED frames scaled down to stay within the power budget");
+
+    constexpr LedPatternParams DEFAULT_PARAMS[] = {
+        {255, 0, 0, 0, 300},    // Obstacle
+        {255, 40, 0, 0, 2000},  // LowBattery
+        {0, 0, 255, 12, 1500},  // WsOffline
+        {255, 110, 0, 24, 600}, // Turn
+        {0, 255, 40, 4, 1200},  // NavProgress
+        {255, 255, 255, 0, 0},  // Solid
+    };
+    static_assert(sizeof(DEFAULT_PARAMS) / sizeof(DEFAULT_PARAMS[0]) == static_cast<size_t>(LedPattern::Count),
+                  "one default per pattern");
+
+    const char *const PATTERN_NAMES[] = {"OBSTACLE", "LOW_BATTERY", "WS_OFFLINE", "TURN", "NAV_PROGRESS", "SOLID"};
+    static_assert(sizeof(PATTERN_NAMES) / sizeof(PATTERN_NAMES[0]) == static_cast<size_t>(LedPattern::Count),
+                  "one name per pattern");
+
+    // level 0..256
+    uint8_t scale(uint8_t c, uint16_t level)
+    {
+        return static_cast<uint8_t>((c * level) >> 8);
+    }
+
+    // Position within the period, 0..255.
+    uint8_t phaseOf(uint32_t nowMs, uint16_t periodMs)
+    {
+        if (periodMs == 0)
+            return 0;
+        return static_cast<uint8_t>(((nowMs % periodMs) * 256U) / periodMs);
+    }
+
+    // Scales the frame so its levels sum to at most maxLevels; returns the
+    // new sum.
+    uint32_t limitFrame(uint8_t *frame, size_t bytes, uint32_t levels, uint32_t maxLevels)
+    {
+        const uint32_t factor = static_cast<uint32_t>((static_cast<uint64_t>(maxLevels) << 8) / levels);
+        uint32_t total = 0;
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            frame[i] = static_cast<uint8_t>((frame[i] * factor) >> 8);
+            total += frame[i];
+        }
+        return total;
+    }
+
+    uint32_t levelsFor(float ma, float maPerLevel)
+    {
+        return static_cast<uint32_t>(ma / maPerLevel);
+    }
+
+    // 0 -> 254 -> 0 over one phase cycle.
+    uint8_t triangle(uint8_t phase)
+    {
+        return static_cast<uint8_t>(phase < 128 ? phase * 2 : (255 - phase) * 2);
+    }
+}
 
 LedController::LedController(SensorSuite &sensorsRef)
     : sensors(sensorsRef),
-      ledStrip(LED_COUNT, static_cast<uint8_t>(BoardPins::LED_STRIP_DATA), NEO_GRB + NEO_KHZ800),
-      ledEnabled(false),
+      ledStrip(Ws2812Strip::Config{BoardPins::LED_STRIP_DATA, LED_COUNT, RMT_CHANNEL_0}),
+      renderer(LED_COUNT),
       ledAutoEnabled(true),
-      ledBrightness(40),
-      ledR(255),
-      ledG(255),
-      ledB(255)
+      lastAutoMs(0),
+      luxLog(0.0f),
+      luxReady(false),
+      luxOutliers(0),
+      scene{},
+      shared{},
+      sceneMux(portMUX_INITIALIZER_UNLOCKED),
+      renderHandle(nullptr),
+      beginCaller(nullptr),
+      levelsSent(0),
+      framesRendered(0),
+      power{NOMINAL_MA_PER_LEVEL, 0.0f, 0.0f, 0.0f, 0.0f},
+      lastPowerMs(0),
+      lastLevelsSent(0),
+      lastFramesRendered(0)
+{
+    scene.enabled = false;
+    // Through the gamma curve this is the 16% duty the linear default
+    // of 40 gave.
+    scene.brightness = 110;
+    scene.pinned = LedPattern::Count;
+    memcpy(scene.params, DEFAULT_PARAMS, sizeof(scene.params));
+    scene.maxLevels = levelsFor(AppConfig::LED_BUDGET_IDLE_MA, NOMINAL_MA_PER_LEVEL);
+    shared = scene;
+}
+
+bool LedController::begin()
+{
+    // The RMT interrupt is allocated on the core that installs the driver,
+    // so the render task installs it: refills then run on the network core
+    // instead of preempting the control loop.
+    beginCaller = xTaskGetCurrentTaskHandle();
+    xTaskCreatePinnedToCore(renderTask, "led-render", RENDER_TASK_STACK, this, RENDER_TASK_PRIORITY, &renderHandle, RENDER_TASK_CORE);
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STRIP_START_TIMEOUT_MS)) == 0)
+    {
+        Serial.println("[led] RMT init failed");
+        renderHandle = nullptr;
+        return false;
+    }
+
+    Metrics::trackTask(renderHandle);
+    return true;
+}
+
+void LedController::renderTask(void *arg)
+{
+    LedController *self = static_cast<LedController *>(arg);
+    const bool ok = self->ledStrip.begin();
+    if (ok)
+    {
+        self->ledStrip.clear();
+        self->ledStrip.show();
+    }
+    xTaskNotify(self->beginCaller, ok ? 1 : 0, eSetValueWithOverwrite);
+
+    if (!ok)
+    {
+        vTaskDelete(nullptr);
+        return;
+    }
+    self->renderLoop();
+}
+
+void LedController::renderLoop()
 {
+    const TickType_t period = pdMS_TO_TICKS(1000U / AppConfig::LED_FRAME_HZ);
+    TickType_t wake = xTaskGetTickCount();
+    Scene frame;
+
+    for (;;)
+    {
+        portENTER_CRITICAL(&sceneMux);
+        frame = shared;
+        portEXIT_CRITICAL(&sceneMux);
+
+        render(frame, millis());
+        renderer.setBrightness(frame.brightness);
+        uint8_t *pixels = ledStrip.pixels();
+        uint32_t levels = renderer.render(pixels);
+        if (levels > frame.maxLevels)
+        {
+            levels = limitFrame(pixels, static_cast<size_t>(LED_COUNT) * 3, levels, frame.maxLevels);
+            g_ledLimited.inc();
+        }
+        levelsSent.fetch_add(levels, std::memory_order_relaxed);
+        framesRendered.fetch_add(1, std::memory_order_release);
+
+        // A frame still on the wire defers this one to the next tick.
+        ledStrip.show();
+
+        vTaskDelayUntil(&wake, period);
+    }
 }
 
-void LedController::begin()
+LedPattern LedController::activePattern(const Scene &s) const
 {
-    ledStrip.begin();
-    ledStrip.clear();
-    ledStrip.setBrightness(ledBrightness);
-    ledStrip.show();
+    if (s.pinned != LedPattern::Count)
+        return (s.pinned == LedPattern::Solid && !s.enabled) ? LedPattern::Count : s.pinned;
+
+    if (s.status.obstacle)
+        return LedPattern::Obstacle;
+    if (s.status.lowBattery)
+        return LedPattern::LowBattery;
+
+    // The rest is information, not a warning; a strip that is switched off
+    // (by hand or by auto brightness) stays dark for it.
+    if (!s.enabled)
+        return LedPattern::Count;
+    if (s.status.wsOffline)
+        return LedPattern::WsOffline;
+    if (s.status.turn != 0)
+        return LedPattern::Turn;
+    if (s.status.navActive)
+        return LedPattern::NavProgress;
+    return LedPattern::Solid;
+}
+
+void LedController::render(const Scene &s, uint32_t nowMs)
+{
+    renderer.clear();
+
+    const LedPattern pattern = activePattern(s);
+    if (pattern == LedPattern::Count)
+        return;
+
+    const LedPatternParams &p = s.params[static_cast<size_t>(pattern)];
+    const uint8_t r = p.r;
+    const uint8_t g = p.g;
+    const uint8_t b = p.b;
+
+    const uint8_t phase = phaseOf(nowMs, p.periodMs);
+    const uint16_t width = p.width == 0 ? 1 : (p.width > LED_COUNT ? LED_COUNT : p.width);
+
+    switch (pattern)
+    {
+    case LedPattern::Obstacle:
+        if (phase < 128)
+            renderer.fill(r, g, b);
+        break;
+
+    case LedPattern::LowBattery:
+    {
+        const uint16_t level = static_cast<uint16_t>(triangle(phase)) + 1;
+        renderer.fill(scale(r, level), scale(g, level), scale(b, level));
+        break;
+    }
+
+    case LedPattern::WsOffline:
+    {
+        const uint16_t pos = static_cast<uint16_t>((static_cast<uint32_t>(triangle(phase)) * (LED_COUNT - width)) / 254U);
+        for (uint16_t i = 0; i < width; ++i)
+            renderer.setPixel(pos + i, r, g, b);
+        break;
+    }
+
+    case LedPattern::Turn:
+    {
+        // Pixel 0 is the left end. The segment leaves the middle, runs out
+        // to the end and clears; no turn (pinned) sweeps both ways.
+        const uint16_t half = LED_COUNT / 2;
+        const uint16_t lead = static_cast<uint16_t>((static_cast<uint32_t>(phase) * (half + width)) >> 8);
+        for (uint16_t i = 0; i < width && i <= lead; ++i)
+        {
+            const uint16_t offset = lead - i;
+            if (offset >= half)
+                continue;
+            if (s.status.turn >= 0)
+                renderer.setPixel(half + offset, r, g, b);
+            if (s.status.turn <= 0)
+                renderer.setPixel(half - 1 - offset, r, g, b);
+        }
+        break;
+    }
+
+    case LedPattern::NavProgress:
+    {
+        const uint16_t lit = static_cast<uint16_t>((static_cast<uint32_t>(s.status.navProgress) * LED_COUNT) / 255U);
+        for (uint16_t i = 0; i < lit; ++i)
+            renderer.setPixel(i, r, g, b);
+
+        const uint16_t level = static_cast<uint16_t>(triangle(phase)) + 1;
+        for (uint16_t i = lit; i < lit + width && i < LED_COUNT; ++i)
+            renderer.setPixel(i, scale(r, level), scale(g, level), scale(b, level));
+        break;
+    }
+
+    case LedPattern::Solid:
+        renderer.fill(r, g, b);
+        break;
+
+    default:
+        break;
+    }
 }
 
-void LedController::autoTask()
+void LedController::autoTask(uint32_t nowMs)
 {
     if (!ledAutoEnabled)
         return;
-    if (!sensors.hasLux())
+    if (nowMs - lastAutoMs < AppConfig::LED_AUTO_PERIOD_MS)
         return;
+    lastAutoMs = nowMs;
 
-    const float lux = sensors.lux();
+    if (!sensors.hasLux() || !filterLux(sensors.lux()))
+        return;
 
-    if (!ledEnabled && lux < BoardPins::LED_LUX_ON_THRESHOLD)
+    const float lux = expf(luxLog) - 1.0f;
+    if (!scene.enabled && lux < BoardPins::LED_LUX_ON_THRESHOLD)
     {
+        scene.brightness = autoBrightness();
         setEnabled(true);
-        Serial.printf("[led] auto on (lux=%.1f)\n", static_cast<double>(lux));
+        Serial.printf("[led] auto on (lux=%.1f, brightness=%u)\n", static_cast<double>(lux), static_cast<unsigned>(scene.brightness));
+        return;
     }
-    else if (ledEnabled && lux > BoardPins::LED_LUX_OFF_THRESHOLD)
+    if (scene.enabled && lux > BoardPins::LED_LUX_OFF_THRESHOLD)
     {
         setEnabled(false);
         Serial.printf("[led] auto off (lux=%.1f)\n", static_cast<double>(lux));
+        return;
+    }
+
+    const uint8_t brightness = autoBrightness();
+    if (scene.enabled && brightness != scene.brightness)
+    {
+        scene.brightness = brightness;
+        apply();
     }
 }
 
+bool LedController::filterLux(float lux)
+{
+    const float sample = logf(1.0f + (lux > 0.0f ? lux : 0.0f));
+    if (!luxReady)
+    {
+        luxLog = sample;
+        luxReady = true;
+        return true;
+    }
+
+    static const float OUTLIER_LOG = logf(AppConfig::LED_AUTO_OUTLIER_RATIO);
+    if (fabsf(sample - luxLog) > OUTLIER_LOG)
+    {
+        // A shadow or a reflection passing by; a lasting change gets
+        // through after a few samples, without the EMA's lag.
+        if (++luxOutliers < AppConfig::LED_AUTO_OUTLIER_SAMPLES)
+            return false;
+        luxLog = sample;
+    }
+    else
+    {
+        luxLog += AppConfig::LED_AUTO_EMA_ALPHA * (sample - luxLog);
+    }
+    luxOutliers = 0;
+    return true;
+}
+
+uint8_t LedController::autoBrightness() const
+{
+    static const float DARK_LOG = logf(1.0f + AppConfig::LED_AUTO_LUX_DARK);
+    static const float ON_LOG = logf(1.0f + BoardPins::LED_LUX_ON_THRESHOLD);
+
+    float t = (luxLog - DARK_LOG) / (ON_LOG - DARK_LOG);
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+
+    const float span = static_cast<float>(AppConfig::LED_AUTO_BRIGHTNESS_MAX - AppConfig::LED_AUTO_BRIGHTNESS_MIN);
+    const float level = AppConfig::LED_AUTO_BRIGHTNESS_MAX - span * t;
+    const uint8_t step = AppConfig::LED_AUTO_BRIGHTNESS_STEP;
+    return static_cast<uint8_t>(((static_cast<uint16_t>(level) + step / 2) / step) * step);
+}
+
 void LedController::setAutoEnabled(bool enabled)
 {
     ledAutoEnabled = enabled;
@@ -50,29 +363,119 @@ void LedController::setAutoEnabled(bool enabled)
 
 void LedController::setEnabled(bool enabled)
 {
-    if (ledEnabled == enabled)
+    if (scene.enabled == enabled)
         return;
 
-    ledEnabled = enabled;
+    scene.enabled = enabled;
     apply();
-    Serial.printf("[led] %s\n", ledEnabled ? "ON" : "OFF");
+    Serial.printf("[led] %s\n", scene.enabled ? "ON" : "OFF");
 }
 
 void LedController::setColor(uint8_t r, uint8_t g, uint8_t b)
 {
-    ledR = r;
-    ledG = g;
-    ledB = b;
+    LedPatternParams &solid = scene.params[static_cast<size_t>(LedPattern::Solid)];
+    solid.r = r;
+    solid.g = g;
+    solid.b = b;
 }
 
 void LedController::setBrightness(uint8_t v)
 {
-    ledBrightness = v;
+    scene.brightness = v;
+}
+
+void LedController::selectPattern(LedPattern pattern)
+{
+    scene.pinned = pattern;
+}
+
+void LedController::setPatternParams(LedPattern pattern, const LedPatternParams &params)
+{
+    if (pattern != LedPattern::Count)
+        scene.params[static_cast<size_t>(pattern)] = params;
+}
+
+LedPatternParams LedController::patternParams(LedPattern pattern) const
+{
+    return scene.params[static_cast<size_t>(pattern == LedPattern::Count ? LedPattern::Solid : pattern)];
+}
+
+void LedController::setStatus(const LedStatus &status)
+{
+    if (memcmp(&status, &scene.status, sizeof(status)) == 0)
+        return;
+
+    scene.status = status;
+    apply();
+}
+
+void LedController::powerTask(uint32_t nowMs, float motorLoad)
+{
+    if (nowMs - lastPowerMs < AppConfig::LED_POWER_PERIOD_MS)
+        return;
+    lastPowerMs = nowMs;
+
+    const uint32_t frames = framesRendered.load(std::memory_order_acquire);
+    const uint32_t sent = levelsSent.load(std::memory_order_relaxed);
+    const uint32_t frameCount = frames - lastFramesRendered;
+    const float levels = frameCount ? static_cast<float>(sent - lastLevelsSent) / frameCount : 0.0f;
+    lastFramesRendered = frames;
+    lastLevelsSent = sent;
+
+    const float load = motorLoad < 0.0f ? 0.0f : (motorLoad > 1.0f ? 1.0f : motorLoad);
+    float budgetMa = AppConfig::LED_BUDGET_IDLE_MA + (AppConfig::LED_BUDGET_DRIVING_MA - AppConfig::LED_BUDGET_IDLE_MA) * load;
+
+    const float stripMa = levels * power.maPerLevel;
+    if (sensors.hasPowerMonitor())
+    {
+        const float measuredMa = sensors.batteryCurrentA() * 1000.0f;
+        if (frameCount && load < MOTOR_IDLE_LOAD)
+            calibrate(levels, measuredMa);
+
+        // Everything else is served first.
+        const float headroomMa = AppConfig::BATTERY_CURRENT_LIMIT_MA - (measuredMa - stripMa);
+        if (headroomMa < budgetMa)
+            budgetMa = headroomMa;
+    }
+    if (budgetMa < AppConfig::LED_BUDGET_FLOOR_MA)
+        budgetMa = AppConfig::LED_BUDGET_FLOOR_MA;
+
+    g_ledEstimate.set(stripMa);
+    g_ledBudget.set(budgetMa);
+    g_ledGain.set(power.maPerLevel);
+
+    const uint32_t maxLevels = levelsFor(budgetMa, power.maPerLevel);
+    if (maxLevels != scene.maxLevels)
+    {
+        scene.maxLevels = maxLevels;
+        apply();
+    }
+}
+
+void LedController::calibrate(float levels, float measuredMa)
+{
+    PowerModel &m = power;
+    m.meanLevels += FIT_ALPHA * (levels - m.meanLevels);
+    m.meanMa += FIT_ALPHA * (measuredMa - m.meanMa);
+
+    const float dl = levels - m.meanLevels;
+    const float dm = measuredMa - m.meanMa;
+    m.varLevels += FIT_ALPHA * (dl * dl - m.varLevels);
+    m.covLevelsMa += FIT_ALPHA * (dl * dm - m.covLevelsMa);
+
+    const float minSpread = FIT_MIN_SPREAD_MA / NOMINAL_MA_PER_LEVEL;
+    if (m.varLevels < minSpread * minSpread)
+        return;
+
+    const float gain = m.covLevelsMa / m.varLevels;
+    const float lo = NOMINAL_MA_PER_LEVEL * 0.5f;
+    const float hi = NOMINAL_MA_PER_LEVEL * 2.0f;
+    m.maPerLevel = gain < lo ? lo : (gain > hi ? hi : gain);
 }
 
 bool LedController::isEnabled() const
 {
-    return ledEnabled;
+    return scene.enabled;
 }
 
 bool LedController::isAutoEnabled() const
@@ -82,24 +485,41 @@ bool LedController::isAutoEnabled() const
 
 uint8_t LedController::brightness() const
 {
-    return ledBrightness;
+    return scene.brightness;
 }
 
 void LedController::apply()
 {
-    if (!ledEnabled)
-    {
-        ledStrip.clear();
-        ledStrip.show();
-        return;
-    }
+    portENTER_CRITICAL(&sceneMux);
+    shared = scene;
+    portEXIT_CRITICAL(&sceneMux);
+}
+
+uint32_t LedController::framesSent() const
+{
+    return ledStrip.framesSent();
+}
 
-    const uint32_t c = ledStrip.Color(ledR, ledG, ledB);
-    for (uint16_t i = 0; i < LED_COUNT; ++i)
+uint32_t LedController::framesSkipped() const
+{
+    return ledStrip.framesSkipped();
+}
+
+const char *LedController::patternName(LedPattern pattern)
+{
+    return pattern == LedPattern::Count ? "AUTO" : PATTERN_NAMES[static_cast<size_t>(pattern)];
+}
+
+bool LedController::patternFromName(const char *name, LedPattern &out)
+{
+    for (size_t i = 0; i <= PATTERN_COUNT; ++i)
     {
-        ledStrip.setPixelColor(i, c);
+        const LedPattern pattern = static_cast<LedPattern>(i);
+        if (strcmp(name, patternName(pattern)) == 0)
+        {
+            out = pattern;
+            return true;
+        }
     }
-
-    ledStrip.setBrightness(ledBrightness);
-    ledStrip.show();
+    return false;
 }
@@ -0,0 +1,138 @@
+#include "app/led_renderer.h"
+
+#include <string.h>
+
+namespace
+{
+    // x^(1/5) for x in [0, 1] by Newton's method from 1.
+    constexpr double fifthRoot(double x, double y = 1.0, int steps = 48)
+    {
+        return steps == 0 ? y : fifthRoot(x, (4.0 * y + x / (y * y * y * y)) / 5.0, steps - 1);
+    }
+
+    // x^2.2 = x^2 * x^0.2, scaled so 255 maps to exactly 255.0 in 8.8.
+    constexpr uint16_t gammaEntry(uint16_t i)
+    {
+        return static_cast<uint16_t>(65280.0 * (i / 255.0) * (i / 255.0) * fifthRoot(i / 255.0) + 0.5);
+    }
+
+    template <uint16_t... I>
+    struct Indices
+    {
+    };
+
+    template <uint16_t N, uint16_t... I>
+    struct MakeIndices : MakeIndices<N - 1, N - 1, I...>
+    {
+    };
+
+    template <uint16_t... I>
+    struct MakeIndices<0, I...>
+    {
+        using type = Indices<I...>;
+    };
+
+    struct GammaTable
+    {
+        uint16_t v[256];
+    };
+
+    template <uint16_t... I>
+    constexpr GammaTable makeGamma(Indices<I...>)
+    {
+        return GammaTable{{gammaEntry(I)...}};
+    }
+
+    constexpr GammaTable GAMMA = makeGamma(MakeIndices<256>::type{});
+
+    static_assert(GAMMA.v[0] == 0 && GAMMA.v[255] == 65280, "gamma table must span 0..255.0");
+    static_assert(GAMMA.v[128] > 14200 && GAMMA.v[128] < 14450, "gamma 2.2 puts half input near 22%");
+
+    // 8.8 level from which render() rounds a pixel instead of dithering it:
+    // a step is at most 1/16 of its brightest subpixel there, too small to see.
+    constexpr uint16_t DITHER_BELOW = 16 << 8;
+}
+
+LedRenderer::LedRenderer(uint16_t count)
+    : ledCount(count),
+      canvas(new uint8_t[static_cast<size_t>(count) * 3]()),
+      residue(new uint8_t[static_cast<size_t>(count) * 3]),
+      brightnessLevel(0),
+      levels{} // brightness 0: all dark
+{
+    // Spread the starting fractions so equal neighbours don't step up on
+    // the same frame.
+    const size_t bytes = static_cast<size_t>(count) * 3;
+    for (size_t i = 0; i < bytes; ++i)
+        residue[i] = static_cast<uint8_t>(i * 167U);
+}
+
+LedRenderer::~LedRenderer()
+{
+    delete[] canvas;
+    delete[] residue;
+}
+
+void LedRenderer::setPixel(uint16_t i, uint8_t r, uint8_t g, uint8_t b)
+{
+    if (i >= ledCount)
+        return;
+
+    uint8_t *p = canvas + static_cast<size_t>(i) * 3;
+    p[0] = g;
+    p[1] = r;
+    p[2] = b;
+}
+
+void LedRenderer::fill(uint8_t r, uint8_t g, uint8_t b)
+{
+    uint8_t *p = canvas;
+    for (uint16_t i = 0; i < ledCount; ++i, p += 3)
+    {
+        p[0] = g;
+        p[1] = r;
+        p[2] = b;
+    }
+}
+
+void LedRenderer::clear()
+{
+    memset(canvas, 0, static_cast<size_t>(ledCount) * 3);
+}
+
+void LedRenderer::setBrightness(uint8_t v)
+{
+    if (v == brightnessLevel)
+        return;
+
+    brightnessLevel = v;
+    const uint32_t scale = GAMMA.v[v];
+    for (uint16_t i = 0; i < 256; ++i)
+        levels[i] = static_cast<uint16_t>((GAMMA.v[i] * scale) / 65280U);
+}
+
+uint32_t LedRenderer::render(uint8_t *out)
+{
+    const size_t bytes = static_cast<size_t>(ledCount) * 3;
+    uint32_t total = 0;
+    for (size_t i = 0; i < bytes; i += 3)
+    {
+        const uint16_t level[3] = {levels[canvas[i]], levels[canvas[i + 1]], levels[canvas[i + 2]]};
+        const bool dither = level[0] < DITHER_BELOW && level[1] < DITHER_BELOW && level[2] < DITHER_BELOW;
+        for (size_t c = 0; c < 3; ++c)
+        {
+            if (dither)
+            {
+                const uint16_t acc = static_cast<uint16_t>(level[c] + residue[i + c]);
+                out[i + c] = static_cast<uint8_t>(acc >> 8);
+                residue[i + c] = static_cast<uint8_t>(acc);
+            }
+            else
+            {
+                out[i + c] = static_cast<uint8_t>((level[c] + 128U) >> 8);
+            }
+            total += out[i + c];
+        }
+    }
+    return total;
+}
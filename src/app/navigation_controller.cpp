@@ -1,5 +1,7 @@
 #include "app/navigation_controller.h"
 
+#include "net/metrics.h"
+
 #include <cmath>
 
 namespace
@@ -36,6 +38,12 @@ namespace
         {1, 2, NavigationController::NavigationAction::TURN_RIGHT},
         {2, 1, NavigationController::NavigationAction::TURN_LEFT},
     };
+
+    constexpr char NAV_OUTCOMES_HELP[] = "Navigation requests by how they ended";
+    Metrics::Counter g_navArrived("robot_nav_outcomes_total", NAV_OUTCOMES_HELP, "outcome=\"arrived\"");
+    Metrics::Counter g_navFailed("robot_nav_outcomes_total", NAV_OUTCOMES_HELP, "outcome=\"failed\"");
+    Metrics::Counter g_navCancelled("robot_nav_outcomes_total", NAV_OUTCOMES_HELP, "outcome=\"cancelled\"");
+    Metrics::Counter g_navRejected("robot_nav_outcomes_total", NAV_OUTCOMES_HELP, "outcome=\"rejected\"");
 }
 
 NavigationController::NavigationController(RobotState &stateRef, DriveController &driveRef, SensorSuite &sensorsRef)
@@ -114,6 +122,7 @@ bool NavigationController::requestNavigation(const String &startNodeId, const St
     {
         if (errorMessage)
             *errorMessage = message ? message : "";
+        g_navRejected.inc();
 
         if (!navigationActive)
         {
@@ -168,6 +177,7 @@ bool NavigationController::requestNavigation(const String &startNodeId, const St
     {
         navigationActive = false;
         state.setNavigationStatus("ARRIVED");
+        g_navArrived.inc();
         notifyStateChanged();
         Serial.printf("[nav] already at target %s\n", targetNodeId.c_str());
         return true;
@@ -179,6 +189,9 @@ bool NavigationController::requestNavigation(const String &startNodeId, const St
 
 void NavigationController::cancel(const char *navigationStatus, bool clearTargetNode)
 {
+    if (navigationActive)
+        g_navCancelled.inc();
+
     navigationActive = false;
     motionPhase = MotionPhase::IDLE;
     plannedStepCount = 0;
@@ -196,6 +209,25 @@ void NavigationController::cancel(const char *navigationStatus, bool clearTarget
     notifyStateChanged();
 }
 
+bool NavigationController::isActive() const
+{
+    return navigationActive;
+}
+
+uint8_t NavigationController::progress() const
+{
+    if (!navigationActive || plannedStepCount == 0)
+        return 0;
+    return static_cast<uint8_t>((static_cast<uint16_t>(currentStepIndex) * 255U) / plannedStepCount);
+}
+
+int8_t NavigationController::turnDirection() const
+{
+    if (!navigationActive || motionPhase != MotionPhase::TURNING)
+        return 0;
+    return (plannedSteps[currentStepIndex].action == NavigationAction::TURN_LEFT) ? -1 : 1;
+}
+
 void NavigationController::setStateChangedCallback(StateChangedCallback callback)
 {
     stateChangedCallback = callback;
@@ -327,6 +359,7 @@ void NavigationController::startStep(uint32_t nowMs)
         navigationActive = false;
         motionPhase = MotionPhase::IDLE;
         state.setNavigationStatus("ARRIVED");
+        g_navArrived.inc();
         notifyStateChanged();
         return;
     }
@@ -379,6 +412,7 @@ void NavigationController::completeStep(uint32_t nowMs)
         navigationActive = false;
         motionPhase = MotionPhase::IDLE;
         state.setNavigationStatus("ARRIVED");
+        g_navArrived.inc();
         notifyStateChanged();
         Serial.printf("[nav] arrived at %s\n", state.targetNode().c_str());
         return;
@@ -416,6 +450,7 @@ void NavigationController::setError(const char *message)
 
     state.setDriveMode(RobotHttpServer::DriveMode::IDLE);
     state.setNavigationStatus("ERROR");
+    g_navFailed.inc();
     notifyStateChanged();
 
     if (message && message[0] != '\0')
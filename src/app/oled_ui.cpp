@@ -1,6 +1,8 @@
 #include "app/oled_ui.h"
 
 #include "board_pins.h"
+#include "net/link_monitor.h"
+#include "net/metrics.h"
 #include "net/wifi_manager.h"
 #include "net/ws_control_client.h"
 
@@ -12,6 +14,9 @@ namespace
     constexpr uint8_t OLED_HEIGHT = 32;
     constexpr uint8_t OLED_LINE_COUNT = OLED_HEIGHT / 8;
     constexpr uint32_t OLED_RECOVERY_INTERVAL_MS = 5000;
+
+    Metrics::Counter g_recoveriesOk("robot_oled_recoveries_total", "OLED re-initialisations after the display dropped off the bus", "result=\"ok\"");
+    Metrics::Counter g_recoveriesFailed("robot_oled_recoveries_total", "OLED re-initialisations after the display dropped off the bus", "result=\"fail\"");
 }
 
 OledUi::OledUi(RobotState &stateRef, SensorSuite &sensorsRef)
@@ -48,6 +53,10 @@ void OledUi::update(uint32_t nowMs)
         {
             lastRecoveryAttemptMs = nowMs;
             const bool recovered = recover();
+            if (recovered)
+                g_recoveriesOk.inc();
+            else
+                g_recoveriesFailed.inc();
             Serial.printf("[oled] recovery %s (present=%d addr=0x%02X)\n",
                           recovered ? "ok" : "fail",
                           probe() ? 1 : 0,
@@ -73,7 +82,17 @@ void OledUi::update(uint32_t nowMs)
         l[1] = "Verbr: keine Daten";
     }
 
-    l[2] = String("WS: ") + (WsControlClient::isConnected() ? "online" : "offline");
+    if (WsControlClient::isConnected())
+    {
+        l[2] = "WS: online";
+        const LinkMonitor::Stats link = LinkMonitor::stats();
+        if (link.probes > link.lost)
+            l[2] += " " + String(link.rttAvgMs) + "ms " + String(link.lossPct) + "%";
+    }
+    else
+    {
+        l[2] = "WS: offline";
+    }
     l[3] = String("State: ") + state.driveModeToBackend();
 
     oled.setLines(l, OLED_LINE_COUNT);
@@ -1,10 +1,21 @@
 #include "app/sensor_suite.h"
 
 #include "board_pins.h"
+#include "net/metrics.h"
 
 #include <SPI.h>
 #include <Wire.h>
 
+namespace
+{
+    constexpr uint32_t IMU_PERIOD_MS = 100;
+    constexpr uint32_t IMU_FAST_PERIOD_MS = 5;
+    constexpr uint32_t POWER_PERIOD_MS = 250;
+    constexpr uint32_t POWER_FAST_PERIOD_MS = 50;
+
+    Metrics::Counter g_rfidReads("robot_rfid_reads_total", "RFID cards read");
+}
+
 SensorSuite::SensorSuite()
     : irLeft({.pin = BoardPins::IR_LEFT, .active_low = BoardPins::IR_ACTIVE_LOW, .debounce_ms = 30, .use_internal_pullup = false}),
       irMid({.pin = BoardPins::IR_MIDDLE, .active_low = BoardPins::IR_ACTIVE_LOW, .debounce_ms = 30, .use_internal_pullup = false}),
@@ -12,11 +23,11 @@ SensorSuite::SensorSuite()
       lightSensor({.wire = &Wire, .address = BoardPins::BH1750_I2C_ADDRESS, .sample_period_ms = 250}),
       powerSensor({.wire = &Wire,
                    .address = BoardPins::INA226_I2C_ADDRESS,
-                   .sample_period_ms = 250,
+                   .sample_period_ms = POWER_PERIOD_MS,
                    .shunt_ohms = BoardPins::INA226_SHUNT_OHMS,
                    .battery_empty_voltage = BoardPins::BATTERY_EMPTY_VOLTAGE,
                    .battery_full_voltage = BoardPins::BATTERY_FULL_VOLTAGE}),
-      imuSensor({.wire = &Wire, .address = BoardPins::MPU6050_I2C_ADDRESS, .sample_period_ms = 100}),
+      imuSensor({.wire = &Wire, .address = BoardPins::MPU6050_I2C_ADDRESS, .sample_period_ms = IMU_PERIOD_MS}),
       rfidSensor({.spi = &SPI,
                   .sck_pin = BoardPins::RC522_SCK,
                   .miso_pin = BoardPins::RC522_MISO,
@@ -30,6 +41,8 @@ SensorSuite::SensorSuite()
       imuPeriodic(false),
       powerPeriodic(false),
       rfidWatch(true),
+      imuFast(false),
+      powerFast(false),
       lastIrPrintMs(0),
       lastLuxPrintMs(0),
       lastImuPrintMs(0),
@@ -103,8 +116,12 @@ void SensorSuite::update(uint32_t nowMs)
     powerSensor.update(nowMs);
     imuSensor.update(nowMs);
 
-    if (rfidSensor.update(nowMs) && rfidWatch)
-        printRfidOnce();
+    if (rfidSensor.update(nowMs))
+    {
+        g_rfidReads.inc();
+        if (rfidWatch)
+            printRfidOnce();
+    }
 
     if (luxPeriodic && (nowMs - lastLuxPrintMs >= 500))
     {
@@ -320,3 +337,23 @@ const RfidRc522Sensor::Reading &SensorSuite::rfid() const
 {
     return rfidSensor.reading();
 }
+
+SensorSuite::I2cErrors SensorSuite::i2cErrors() const
+{
+    return {lightSensor.errorCount(), powerSensor.errorCount(), imuSensor.errorCount()};
+}
+
+void SensorSuite::setFastSampling(bool imu, bool power)
+{
+    if (imu != imuFast)
+    {
+        imuFast = imu;
+        imuSensor.setSamplePeriodMs(imu ? IMU_FAST_PERIOD_MS : IMU_PERIOD_MS);
+    }
+
+    if (power != powerFast)
+    {
+        powerFast = power;
+        powerSensor.setSamplePeriodMs(power ? POWER_FAST_PERIOD_MS : POWER_PERIOD_MS);
+    }
+}
@@ -51,6 +51,7 @@ void Bh1750Sensor::update(uint32_t now_ms)
 
 bool Bh1750Sensor::hasReading() const { return has_reading_; }
 float Bh1750Sensor::lux() const { return lux_; }
+uint32_t Bh1750Sensor::errorCount() const { return i2c_errors_; }
 
 bool Bh1750Sensor::startContinuousHighRes_()
 {
@@ -63,7 +64,10 @@ bool Bh1750Sensor::readLux_()
 {
     const uint8_t n = cfg_.wire->requestFrom(static_cast<int>(cfg_.address), 2);
     if (n != 2)
+    {
+        ++i2c_errors_;
         return false;
+    }
 
     const uint16_t raw = (static_cast<uint16_t>(cfg_.wire->read()) << 8) |
                          static_cast<uint16_t>(cfg_.wire->read());
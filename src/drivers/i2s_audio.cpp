@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cmath>
 #include <driver/i2s.h>
+#include <freertos/queue.h>
 
 I2sAudio::I2sAudio(const Config &cfg) : cfg_(cfg) {}
 
@@ -13,6 +14,14 @@ namespace
 #else
     constexpr i2s_comm_format_t kI2sCommFormat = I2S_COMM_FORMAT_I2S;
 #endif
+
+    constexpr uint32_t kTaskStack = 3072;
+    constexpr UBaseType_t kTaskPriority = 2;
+    constexpr BaseType_t kTaskCore = 0;
+    constexpr UBaseType_t kQueueDepth = 4;
+    // Frames per i2s_write; also how far into a sound a cancel can lag.
+    constexpr uint32_t kChunkFrames = 256;
+    constexpr float kTwoPi = 2.0f * 3.14159265358979323846f;
 }
 
 bool I2sAudio::begin()
@@ -43,6 +52,12 @@ bool I2sAudio::begin()
     if (i2s_zero_dma_buffer(I2S_NUM_0) != ESP_OK)
         return false;
 
+    queue_ = xQueueCreate(kQueueDepth, sizeof(Request));
+    if (!queue_)
+        return false;
+    if (xTaskCreatePinnedToCore(task_, "audio", kTaskStack, this, kTaskPriority, &task_handle_, kTaskCore) != pdPASS)
+        return false;
+
     ok_ = true;
     return true;
 }
@@ -53,36 +68,100 @@ void I2sAudio::setVolume(float v)
         v = 0.0f;
     if (v > 1.0f)
         v = 1.0f;
-    volume_ = v;
+    volume_.store(v, std::memory_order_relaxed);
 }
 
-float I2sAudio::volume() const { return volume_; }
+float I2sAudio::volume() const { return volume_.load(std::memory_order_relaxed); }
+
+bool I2sAudio::playBeep(uint16_t freq_hz, uint16_t duration_ms, Mode mode)
+{
+    if (!ok_)
+        return false;
+
+    Request req;
+    req.freq_hz = freq_hz;
+    req.duration_ms = duration_ms;
+    if (mode == Mode::Preempt)
+    {
+        req.generation = generation_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        xQueueReset(queue_);
+    }
+    else
+    {
+        req.generation = generation_.load(std::memory_order_acquire);
+    }
+    return xQueueSendToBack(queue_, &req, 0) == pdTRUE;
+}
 
-void I2sAudio::playBeep(uint16_t freq_hz, uint16_t duration_ms)
+void I2sAudio::stop()
 {
     if (!ok_)
         return;
+    generation_.fetch_add(1, std::memory_order_acq_rel);
+    xQueueReset(queue_);
+}
+
+bool I2sAudio::isPlaying() const { return playing_.load(std::memory_order_relaxed); }
 
+TaskHandle_t I2sAudio::taskHandle() const { return task_handle_; }
+
+bool I2sAudio::cancelled_(const Request &req) const
+{
+    return req.generation != generation_.load(std::memory_order_acquire);
+}
+
+void I2sAudio::task_(void *arg)
+{
+    static_cast<I2sAudio *>(arg)->run_();
+}
+
+void I2sAudio::run_()
+{
+    Request req;
+    for (;;)
+    {
+        if (xQueueReceive(queue_, &req, portMAX_DELAY) != pdTRUE)
+            continue;
+        // Queued before a stop() or a preempting request.
+        if (cancelled_(req))
+            continue;
+
+        playing_.store(true, std::memory_order_relaxed);
+        const bool finished = synthesize_(req);
+        // Drop what is still in DMA so the cut is immediate.
+        if (!finished)
+            i2s_zero_dma_buffer(I2S_NUM_0);
+        playing_.store(false, std::memory_order_relaxed);
+    }
+}
+
+bool I2sAudio::synthesize_(const Request &req)
+{
     const uint32_t sr = cfg_.sample_rate_hz;
-    const uint32_t total_samples = (uint32_t)((uint64_t)sr * duration_ms / 1000ULL);
+    const uint32_t total_samples = (uint32_t)((uint64_t)sr * req.duration_ms / 1000ULL);
     if (total_samples == 0)
-        return;
+        return true;
 
-    const float amp = 0.25f * volume_; // safe headroom
-    const float w = 2.0f * 3.14159265358979323846f * (float)freq_hz / (float)sr;
+    const float amp = 0.25f * volume(); // safe headroom
+    const float w = kTwoPi * (float)req.freq_hz / (float)sr;
     float phase = 0.0f;
 
     // Duplicate mono samples onto both I2S slots.
-    int16_t buf[512];
+    int16_t buf[kChunkFrames * 2];
     uint32_t produced = 0;
 
     while (produced < total_samples)
     {
-        const uint32_t chunk = std::min<uint32_t>(256, total_samples - produced);
+        if (cancelled_(req))
+            return false;
+
+        const uint32_t chunk = std::min<uint32_t>(kChunkFrames, total_samples - produced);
 
         for (uint32_t i = 0; i < chunk; ++i)
         {
             phase += w;
+            if (phase > kTwoPi)
+                phase -= kTwoPi;
             const float s = sinf(phase);
             const int16_t sample = (int16_t)(s * 32767.0f * amp);
             buf[(i * 2) + 0] = sample;
@@ -93,4 +172,5 @@ void I2sAudio::playBeep(uint16_t freq_hz, uint16_t duration_ms)
         i2s_write(I2S_NUM_0, buf, chunk * 2 * sizeof(int16_t), &bytes_written, portMAX_DELAY);
         produced += chunk;
     }
+    return true;
 }
@@ -50,6 +50,11 @@ void Ina226Sensor::update(uint32_t now_ms)
         has_reading_ = true;
 }
 
+void Ina226Sensor::setSamplePeriodMs(uint32_t period_ms)
+{
+    cfg_.sample_period_ms = period_ms;
+}
+
 bool Ina226Sensor::isOk() const
 {
     return ok_;
@@ -65,13 +70,23 @@ const Ina226Sensor::Reading &Ina226Sensor::reading() const
     return reading_;
 }
 
+uint32_t Ina226Sensor::errorCount() const
+{
+    return i2c_errors_;
+}
+
 bool Ina226Sensor::writeRegister_(uint8_t reg, uint16_t value)
 {
     cfg_.wire->beginTransmission(cfg_.address);
     cfg_.wire->write(reg);
     cfg_.wire->write(static_cast<uint8_t>((value >> 8) & 0xFF));
     cfg_.wire->write(static_cast<uint8_t>(value & 0xFF));
-    return cfg_.wire->endTransmission() == 0;
+    if (cfg_.wire->endTransmission() != 0)
+    {
+        ++i2c_errors_;
+        return false;
+    }
+    return true;
 }
 
 bool Ina226Sensor::readRegister_(uint8_t reg, uint16_t &value)
@@ -79,11 +94,17 @@ bool Ina226Sensor::readRegister_(uint8_t reg, uint16_t &value)
     cfg_.wire->beginTransmission(cfg_.address);
     cfg_.wire->write(reg);
     if (cfg_.wire->endTransmission(false) != 0)
+    {
+        ++i2c_errors_;
         return false;
+    }
 
     const uint8_t requested = cfg_.wire->requestFrom(static_cast<int>(cfg_.address), 2);
     if (requested != 2)
+    {
+        ++i2c_errors_;
         return false;
+    }
 
     value = static_cast<uint16_t>(cfg_.wire->read()) << 8;
     value |= static_cast<uint16_t>(cfg_.wire->read());
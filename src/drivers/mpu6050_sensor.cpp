@@ -55,6 +55,11 @@ void Mpu6050Sensor::update(uint32_t now_ms)
     has_reading_ = readSample_();
 }
 
+void Mpu6050Sensor::setSamplePeriodMs(uint32_t period_ms)
+{
+    cfg_.sample_period_ms = period_ms;
+}
+
 void Mpu6050Sensor::setAddress(uint8_t address)
 {
     cfg_.address = address;
@@ -66,13 +71,19 @@ uint8_t Mpu6050Sensor::address() const { return cfg_.address; }
 bool Mpu6050Sensor::isOk() const { return ok_; }
 bool Mpu6050Sensor::hasReading() const { return has_reading_; }
 const Mpu6050Sensor::Reading &Mpu6050Sensor::reading() const { return reading_; }
+uint32_t Mpu6050Sensor::errorCount() const { return i2c_errors_; }
 
 bool Mpu6050Sensor::writeRegister_(uint8_t reg, uint8_t value)
 {
     cfg_.wire->beginTransmission(cfg_.address);
     cfg_.wire->write(reg);
     cfg_.wire->write(value);
-    return cfg_.wire->endTransmission() == 0;
+    if (cfg_.wire->endTransmission() != 0)
+    {
+        ++i2c_errors_;
+        return false;
+    }
+    return true;
 }
 
 bool Mpu6050Sensor::readRegisters_(uint8_t start_reg, uint8_t *buffer, size_t len)
@@ -80,12 +91,18 @@ bool Mpu6050Sensor::readRegisters_(uint8_t start_reg, uint8_t *buffer, size_t le
     cfg_.wire->beginTransmission(cfg_.address);
     cfg_.wire->write(start_reg);
     if (cfg_.wire->endTransmission(false) != 0)
+    {
+        ++i2c_errors_;
         return false;
+    }
 
     const uint8_t requested = cfg_.wire->requestFrom(static_cast<int>(cfg_.address),
                                                      static_cast<int>(len));
     if (requested != len)
+    {
+        ++i2c_errors_;
         return false;
+    }
 
     for (size_t i = 0; i < len; ++i)
         buffer[i] = static_cast<uint8_t>(cfg_.wire->read());
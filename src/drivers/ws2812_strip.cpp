@@ -0,0 +1,153 @@
+#include "drivers/ws2812_strip.h"
+
+#include <cstring>
+
+namespace
+{
+    // 80 MHz APB / 2 = 25 ns per tick.
+    constexpr uint8_t kClockDiv = 2;
+
+    constexpr uint32_t item(uint32_t high_ticks, uint32_t low_ticks)
+    {
+        return high_ticks | (1u << 15) | (low_ticks << 16);
+    }
+
+    // WS2812B: 0 = 400 ns high + 850 ns low, 1 = 800 ns high + 450 ns low.
+    constexpr uint32_t kBit0 = item(16, 34);
+    constexpr uint32_t kBit1 = item(32, 18);
+
+    // Runs in the RMT ISR: expands up to wanted_num bits of the frame into
+    // pulse items, whole bytes at a time.
+    void IRAM_ATTR translate(const void *src, rmt_item32_t *dest, size_t src_size,
+                             size_t wanted_num, size_t *translated_size, size_t *item_num)
+    {
+        if (!src || !dest)
+        {
+            *translated_size = 0;
+            *item_num = 0;
+            return;
+        }
+
+        const uint8_t *in = static_cast<const uint8_t *>(src);
+        size_t bytes = 0;
+        size_t items = 0;
+        while (bytes < src_size && items + 8 <= wanted_num)
+        {
+            const uint8_t v = in[bytes++];
+            for (uint8_t bit = 0x80; bit; bit >>= 1)
+                dest[items++].val = (v & bit) ? kBit1 : kBit0;
+        }
+
+        *translated_size = bytes;
+        *item_num = items;
+    }
+}
+
+Ws2812Strip::Ws2812Strip(const Config &cfg) : cfg_(cfg) {}
+
+bool Ws2812Strip::begin()
+{
+    rmt_config_t config = {};
+    config.rmt_mode = RMT_MODE_TX;
+    config.channel = cfg_.channel;
+    config.gpio_num = cfg_.data_pin;
+    config.clk_div = kClockDiv;
+    // Two blocks (128 items) leave the ISR a full pixel of slack when WiFi
+    // delays a refill.
+    config.mem_block_num = 2;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+    config.tx_config.idle_output_en = true;
+
+    if (rmt_config(&config) != ESP_OK)
+        return false;
+    if (rmt_driver_install(cfg_.channel, 0, 0) != ESP_OK)
+        return false;
+    if (rmt_translator_init(cfg_.channel, translate) != ESP_OK)
+        return false;
+
+    const size_t bytes = frameBytes_();
+    frames_[0] = new uint8_t[bytes]();
+    frames_[1] = new uint8_t[bytes]();
+
+    ok_ = true;
+    return true;
+}
+
+size_t Ws2812Strip::frameBytes_() const
+{
+    return static_cast<size_t>(cfg_.led_count) * 3;
+}
+
+uint8_t *Ws2812Strip::draft_()
+{
+    return frames_[wire_ ^ 1];
+}
+
+void Ws2812Strip::setPixel(uint16_t i, uint8_t r, uint8_t g, uint8_t b)
+{
+    if (!ok_ || i >= cfg_.led_count)
+        return;
+
+    // Wire order is GRB.
+    uint8_t *p = draft_() + static_cast<size_t>(i) * 3;
+    p[0] = g;
+    p[1] = r;
+    p[2] = b;
+}
+
+void Ws2812Strip::fill(uint8_t r, uint8_t g, uint8_t b)
+{
+    for (uint16_t i = 0; i < cfg_.led_count; ++i)
+        setPixel(i, r, g, b);
+}
+
+void Ws2812Strip::clear()
+{
+    if (ok_)
+        memset(draft_(), 0, frameBytes_());
+}
+
+uint8_t *Ws2812Strip::pixels()
+{
+    return ok_ ? draft_() : nullptr;
+}
+
+void Ws2812Strip::show()
+{
+    showRequested_ = true;
+    update();
+}
+
+void Ws2812Strip::update()
+{
+    if (!ok_ || !showRequested_)
+        return;
+
+    const size_t bytes = frameBytes_();
+    uint8_t *draft = draft_();
+    if (hasSent_ && memcmp(draft, frames_[wire_], bytes) == 0)
+    {
+        showRequested_ = false;
+        ++skipped_;
+        return;
+    }
+
+    // Previous frame still going out; the draft waits for the next call.
+    // The gap until then is also the >50 us low the strip needs to latch.
+    if (rmt_wait_tx_done(cfg_.channel, 0) != ESP_OK)
+        return;
+    if (rmt_write_sample(cfg_.channel, draft, bytes, false) != ESP_OK)
+        return;
+
+    wire_ ^= 1;
+    hasSent_ = true;
+    showRequested_ = false;
+    ++sent_;
+
+    // The next draft starts from what is now on the wire.
+    memcpy(draft_(), frames_[wire_], bytes);
+}
+
+uint32_t Ws2812Strip::framesSent() const { return sent_; }
+
+uint32_t Ws2812Strip::framesSkipped() const { return skipped_; }
@@ -1,136 +1,120 @@
 #include "net/backend_client.h"
 #include "net/backend_config.h"
+#include "net/fault_injection.h"
+#include "net/json_pool.h"
+#include "net/metrics.h"
+#include "net/state_schema.h"
+#include "net/wifi_manager.h"
+#include "app_config.h"
 #include "secrets.h"
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
+#include <atomic>
 #include <cstring>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
 #include <freertos/task.h>
-#include <ping/ping_sock.h>
 
 namespace
 {
-    constexpr uint8_t REQUEST_QUEUE_LENGTH = 8;
+    constexpr uint8_t EVENT_QUEUE_LENGTH = 8;
     constexpr uint32_t WORKER_IDLE_MS = 25;
     constexpr size_t EVENT_NAME_CAP = 64;
-    constexpr size_t TEXT_FIELD_CAP = 64;
-    constexpr size_t SHORT_TEXT_FIELD_CAP = 24;
-    constexpr size_t RFID_UID_CAP = 48;
 
-    struct PingContext
+    using BackendClient::Circuit;
+
+    enum class Outcome : uint8_t
     {
-        volatile bool finished;
-        volatile uint32_t minTimeMs;
-        volatile uint32_t maxTimeMs;
-        volatile uint32_t sumTimeMs;
+        Ok,
+        Rejected, // the backend answered and refused; retrying will not help
+        Failed,   // transport error, timeout or 5xx; worth another attempt
     };
 
-    enum class RequestType : uint8_t
+    enum class RequestClass : uint8_t
     {
         Register,
         Event,
+        State,
     };
-
-    struct BackendRequest
+    constexpr size_t CLASS_COUNT = 3;
+
+    // First retry delay, backoff ceiling and attempts before a request is
+    // dropped (0 = until it is delivered: there is always a newest register
+    // and state worth sending, while a stale event is worth little), and
+    // whether a refusal backs off and retries like a failure. A refused
+    // register leaves the robot unknown to the backend, and it is only
+    // queued once per link-up, so nothing else would send it again.
+    struct RetryPolicy
     {
-        RequestType type;
-        uint16_t robotPort;
-        char eventName[EVENT_NAME_CAP];
+        uint32_t baseMs;
+        uint32_t maxMs;
+        uint8_t maxAttempts;
+        bool retryRejected;
     };
 
-    struct StatePayload
-    {
-        int batteryLevel;
-        char systemHealth[SHORT_TEXT_FIELD_CAP];
-        char driveMode[SHORT_TEXT_FIELD_CAP];
-        char cargoStatus[SHORT_TEXT_FIELD_CAP];
-        char currentPosition[TEXT_FIELD_CAP];
-        char lastNode[TEXT_FIELD_CAP];
-        char targetNode[TEXT_FIELD_CAP];
-        bool hasGyroscope;
-        float gyroXDps;
-        float gyroYDps;
-        float gyroZDps;
-        bool hasRfid;
-        char lastReadUuid[RFID_UID_CAP];
-        bool hasLux;
-        float lux;
-        bool hasInfrared;
-        bool infraredFront;
-        bool infraredLeft;
-        bool infraredRight;
-        bool hasPower;
-        float voltageV;
-        float currentA;
-        float powerW;
+    constexpr RetryPolicy POLICIES[CLASS_COUNT] = {
+        {1000, 60000, 0, true}, // Register
+        {500, 5000, 4, false},  // Event
+        {250, 10000, 0, false}, // State
     };
 
-    QueueHandle_t g_requestQueue = nullptr;
-    TaskHandle_t g_workerTask = nullptr;
-    portMUX_TYPE g_stateMux = portMUX_INITIALIZER_UNLOCKED;
-    StatePayload g_statePayload{};
-    uint32_t g_stateSequence = 0;
-    bool g_statePending = false;
+    struct RetryState
+    {
+        uint8_t failures;
+        uint32_t nextAttemptMs;
+    };
 
-    void copyStringField(char *dest, size_t destSize, const String &value)
+    struct EventRequest
     {
-        if (!dest || destSize == 0)
-            return;
+        char name[EVENT_NAME_CAP];
+    };
 
-        const size_t n = value.length();
-        const size_t copyLen = (n < (destSize - 1)) ? n : (destSize - 1);
-        memcpy(dest, value.c_str(), copyLen);
-        dest[copyLen] = '\0';
-    }
+    QueueHandle_t g_eventQueue = nullptr;
+    TaskHandle_t g_workerTask = nullptr;
 
-    void onPingSuccess(esp_ping_handle_t hdl, void *args)
-    {
-        auto *ctx = static_cast<PingContext *>(args);
+    // Control task -> worker. Register and state are latest-wins slots, so
+    // re-queueing while one is outstanding (or backing off) adds nothing.
+    portMUX_TYPE g_pendingMux = portMUX_INITIALIZER_UNLOCKED;
+    StateSchema::Snapshot g_statePayload{};
+    uint32_t g_stateSequence = 0;
+    bool g_statePending = false;
+    uint16_t g_registerPort = 0;
+    bool g_registerPending = false;
 
-        uint16_t seqno = 0;
-        uint8_t ttl = 0;
-        uint32_t elapsedMs = 0;
-        uint32_t packetSize = 0;
-        ip_addr_t replyAddr;
-        char addrBuf[IPADDR_STRLEN_MAX] = {0};
+    // Worker task only.
+    RetryState g_retry[CLASS_COUNT] = {};
+    EventRequest g_heldEvent{};
+    bool g_hasHeldEvent = false;
+    bool g_wasOnline = false;
+    uint8_t g_consecutiveFailures = 0;
+    uint32_t g_openUntilMs = 0;
+    uint32_t g_openMs = AppConfig::BACKEND_BREAKER_OPEN_MS;
 
-        esp_ping_get_profile(hdl, ESP_PING_PROF_SEQNO, &seqno, sizeof(seqno));
-        esp_ping_get_profile(hdl, ESP_PING_PROF_TTL, &ttl, sizeof(ttl));
-        esp_ping_get_profile(hdl, ESP_PING_PROF_TIMEGAP, &elapsedMs, sizeof(elapsedMs));
-        esp_ping_get_profile(hdl, ESP_PING_PROF_SIZE, &packetSize, sizeof(packetSize));
-        esp_ping_get_profile(hdl, ESP_PING_PROF_IPADDR, &replyAddr, sizeof(replyAddr));
+    std::atomic<Circuit> g_circuit{Circuit::Closed};
 
-        ipaddr_ntoa_r(&replyAddr, addrBuf, sizeof(addrBuf));
+    // Negative codes are HTTPClient transport errors (connect, timeout, ...).
+    Metrics::StatusTable g_postResponses("robot_backend_http_responses_total", "Backend POST responses by path and status code", "path");
 
-        if (ctx->minTimeMs == 0 || elapsedMs < ctx->minTimeMs)
-            ctx->minTimeMs = elapsedMs;
-        if (elapsedMs > ctx->maxTimeMs)
-            ctx->maxTimeMs = elapsedMs;
-        ctx->sumTimeMs += elapsedMs;
+    Metrics::Counter g_registerRetries("robot_backend_retries_total", "Backend POSTs rescheduled after a failure", "class=\"register\"");
+    Metrics::Counter g_eventRetries("robot_backend_retries_total", "Backend POSTs rescheduled after a failure", "class=\"event\"");
+    Metrics::Counter g_stateRetries("robot_backend_retries_total", "Backend POSTs rescheduled after a failure", "class=\"state\"");
+    Metrics::Counter *const RETRY_COUNTERS[CLASS_COUNT] = {&g_registerRetries, &g_eventRetries, &g_stateRetries};
 
-        Serial.printf("%lu bytes from %s: icmp_seq=%u ttl=%u time=%lums\n",
-                      static_cast<unsigned long>(packetSize),
-                      addrBuf,
-                      static_cast<unsigned>(seqno),
-                      static_cast<unsigned>(ttl),
-                      static_cast<unsigned long>(elapsedMs));
-    }
+    Metrics::Counter g_eventsDropped("robot_backend_events_dropped_total", "Events given up on after a refusal or the last retry");
+    Metrics::Counter g_circuitOpens("robot_backend_circuit_opens_total", "Times the backend circuit breaker opened");
 
-    void onPingTimeout(esp_ping_handle_t hdl, void *)
+    void writeCircuitGauge(Metrics::Writer &w)
     {
-        uint16_t seqno = 0;
-        esp_ping_get_profile(hdl, ESP_PING_PROF_SEQNO, &seqno, sizeof(seqno));
-        Serial.printf("Request timeout for icmp_seq %u\n", static_cast<unsigned>(seqno));
+        w.family("robot_backend_circuit_state", "gauge", "0 closed, 1 open, 2 half-open");
+        w.sample("robot_backend_circuit_state", nullptr, static_cast<uint32_t>(g_circuit.load(std::memory_order_relaxed)));
     }
+    Metrics::Collector g_circuitGauge(writeCircuitGauge);
 
-    void onPingEnd(esp_ping_handle_t, void *args)
-    {
-        auto *ctx = static_cast<PingContext *>(args);
-        ctx->finished = true;
-    }
+    // Worker-task scratch memory; the public blocking calls use their own.
+    StaticJsonPool<AppConfig::BACKEND_JSON_POOL_BYTES> g_workerJsonPool;
+    char g_workerJsonOut[AppConfig::BACKEND_JSON_OUT_BYTES];
 
     String backendUrl(const char *path)
     {
@@ -138,12 +122,21 @@ namespace
                BackendConfig::HOST + ":" + String(BackendConfig::PORT) + String(path);
     }
 
-    bool postJsonBlocking(const char *path, const String &jsonBody)
+    Outcome classify(int code)
     {
-        if (WiFi.status() != WL_CONNECTED)
+        if (code >= 200 && code < 300)
+            return Outcome::Ok;
+        if (code < 0 || code >= 500 || code == 408 || code == 429)
+            return Outcome::Failed;
+        return Outcome::Rejected;
+    }
+
+    Outcome postJsonBlocking(const char *path, char *jsonBody, size_t jsonLength)
+    {
+        if (!WifiManager::isConnected())
         {
             Serial.println("[backend] request failed: wifi not connected");
-            return false;
+            return Outcome::Failed;
         }
 
         HTTPClient http;
@@ -157,431 +150,379 @@ namespace
             else if (BackendConfig::TLS_CA_CERT)
                 client.setCACert(BackendConfig::TLS_CA_CERT);
 
-            http.begin(client, url);
+            FaultInjection::FaultyClient faulty(client, true);
+            http.begin(AppConfig::NET_FAULT_INJECTION ? static_cast<WiFiClient &>(faulty) : static_cast<WiFiClient &>(client), url);
             http.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
             http.setRedirectLimit(3);
             http.setTimeout(3000);
             http.addHeader("Content-Type", "application/json");
             http.addHeader("X-Api-Key", Secrets::ROBOT_API_KEY);
 
-            const int code = http.POST(jsonBody);
+            const int code = http.POST(reinterpret_cast<uint8_t *>(jsonBody), jsonLength);
             String resp = http.getString();
             http.end();
 
+            g_postResponses.inc(path, code);
             Serial.printf("[backend] POST %s code=%d resp=%s\n", path, code, resp.c_str());
-            return code >= 200 && code < 300;
+            return classify(code);
         }
 
         WiFiClient client;
-        http.begin(client, url);
+        FaultInjection::FaultyClient faulty(client, false);
+        http.begin(AppConfig::NET_FAULT_INJECTION ? static_cast<WiFiClient &>(faulty) : client, url);
         http.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
         http.setRedirectLimit(3);
         http.setTimeout(3000);
         http.addHeader("Content-Type", "application/json");
         http.addHeader("X-Api-Key", Secrets::ROBOT_API_KEY);
 
-        const int code = http.POST(jsonBody);
+        const int code = http.POST(reinterpret_cast<uint8_t *>(jsonBody), jsonLength);
         String resp = http.getString();
         http.end();
 
+        g_postResponses.inc(path, code);
         Serial.printf("[backend] POST %s code=%d resp=%s\n", path, code, resp.c_str());
-        return code >= 200 && code < 300;
+        return classify(code);
     }
 
-    bool registerRobotBlocking(uint16_t robotPort)
+    Outcome postDocumentBlocking(const char *path, const JsonDocument &doc, char *out, size_t outSize)
     {
-        JsonDocument doc;
-        doc["port"] = robotPort;
-        String payload;
-        serializeJson(doc, payload);
-        return postJsonBlocking("/table/register", payload);
-    }
-
-    bool postStateBlocking(const String &systemHealth,
-                           int batteryLevel,
-                           const String &driveMode,
-                           const String &cargoStatus,
-                           const String &currentPosition,
-                           const String &lastNode,
-                           const String &targetNode,
-                           bool hasGyroscope,
-                           float gyroXDps,
-                           float gyroYDps,
-                           float gyroZDps,
-                           bool hasRfid,
-                           const String &lastReadUuid,
-                           bool hasLux,
-                           float lux,
-                           bool hasInfrared,
-                           bool infraredFront,
-                           bool infraredLeft,
-                           bool infraredRight,
-                           bool hasPower,
-                           float voltageV,
-                           float currentA,
-                           float powerW)
-    {
-        JsonDocument doc;
-        doc["systemHealth"] = systemHealth;
-        doc["batteryLevel"] = batteryLevel;
-        doc["driveMode"] = driveMode;
-        doc["cargoStatus"] = cargoStatus;
-        doc["currentPosition"] = currentPosition;
-        doc["lastNode"] = lastNode;
-        doc["targetNode"] = targetNode;
-
-        if (hasGyroscope)
+        const size_t len = serializeJson(doc, out, outSize);
+        if (doc.overflowed() || len == 0 || len >= outSize - 1)
         {
-            JsonObject gyroscope = doc["gyroscope"].to<JsonObject>();
-            gyroscope["xDps"] = gyroXDps;
-            gyroscope["yDps"] = gyroYDps;
-            gyroscope["zDps"] = gyroZDps;
+            Serial.printf("[backend] POST %s skipped: payload exceeds %u bytes\n", path, static_cast<unsigned>(outSize));
+            return Outcome::Rejected;
         }
 
-        if (hasRfid)
-            doc["lastReadUuid"] = lastReadUuid;
-
-        if (hasLux)
-            doc["lux"] = lux;
-
-        if (hasInfrared)
-        {
-            JsonObject infrared = doc["infrared"].to<JsonObject>();
-            infrared["front"] = infraredFront;
-            infrared["left"] = infraredLeft;
-            infrared["right"] = infraredRight;
-        }
+        return postJsonBlocking(path, out, len);
+    }
 
-        if (hasPower)
-        {
-            doc["voltageV"] = voltageV;
-            doc["currentA"] = currentA;
-            doc["powerW"] = powerW;
-        }
+    Outcome registerRobotBlocking(JsonDocument &doc, char *out, size_t outSize, uint16_t robotPort)
+    {
+        doc.clear();
+        doc["port"] = robotPort;
+        return postDocumentBlocking("/table/register", doc, out, outSize);
+    }
 
-        String payload;
-        serializeJson(doc, payload);
-        return postJsonBlocking("/table/state", payload);
+    Outcome postStateBlocking(JsonDocument &doc, char *out, size_t outSize, const StateSchema::Snapshot &state)
+    {
+        doc.clear();
+        StateSchema::writeJson(state, doc.to<JsonObject>(), StateSchema::Target::Backend);
+        return postDocumentBlocking("/table/state", doc, out, outSize);
     }
 
-    bool postEventBlocking(const String &eventName)
+    Outcome postEventBlocking(JsonDocument &doc, char *out, size_t outSize, const char *eventName)
     {
-        JsonDocument doc;
+        doc.clear();
         doc["event"] = eventName;
         doc["timestamp"] = (uint32_t)millis();
-
-        String payload;
-        serializeJson(doc, payload);
-        return postJsonBlocking("/table/event", payload);
+        return postDocumentBlocking("/table/event", doc, out, outSize);
     }
 
-    bool tryTakePendingState(StatePayload &out, uint32_t &sequence)
+    bool tryTakePendingState(StateSchema::Snapshot &out, uint32_t &sequence)
     {
         bool hasState = false;
 
-        portENTER_CRITICAL(&g_stateMux);
+        portENTER_CRITICAL(&g_pendingMux);
         if (g_statePending)
         {
             out = g_statePayload;
             sequence = g_stateSequence;
             hasState = true;
         }
-        portEXIT_CRITICAL(&g_stateMux);
+        portEXIT_CRITICAL(&g_pendingMux);
 
         return hasState;
     }
 
-    void finishPendingState(uint32_t sequence, bool success)
+    void finishPendingState(uint32_t sequence)
     {
-        portENTER_CRITICAL(&g_stateMux);
-        if (success && g_statePending && g_stateSequence == sequence)
+        portENTER_CRITICAL(&g_pendingMux);
+        if (g_statePending && g_stateSequence == sequence)
             g_statePending = false;
-        portEXIT_CRITICAL(&g_stateMux);
+        portEXIT_CRITICAL(&g_pendingMux);
     }
 
-    void backendWorkerTask(void *)
+    bool tryTakePendingRegister(uint16_t &port)
     {
-        for (;;)
-        {
-            BackendRequest request{};
-            if (g_requestQueue && xQueueReceive(g_requestQueue, &request, pdMS_TO_TICKS(WORKER_IDLE_MS)) == pdTRUE)
-            {
-                switch (request.type)
-                {
-                case RequestType::Register:
-                    registerRobotBlocking(request.robotPort);
-                    break;
-
-                case RequestType::Event:
-                    postEventBlocking(String(request.eventName));
-                    break;
-                }
-                continue;
-            }
+        portENTER_CRITICAL(&g_pendingMux);
+        const bool pending = g_registerPending;
+        port = g_registerPort;
+        portEXIT_CRITICAL(&g_pendingMux);
+        return pending;
+    }
 
-            StatePayload state{};
-            uint32_t sequence = 0;
-            if (tryTakePendingState(state, sequence))
-            {
-                const bool ok = postStateBlocking(String(state.systemHealth),
-                                                  state.batteryLevel,
-                                                  String(state.driveMode),
-                                                  String(state.cargoStatus),
-                                                  String(state.currentPosition),
-                                                  String(state.lastNode),
-                                                  String(state.targetNode),
-                                                  state.hasGyroscope,
-                                                  state.gyroXDps,
-                                                  state.gyroYDps,
-                                                  state.gyroZDps,
-                                                  state.hasRfid,
-                                                  String(state.lastReadUuid),
-                                                  state.hasLux,
-                                                  state.lux,
-                                                  state.hasInfrared,
-                                                  state.infraredFront,
-                                                  state.infraredLeft,
-                                                  state.infraredRight,
-                                                  state.hasPower,
-                                                  state.voltageV,
-                                                  state.currentA,
-                                                  state.powerW);
-                finishPendingState(sequence, ok);
-                continue;
-            }
+    void finishPendingRegister()
+    {
+        portENTER_CRITICAL(&g_pendingMux);
+        g_registerPending = false;
+        portEXIT_CRITICAL(&g_pendingMux);
+    }
 
-            vTaskDelay(pdMS_TO_TICKS(WORKER_IDLE_MS));
-        }
+    uint32_t backoffMs(uint8_t failures, uint32_t baseMs, uint32_t maxMs)
+    {
+        const uint8_t shift = failures < 16 ? failures : 16;
+        uint32_t delayMs = baseMs << shift;
+        if (delayMs > maxMs || delayMs < baseMs)
+            delayMs = maxMs;
+        // Up to +25 %, so a fleet that lost the backend together does not
+        // come back in lockstep.
+        return delayMs + esp_random() % (delayMs / 4 + 1);
     }
-}
 
-namespace BackendClient
-{
-    void begin()
+    void setCircuit(Circuit next)
     {
-        if (!g_requestQueue)
-            g_requestQueue = xQueueCreate(REQUEST_QUEUE_LENGTH, sizeof(BackendRequest));
+        g_circuit.store(next, std::memory_order_relaxed);
+    }
 
-        if (!g_workerTask && g_requestQueue)
-            xTaskCreatePinnedToCore(backendWorkerTask, "backend-http", 6144, nullptr, 1, &g_workerTask, tskNO_AFFINITY);
+    void openCircuit(uint32_t nowMs)
+    {
+        const uint32_t pauseMs = backoffMs(0, g_openMs, g_openMs);
+        g_openUntilMs = nowMs + pauseMs;
+        setCircuit(Circuit::Open);
+        g_circuitOpens.inc();
+        Serial.printf("[backend] circuit open, next probe in %lu ms\n", static_cast<unsigned long>(pauseMs));
+    }
+
+    // Open: nothing is posted until the pause ends. Half-open: the next
+    // request is the probe; the worker sends one request at a time, so it
+    // is also the only one.
+    bool circuitAllows(uint32_t nowMs)
+    {
+        if (g_circuit.load(std::memory_order_relaxed) != Circuit::Open)
+            return true;
+        if (static_cast<int32_t>(nowMs - g_openUntilMs) < 0)
+            return false;
+
+        setCircuit(Circuit::HalfOpen);
+        Serial.println("[backend] circuit half-open, probing");
+        return true;
     }
 
-    PingResult ping()
+    void recordCircuit(bool reachable, uint32_t nowMs)
     {
-        PingResult result;
-        result.wifiConnected = (WiFi.status() == WL_CONNECTED);
-        result.targetValid = false;
-        result.sessionStarted = false;
-        result.sessionFinished = false;
-        result.transmitted = 0;
-        result.received = 0;
-        result.durationMs = 0;
-        result.minTimeMs = 0;
-        result.maxTimeMs = 0;
-        result.avgTimeMs = 0;
+        const Circuit circuit = g_circuit.load(std::memory_order_relaxed);
+        if (reachable)
+        {
+            if (circuit != Circuit::Closed)
+                Serial.println("[backend] circuit closed");
+            setCircuit(Circuit::Closed);
+            g_consecutiveFailures = 0;
+            g_openMs = AppConfig::BACKEND_BREAKER_OPEN_MS;
+            return;
+        }
 
-        if (!result.wifiConnected)
-            return result;
+        if (circuit == Circuit::HalfOpen)
+        {
+            g_openMs = (g_openMs < AppConfig::BACKEND_BREAKER_OPEN_MAX_MS / 2) ? g_openMs * 2 : AppConfig::BACKEND_BREAKER_OPEN_MAX_MS;
+            openCircuit(nowMs);
+            return;
+        }
 
-        esp_ping_config_t config = ESP_PING_DEFAULT_CONFIG();
-        config.count = 4;
-        config.interval_ms = 1000;
-        config.timeout_ms = 1000;
+        if (g_consecutiveFailures < UINT8_MAX)
+            ++g_consecutiveFailures;
+        if (g_consecutiveFailures >= AppConfig::BACKEND_BREAKER_FAILURES)
+            openCircuit(nowMs);
+    }
 
-        if (!ipaddr_aton(BackendConfig::HOST, &config.target_addr))
-            return result;
+    // A fresh WiFi link gets a fresh start: the failures may have been ours.
+    void onLinkUp(uint32_t nowMs)
+    {
+        for (RetryState &r : g_retry)
+            r = RetryState{};
+        g_consecutiveFailures = 0;
+        if (g_circuit.load(std::memory_order_relaxed) == Circuit::Open)
+            g_openUntilMs = nowMs;
+    }
 
-        result.targetValid = true;
+    bool isDue(RequestClass cls, uint32_t nowMs)
+    {
+        const RetryState &r = g_retry[static_cast<size_t>(cls)];
+        return r.failures == 0 || static_cast<int32_t>(nowMs - r.nextAttemptMs) >= 0;
+    }
+
+    // True once the request is finished: delivered, refused (unless its
+    // class retries refusals), or out of attempts. Otherwise its class backs
+    // off before the next attempt.
+    bool settle(RequestClass cls, Outcome outcome, uint32_t nowMs)
+    {
+        recordCircuit(outcome != Outcome::Failed, nowMs);
 
-        PingContext ctx{};
-        esp_ping_handle_t pingHandle = nullptr;
-        const esp_ping_callbacks_t callbacks{
-            .cb_args = &ctx,
-            .on_ping_success = onPingSuccess,
-            .on_ping_timeout = onPingTimeout,
-            .on_ping_end = onPingEnd};
+        const size_t i = static_cast<size_t>(cls);
+        RetryState &r = g_retry[i];
+        const RetryPolicy &policy = POLICIES[i];
+        if (outcome == Outcome::Ok || (outcome == Outcome::Rejected && !policy.retryRejected))
+        {
+            r.failures = 0;
+            return true;
+        }
 
-        if (esp_ping_new_session(&config, &callbacks, &pingHandle) != ESP_OK)
-            return result;
+        if (r.failures < UINT8_MAX)
+            ++r.failures;
+        if (policy.maxAttempts != 0 && r.failures >= policy.maxAttempts)
+        {
+            r.failures = 0;
+            return true;
+        }
 
-        result.sessionStarted = true;
+        RETRY_COUNTERS[i]->inc();
+        r.nextAttemptMs = nowMs + backoffMs(r.failures - 1, policy.baseMs, policy.maxMs);
+        return false;
+    }
 
-        if (esp_ping_start(pingHandle) != ESP_OK)
+    // Sends at most one request; false if nothing was due.
+    bool runNext(JsonDocument &doc, uint32_t nowMs)
+    {
+        uint16_t port = 0;
+        if (isDue(RequestClass::Register, nowMs) && tryTakePendingRegister(port))
         {
-            esp_ping_delete_session(pingHandle);
-            return result;
+            const Outcome outcome = registerRobotBlocking(doc, g_workerJsonOut, sizeof(g_workerJsonOut), port);
+            if (settle(RequestClass::Register, outcome, nowMs))
+                finishPendingRegister();
+            return true;
         }
 
-        const uint32_t waitStartMs = millis();
-        const uint32_t waitTimeoutMs = (config.count * config.interval_ms) + config.timeout_ms + 500;
-        while (!ctx.finished && (millis() - waitStartMs) < waitTimeoutMs)
-            delay(10);
+        if (!g_hasHeldEvent && g_eventQueue)
+            g_hasHeldEvent = xQueueReceive(g_eventQueue, &g_heldEvent, 0) == pdTRUE;
+
+        if (g_hasHeldEvent && isDue(RequestClass::Event, nowMs))
+        {
+            const Outcome outcome = postEventBlocking(doc, g_workerJsonOut, sizeof(g_workerJsonOut), g_heldEvent.name);
+            if (settle(RequestClass::Event, outcome, nowMs))
+            {
+                if (outcome != Outcome::Ok)
+                    g_eventsDropped.inc();
+                g_hasHeldEvent = false;
+            }
+            return true;
+        }
 
-        if (!ctx.finished)
+        StateSchema::Snapshot state{};
+        uint32_t sequence = 0;
+        if (isDue(RequestClass::State, nowMs) && tryTakePendingState(state, sequence))
         {
-            esp_ping_stop(pingHandle);
+            const Outcome outcome = postStateBlocking(doc, g_workerJsonOut, sizeof(g_workerJsonOut), state);
+            if (settle(RequestClass::State, outcome, nowMs))
+                finishPendingState(sequence);
+            return true;
         }
 
-        uint32_t requestCount = 0;
-        uint32_t replyCount = 0;
-        uint32_t durationMs = 0;
-        esp_ping_get_profile(pingHandle, ESP_PING_PROF_REQUEST, &requestCount, sizeof(requestCount));
-        esp_ping_get_profile(pingHandle, ESP_PING_PROF_REPLY, &replyCount, sizeof(replyCount));
-        esp_ping_get_profile(pingHandle, ESP_PING_PROF_DURATION, &durationMs, sizeof(durationMs));
+        return false;
+    }
 
-        result.sessionFinished = ctx.finished;
-        result.transmitted = requestCount;
-        result.received = replyCount;
-        result.durationMs = durationMs;
-        result.minTimeMs = ctx.minTimeMs;
-        result.maxTimeMs = ctx.maxTimeMs;
-        result.avgTimeMs = (replyCount > 0) ? (ctx.sumTimeMs / replyCount) : 0;
+    void backendWorkerTask(void *)
+    {
+        for (;;)
+        {
+            const uint32_t nowMs = millis();
+            const bool online = WifiManager::isConnected();
+            if (online && !g_wasOnline)
+                onLinkUp(nowMs);
+            g_wasOnline = online;
 
-        esp_ping_delete_session(pingHandle);
+            if (online && circuitAllows(nowMs))
+            {
+                JsonDocument doc(&g_workerJsonPool);
+                if (runNext(doc, nowMs))
+                    continue;
+            }
 
-        return result;
+            vTaskDelay(pdMS_TO_TICKS(WORKER_IDLE_MS));
+        }
+    }
+}
+
+namespace BackendClient
+{
+    void begin()
+    {
+        if (!g_eventQueue)
+            g_eventQueue = xQueueCreate(EVENT_QUEUE_LENGTH, sizeof(EventRequest));
+
+        if (!g_workerTask && g_eventQueue)
+        {
+            xTaskCreatePinnedToCore(backendWorkerTask, "backend-http", 6144, nullptr, 1, &g_workerTask, tskNO_AFFINITY);
+            Metrics::trackTask(g_workerTask);
+        }
     }
 
     bool registerRobot(uint16_t robotPort)
     {
-        return registerRobotBlocking(robotPort);
+        JsonDocument doc;
+        char out[AppConfig::BACKEND_JSON_OUT_BYTES];
+        return registerRobotBlocking(doc, out, sizeof(out), robotPort) == Outcome::Ok;
     }
 
     bool queueRegisterRobot(uint16_t robotPort)
     {
         begin();
-        if (!g_requestQueue)
-            return false;
 
-        BackendRequest request{};
-        request.type = RequestType::Register;
-        request.robotPort = robotPort;
-        return xQueueSendToBack(g_requestQueue, &request, 0) == pdTRUE;
-    }
-
-    bool postState(const String &systemHealth,
-                   int batteryLevel,
-                   const String &driveMode,
-                   const String &cargoStatus,
-                   const String &currentPosition,
-                   const String &lastNode,
-                   const String &targetNode,
-                   bool hasGyroscope,
-                   float gyroXDps,
-                   float gyroYDps,
-                   float gyroZDps,
-                   bool hasRfid,
-                   const String &lastReadUuid,
-                   bool hasLux,
-                   float lux,
-                   bool hasInfrared,
-                   bool infraredFront,
-                   bool infraredLeft,
-                   bool infraredRight,
-                   bool hasPower,
-                   float voltageV,
-                   float currentA,
-                   float powerW)
-    {
-        return postStateBlocking(systemHealth,
-                                 batteryLevel,
-                                 driveMode,
-                                 cargoStatus,
-                                 currentPosition,
-                                 lastNode,
-                                 targetNode,
-                                 hasGyroscope,
-                                 gyroXDps,
-                                 gyroYDps,
-                                 gyroZDps,
-                                 hasRfid,
-                                 lastReadUuid,
-                                 hasLux,
-                                 lux,
-                                 hasInfrared,
-                                 infraredFront,
-                                 infraredLeft,
-                                 infraredRight,
-                                 hasPower,
-                                 voltageV,
-                                 currentA,
-                                 powerW);
-    }
-
-    bool queueState(const String &systemHealth,
-                    int batteryLevel,
-                    const String &driveMode,
-                    const String &cargoStatus,
-                    const String &currentPosition,
-                    const String &lastNode,
-                    const String &targetNode,
-                    bool hasGyroscope,
-                    float gyroXDps,
-                    float gyroYDps,
-                    float gyroZDps,
-                    bool hasRfid,
-                    const String &lastReadUuid,
-                    bool hasLux,
-                    float lux,
-                    bool hasInfrared,
-                    bool infraredFront,
-                    bool infraredLeft,
-                    bool infraredRight,
-                    bool hasPower,
-                    float voltageV,
-                    float currentA,
-                    float powerW)
+        portENTER_CRITICAL(&g_pendingMux);
+        g_registerPort = robotPort;
+        g_registerPending = true;
+        portEXIT_CRITICAL(&g_pendingMux);
+
+        return true;
+    }
+
+    bool postState(const StateSchema::Snapshot &state)
+    {
+        JsonDocument doc;
+        char out[AppConfig::BACKEND_JSON_OUT_BYTES];
+        return postStateBlocking(doc, out, sizeof(out), state) == Outcome::Ok;
+    }
+
+    bool queueState(const StateSchema::Snapshot &state)
     {
         begin();
 
-        StatePayload nextState{};
-        nextState.batteryLevel = batteryLevel;
-        copyStringField(nextState.systemHealth, sizeof(nextState.systemHealth), systemHealth);
-        copyStringField(nextState.driveMode, sizeof(nextState.driveMode), driveMode);
-        copyStringField(nextState.cargoStatus, sizeof(nextState.cargoStatus), cargoStatus);
-        copyStringField(nextState.currentPosition, sizeof(nextState.currentPosition), currentPosition);
-        copyStringField(nextState.lastNode, sizeof(nextState.lastNode), lastNode);
-        copyStringField(nextState.targetNode, sizeof(nextState.targetNode), targetNode);
-        nextState.hasGyroscope = hasGyroscope;
-        nextState.gyroXDps = gyroXDps;
-        nextState.gyroYDps = gyroYDps;
-        nextState.gyroZDps = gyroZDps;
-        nextState.hasRfid = hasRfid;
-        copyStringField(nextState.lastReadUuid, sizeof(nextState.lastReadUuid), lastReadUuid);
-        nextState.hasLux = hasLux;
-        nextState.lux = lux;
-        nextState.hasInfrared = hasInfrared;
-        nextState.infraredFront = infraredFront;
-        nextState.infraredLeft = infraredLeft;
-        nextState.infraredRight = infraredRight;
-        nextState.hasPower = hasPower;
-        nextState.voltageV = voltageV;
-        nextState.currentA = currentA;
-        nextState.powerW = powerW;
-
-        portENTER_CRITICAL(&g_stateMux);
-        g_statePayload = nextState;
+        portENTER_CRITICAL(&g_pendingMux);
+        g_statePayload = state;
         ++g_stateSequence;
         g_statePending = true;
-        portEXIT_CRITICAL(&g_stateMux);
+        portEXIT_CRITICAL(&g_pendingMux);
 
         return true;
     }
 
     bool postEvent(const String &eventName)
     {
-        return postEventBlocking(eventName);
+        JsonDocument doc;
+        char out[AppConfig::BACKEND_JSON_OUT_BYTES];
+        return postEventBlocking(doc, out, sizeof(out), eventName.c_str()) == Outcome::Ok;
     }
 
     bool queueEvent(const String &eventName)
     {
         begin();
-        if (!g_requestQueue)
+        if (!g_eventQueue)
             return false;
 
-        BackendRequest request{};
-        request.type = RequestType::Event;
-        copyStringField(request.eventName, sizeof(request.eventName), eventName);
-        return xQueueSendToBack(g_requestQueue, &request, 0) == pdTRUE;
+        EventRequest request{};
+        StateSchema::copyText(request.name, sizeof(request.name), eventName.c_str());
+        return xQueueSendToBack(g_eventQueue, &request, 0) == pdTRUE;
+    }
+
+    Circuit circuit()
+    {
+        return g_circuit.load(std::memory_order_relaxed);
+    }
+
+    const char *circuitName(Circuit c)
+    {
+        switch (c)
+        {
+        case Circuit::Open:
+            return "open";
+        case Circuit::HalfOpen:
+            return "half-open";
+        default:
+            return "closed";
+        }
+    }
+
+    JsonPool::Stats jsonPoolStats()
+    {
+        return g_workerJsonPool.stats();
     }
 }
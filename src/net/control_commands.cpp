@@ -0,0 +1,583 @@
+#include "net/control_commands.h"
+
+#include "net/metrics.h"
+#include <cstring>
+
+namespace ControlCommands
+{
+    namespace
+    {
+        // Wrap-safe "a is not newer than b".
+        bool notNewer(uint32_t a, uint32_t b)
+        {
+            return static_cast<int32_t>(a - b) <= 0;
+        }
+
+        constexpr uint8_t BINARY_FLAG_SEQ = 0x01;
+        constexpr uint8_t BINARY_FLAG_TS = 0x02;
+
+        Metrics::Counter g_jsonDrives("robot_drive_frames_total", "Drive commands decoded by wire encoding", "encoding=\"json\"");
+        Metrics::Counter g_binaryDrives("robot_drive_frames_total", "Drive commands decoded by wire encoding", "encoding=\"binary\"");
+
+        uint16_t readU16(const uint8_t *p)
+        {
+            return static_cast<uint16_t>(p[0] | (p[1] << 8));
+        }
+
+        uint32_t readU32(const uint8_t *p)
+        {
+            return static_cast<uint32_t>(p[0]) |
+                   (static_cast<uint32_t>(p[1]) << 8) |
+                   (static_cast<uint32_t>(p[2]) << 16) |
+                   (static_cast<uint32_t>(p[3]) << 24);
+        }
+
+        float readAxis(const uint8_t *p)
+        {
+            const int16_t raw = static_cast<int16_t>(readU16(p));
+            const float v = static_cast<float>(raw) / 32767.0f;
+            return (v < -1.0f) ? -1.0f : v;
+        }
+
+        StateSchema::FieldMask fieldMaskFromNames(JsonArrayConst names)
+        {
+            StateSchema::FieldMask mask = 0;
+            for (JsonVariantConst name : names)
+            {
+                const char *text = name | "";
+                for (size_t i = 0; i < StateSchema::FIELD_COUNT; ++i)
+                {
+                    const StateSchema::Field field = static_cast<StateSchema::Field>(i);
+                    if (strcmp(StateSchema::info(field).name, text) == 0)
+                    {
+                        mask |= StateSchema::bit(field);
+                        break;
+                    }
+                }
+            }
+            return mask;
+        }
+
+        struct DecodeContext
+        {
+            uint32_t rxUs;
+            Source source;
+            uint8_t clientId;
+        };
+
+        using Decoder = void (*)(JsonVariantConst msg, const DecodeContext &ctx, Command &out);
+
+        void decodeNavigate(JsonVariantConst msg, const DecodeContext &, Command &out)
+        {
+            out.type = CommandType::Navigate;
+            StateSchema::copyText(out.navigate.start, sizeof(out.navigate.start), msg["start"] | "");
+            StateSchema::copyText(out.navigate.destination, sizeof(out.navigate.destination), msg["destination"] | "");
+        }
+
+        void decodeDrive(JsonVariantConst msg, const DecodeContext &ctx, Command &out)
+        {
+            out.type = CommandType::Drive;
+            out.drive.linearVelocity = msg["linear_velocity"] | 0.0f;
+            out.drive.angularVelocity = msg["angular_velocity"] | 0.0f;
+            out.drive.hasSeq = msg["seq"].is<uint32_t>();
+            out.drive.seq = msg["seq"] | 0U;
+            out.drive.hasTs = msg["ts"].is<uint32_t>();
+            out.drive.senderTs = msg["ts"] | 0U;
+            out.drive.rxUs = ctx.rxUs;
+            out.drive.source = ctx.source;
+            out.drive.clientId = ctx.clientId;
+            g_jsonDrives.inc();
+        }
+
+        void decodeLed(JsonVariantConst msg, const DecodeContext &, Command &out)
+        {
+            out.type = CommandType::Led;
+            out.led.enabled = msg["enabled"] | false;
+            out.led.r = static_cast<uint8_t>(msg["r"] | 0);
+            out.led.g = static_cast<uint8_t>(msg["g"] | 0);
+            out.led.b = static_cast<uint8_t>(msg["b"] | 0);
+            out.led.brightness = static_cast<uint8_t>(msg["brightness"] | 0);
+        }
+
+        void decodeLedPattern(JsonVariantConst msg, const DecodeContext &, Command &out)
+        {
+            out.type = CommandType::LedPattern;
+            readLedPattern(msg, out.ledPattern);
+        }
+
+        void decodeAudioBeep(JsonVariantConst msg, const DecodeContext &, Command &out)
+        {
+            out.type = CommandType::AudioBeep;
+            out.beep.hz = msg["hz"] | 0;
+            out.beep.ms = msg["ms"] | 0;
+            out.beep.queue = strcmp(msg["mode"] | "", "queue") == 0;
+        }
+
+        void decodeAudioVolume(JsonVariantConst msg, const DecodeContext &, Command &out)
+        {
+            out.type = CommandType::AudioVolume;
+            out.volume.value = msg["value"] | 0.0f;
+        }
+
+        void decodeStop(JsonVariantConst, const DecodeContext &, Command &out)
+        {
+            out.type = CommandType::Stop;
+        }
+
+        void decodeSetMode(JsonVariantConst msg, const DecodeContext &, Command &out)
+        {
+            out.type = CommandType::SetMode;
+            StateSchema::copyText(out.setMode.mode, sizeof(out.setMode.mode), msg["mode"] | "");
+        }
+
+        void decodeSubscribe(JsonVariantConst msg, const DecodeContext &, Command &out)
+        {
+            out.type = CommandType::Subscribe;
+            if (msg["fields"].is<JsonArrayConst>())
+                out.subscribe.mask = fieldMaskFromNames(msg["fields"].as<JsonArrayConst>());
+            else
+                out.subscribe.mask = StateSchema::ALL_FIELDS;
+            out.subscribe.periodMs = msg["periodMs"] | 0U;
+        }
+
+        void decodeUnsubscribe(JsonVariantConst, const DecodeContext &, Command &out)
+        {
+            out.type = CommandType::Subscribe;
+            out.subscribe.mask = 0;
+        }
+
+        void decodeTelemetry(JsonVariantConst msg, const DecodeContext &, Command &out)
+        {
+            out.type = CommandType::Telemetry;
+            for (JsonPairConst kv : msg["channels"].as<JsonObjectConst>())
+            {
+                TelemetryStream::Channel channel;
+                if (TelemetryStream::channelFromName(kv.key().c_str(), channel))
+                    out.telemetry.rateHz[static_cast<size_t>(channel)] = kv.value() | 0;
+            }
+            out.telemetry.batchMs = msg["batchMs"] | 0;
+        }
+
+        // `filter` lists exactly the members the decoder reads; everything
+        // else in the frame is skipped without being stored.
+        struct Entry
+        {
+            const char *name;
+            const char *filter;
+            Decoder decode;
+        };
+
+        constexpr Entry ENTRIES[] = {
+            {"NAVIGATE", "{\"start\":true,\"destination\":true}", decodeNavigate},
+            {"DRIVE_COMMAND", "{\"linear_velocity\":true,\"angular_velocity\":true,\"seq\":true,\"ts\":true}", decodeDrive},
+            {"LED", "{\"enabled\":true,\"r\":true,\"g\":true,\"b\":true,\"brightness\":true}", decodeLed},
+            {"LED_PATTERN", "{\"pattern\":true,\"select\":true,\"r\":true,\"g\":true,\"b\":true,\"width\":true,\"periodMs\":true}", decodeLedPattern},
+            {"AUDIO_BEEP", "{\"hz\":true,\"ms\":true,\"mode\":true}", decodeAudioBeep},
+            {"AUDIO_VOLUME", "{\"value\":true}", decodeAudioVolume},
+            {"STOP", "{}", decodeStop},
+            {"SET_MODE", "{\"mode\":true}", decodeSetMode},
+            {"SUBSCRIBE", "{\"fields\":true,\"periodMs\":true}", decodeSubscribe},
+            {"UNSUBSCRIBE", "{}", decodeUnsubscribe},
+            {"TELEMETRY", "{\"channels\":true,\"batchMs\":true}", decodeTelemetry},
+        };
+        constexpr size_t ENTRY_COUNT = sizeof(ENTRIES) / sizeof(ENTRIES[0]);
+
+        // Perfect hash over ENTRIES: the top SLOT_BITS of a seeded FNV-1a.
+        // The seed was searched so every name gets its own slot; the
+        // static_assert below catches a new command that breaks that.
+        constexpr uint32_t HASH_SEED = 86;
+        constexpr uint8_t SLOT_BITS = 4;
+        constexpr uint8_t SLOT_COUNT = 1u << SLOT_BITS;
+
+        constexpr uint32_t fnv1a(const char *s, uint32_t h)
+        {
+            return *s ? fnv1a(s + 1, (h ^ static_cast<uint8_t>(*s)) * 16777619u) : h;
+        }
+
+        constexpr uint8_t slotOf(const char *name)
+        {
+            return static_cast<uint8_t>(fnv1a(name, HASH_SEED) >> (32 - SLOT_BITS));
+        }
+
+        constexpr int8_t entryForSlot(uint8_t slot, size_t i = 0)
+        {
+            return i == ENTRY_COUNT ? -1 : (slotOf(ENTRIES[i].name) == slot ? static_cast<int8_t>(i) : entryForSlot(slot, i + 1));
+        }
+
+        constexpr size_t slotUsers(uint8_t slot, size_t i = 0)
+        {
+            return i == ENTRY_COUNT ? 0 : (slotOf(ENTRIES[i].name) == slot ? 1 : 0) + slotUsers(slot, i + 1);
+        }
+
+        constexpr bool collisionFree(uint8_t slot = 0)
+        {
+            return slot == SLOT_COUNT || (slotUsers(slot) <= 1 && collisionFree(slot + 1));
+        }
+
+        static_assert(ENTRY_COUNT <= SLOT_COUNT, "more commands than hash slots");
+        static_assert(collisionFree(), "command names collide, pick another HASH_SEED");
+
+        constexpr int8_t SLOTS[SLOT_COUNT] = {
+            entryForSlot(0), entryForSlot(1), entryForSlot(2), entryForSlot(3),
+            entryForSlot(4), entryForSlot(5), entryForSlot(6), entryForSlot(7),
+            entryForSlot(8), entryForSlot(9), entryForSlot(10), entryForSlot(11),
+            entryForSlot(12), entryForSlot(13), entryForSlot(14), entryForSlot(15)};
+        static_assert(SLOT_COUNT == 16, "SLOTS initializer lists 16 slots");
+
+        const Entry *lookup(const char *name)
+        {
+            const int8_t index = SLOTS[slotOf(name)];
+            if (index < 0 || strcmp(ENTRIES[index].name, name) != 0)
+                return nullptr;
+            return &ENTRIES[index];
+        }
+
+        // Parsed once (first decode, from either network task; the static
+        // init is thread-safe) and only read afterwards.
+        struct Filters
+        {
+            JsonDocument command;
+            JsonDocument entries[ENTRY_COUNT];
+
+            Filters()
+            {
+                deserializeJson(command, "{\"command\":true}");
+                for (size_t i = 0; i < ENTRY_COUNT; ++i)
+                    deserializeJson(entries[i], ENTRIES[i].filter);
+            }
+        };
+
+        const Filters &filters()
+        {
+            static const Filters instance;
+            return instance;
+        }
+
+        // Every sender puts "command" first, so the name can usually be read
+        // straight off the frame and the document parsed once, with that
+        // command's filter. Anything unusual (escapes, other key order)
+        // returns false and takes the two-pass path.
+        bool sniffCommand(const char *p, size_t len, char *name, size_t cap)
+        {
+            static const char KEY[] = "\"command\"";
+            const size_t keyLen = sizeof(KEY) - 1;
+
+            size_t i = 0;
+            auto skipSpace = [&]()
+            {
+                while (i < len && (p[i] == ' ' || p[i] == '\t' || p[i] == '\r' || p[i] == '\n'))
+                    ++i;
+            };
+
+            skipSpace();
+            if (i >= len || p[i] != '{')
+                return false;
+            ++i;
+            skipSpace();
+            if (len - i < keyLen || memcmp(p + i, KEY, keyLen) != 0)
+                return false;
+            i += keyLen;
+            skipSpace();
+            if (i >= len || p[i] != ':')
+                return false;
+            ++i;
+            skipSpace();
+            if (i >= len || p[i] != '"')
+                return false;
+            ++i;
+
+            size_t n = 0;
+            while (i < len && p[i] != '"')
+            {
+                if (p[i] == '\\' || n + 1 >= cap)
+                    return false;
+                name[n++] = p[i++];
+            }
+            if (i >= len)
+                return false;
+
+            name[n] = '\0';
+            return true;
+        }
+    }
+
+    bool decode(JsonDocument &doc, const char *payload, size_t len, uint32_t rxUs, Source source, Command &out)
+    {
+        char name[TEXT_CAP];
+        const bool sniffed = sniffCommand(payload, len, name, sizeof(name));
+        if (!sniffed)
+        {
+            const DeserializationError err = deserializeJson(doc, payload, len, DeserializationOption::Filter(filters().command));
+            if (err)
+            {
+                Serial.printf("[cmd] json parse error: %s\n", err.c_str());
+                return false;
+            }
+            StateSchema::copyText(name, sizeof(name), doc["command"] | "");
+        }
+
+        if (name[0] == '\0')
+        {
+            Serial.println("[cmd] missing 'command'");
+            return false;
+        }
+
+        const Entry *entry = lookup(name);
+        if (entry || sniffed)
+        {
+            // Unknown commands are still parsed (command only) so that
+            // malformed frames are rejected the same way as known ones.
+            const JsonDocument &filter = entry ? filters().entries[entry - ENTRIES] : filters().command;
+            const DeserializationError err = deserializeJson(doc, payload, len, DeserializationOption::Filter(filter));
+            if (err)
+            {
+                Serial.printf("[cmd] json parse error: %s\n", err.c_str());
+                return false;
+            }
+        }
+
+        const uint8_t clientId = out.clientId;
+        memset(&out, 0, sizeof(out));
+        out.clientId = clientId;
+
+        if (!entry)
+        {
+            out.type = CommandType::Unknown;
+            StateSchema::copyText(out.unknown.command, sizeof(out.unknown.command), name);
+            return true;
+        }
+
+        entry->decode(doc.as<JsonVariantConst>(), DecodeContext{rxUs, source, clientId}, out);
+        return true;
+    }
+
+    bool decodeBinary(const uint8_t *payload, size_t len, uint32_t rxUs, Source source, Command &out)
+    {
+        if (!payload || len != BINARY_DRIVE_BYTES || payload[0] != BINARY_OP_DRIVE)
+        {
+            Serial.printf("[cmd] bad binary frame: %u bytes, op %u\n",
+                          static_cast<unsigned>(len), static_cast<unsigned>(payload && len ? payload[0] : 0));
+            return false;
+        }
+
+        const uint8_t clientId = out.clientId;
+        const uint8_t flags = payload[1];
+        memset(&out, 0, sizeof(out));
+        out.clientId = clientId;
+
+        out.type = CommandType::Drive;
+        out.drive.linearVelocity = readAxis(payload + 2);
+        out.drive.angularVelocity = readAxis(payload + 4);
+        out.drive.hasSeq = (flags & BINARY_FLAG_SEQ) != 0;
+        out.drive.seq = out.drive.hasSeq ? readU32(payload + 6) : 0;
+        out.drive.hasTs = (flags & BINARY_FLAG_TS) != 0;
+        out.drive.senderTs = out.drive.hasTs ? readU32(payload + 10) : 0;
+        out.drive.rxUs = rxUs;
+        out.drive.source = source;
+        out.drive.clientId = clientId;
+        g_binaryDrives.inc();
+        return true;
+    }
+
+    void dispatch(const Command &cmd, const Handlers &handlers)
+    {
+        switch (cmd.type)
+        {
+        case CommandType::Connected:
+            if (handlers.onConnected)
+                handlers.onConnected();
+            break;
+
+        case CommandType::Disconnected:
+            if (handlers.onDisconnected)
+                handlers.onDisconnected();
+            break;
+
+        case CommandType::Navigate:
+            if (handlers.onNavigate)
+                handlers.onNavigate(cmd.navigate.start, cmd.navigate.destination);
+            break;
+
+        case CommandType::Drive:
+            if (handlers.onDriveCommand)
+                handlers.onDriveCommand(cmd.drive);
+            break;
+
+        case CommandType::Led:
+            if (handlers.onLed)
+                handlers.onLed(cmd.led.enabled, cmd.led.r, cmd.led.g, cmd.led.b, cmd.led.brightness);
+            break;
+
+        case CommandType::LedPattern:
+            if (handlers.onLedPattern)
+                handlers.onLedPattern(cmd.ledPattern);
+            break;
+
+        case CommandType::AudioBeep:
+            if (handlers.onAudioBeep)
+                handlers.onAudioBeep(cmd.beep.hz, cmd.beep.ms, cmd.beep.queue);
+            break;
+
+        case CommandType::AudioVolume:
+            if (handlers.onAudioVolume)
+                handlers.onAudioVolume(cmd.volume.value);
+            break;
+
+        case CommandType::Stop:
+            if (handlers.onStop)
+                handlers.onStop();
+            break;
+
+        case CommandType::SetMode:
+            if (handlers.onSetMode)
+                handlers.onSetMode(cmd.setMode.mode);
+            break;
+
+        case CommandType::Subscribe:
+        case CommandType::Telemetry:
+            // Only channels with a push path handle these before dispatch.
+            if (handlers.onUnknownCommand)
+                handlers.onUnknownCommand(cmd.type == CommandType::Subscribe ? "SUBSCRIBE" : "TELEMETRY");
+            break;
+
+        case CommandType::Unknown:
+            if (handlers.onUnknownCommand)
+                handlers.onUnknownCommand(cmd.unknown.command);
+            break;
+        }
+    }
+
+    void readLedPattern(JsonVariantConst msg, LedPatternCommand &out)
+    {
+        StateSchema::copyText(out.pattern, sizeof(out.pattern), msg["pattern"] | "");
+        out.select = msg["select"] | true;
+        out.hasColor = msg["r"].is<uint8_t>() || msg["g"].is<uint8_t>() || msg["b"].is<uint8_t>();
+        out.r = static_cast<uint8_t>(msg["r"] | 0);
+        out.g = static_cast<uint8_t>(msg["g"] | 0);
+        out.b = static_cast<uint8_t>(msg["b"] | 0);
+        out.hasWidth = msg["width"].is<uint8_t>();
+        out.width = static_cast<uint8_t>(msg["width"] | 0);
+        out.hasPeriod = msg["periodMs"].is<uint16_t>();
+        out.periodMs = static_cast<uint16_t>(msg["periodMs"] | 0);
+    }
+
+    void writeDriveAck(const DriveAck &ack, JsonObject out)
+    {
+        out["type"] = "DRIVE_ACK";
+        if (ack.command.hasSeq)
+            out["seq"] = ack.command.seq;
+        if (ack.command.hasTs)
+            out["ts"] = ack.command.senderTs;
+        out["rxUs"] = ack.command.rxUs;
+        out["dispatchUs"] = ack.dispatchUs;
+        out["applied"] = ack.applied;
+        if (ack.applied)
+            out["applyUs"] = ack.applyUs;
+        out["sentUs"] = static_cast<uint32_t>(micros());
+    }
+
+    Coalescer::Coalescer()
+        : pending{},
+          hasPending(false),
+          hasLastSeq(false),
+          hasLastTs(false),
+          lastSeq(0),
+          lastTs(0),
+          driveStats{}
+    {
+    }
+
+    bool Coalescer::isStale(const DriveCommand &drive) const
+    {
+        // A frame reordered behind a newer one in the same tick must not
+        // replace it.
+        const DriveCommand &held = pending.drive;
+        if (drive.hasSeq)
+            return (hasLastSeq && notNewer(drive.seq, lastSeq)) ||
+                   (hasPending && held.hasSeq && notNewer(drive.seq, held.seq));
+        if (drive.hasTs)
+            return (hasLastTs && notNewer(drive.senderTs, lastTs)) ||
+                   (hasPending && held.hasTs && notNewer(drive.senderTs, held.senderTs));
+        return false;
+    }
+
+    void Coalescer::apply(const Handlers &handlers)
+    {
+        hasPending = false;
+
+        if (pending.drive.hasSeq)
+        {
+            lastSeq = pending.drive.seq;
+            hasLastSeq = true;
+        }
+        if (pending.drive.hasTs)
+        {
+            lastTs = pending.drive.senderTs;
+            hasLastTs = true;
+        }
+
+        ++driveStats.applied;
+        dispatch(pending, handlers);
+    }
+
+    void Coalescer::accept(const Command &cmd, const Handlers &handlers)
+    {
+        if (cmd.type == CommandType::Drive)
+        {
+            ++driveStats.received;
+            if (isStale(cmd.drive))
+            {
+                ++driveStats.stale;
+                return;
+            }
+            if (hasPending)
+                ++driveStats.coalesced;
+
+            pending = cmd;
+            hasPending = true;
+            return;
+        }
+
+        // Anything else keeps its place relative to the drive stream, except
+        // that STOP and a lost link make a held setpoint obsolete.
+        if (hasPending)
+        {
+            if (cmd.type == CommandType::Stop || cmd.type == CommandType::Disconnected)
+            {
+                ++driveStats.coalesced;
+                hasPending = false;
+            }
+            else
+            {
+                apply(handlers);
+            }
+        }
+
+        // A new session may restart its sequence numbers.
+        if (cmd.type == CommandType::Connected || cmd.type == CommandType::Disconnected)
+        {
+            hasLastSeq = false;
+            hasLastTs = false;
+        }
+
+        dispatch(cmd, handlers);
+    }
+
+    void Coalescer::flush(const Handlers &handlers)
+    {
+        if (hasPending)
+            apply(handlers);
+    }
+
+    void Coalescer::reset()
+    {
+        hasPending = false;
+        hasLastSeq = false;
+        hasLastTs = false;
+    }
+
+    DriveStats Coalescer::stats() const
+    {
+        return driveStats;
+    }
+}
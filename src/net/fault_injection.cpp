@@ -0,0 +1,250 @@
+#include "net/fault_injection.h"
+
+#include "app_config.h"
+#include "net/metrics.h"
+#include <atomic>
+
+namespace
+{
+    using FaultInjection::Profile;
+
+    // What a lost segment costs TCP: roughly one minimum retransmit timeout.
+    constexpr uint32_t RETRANSMIT_MS = 250;
+
+    struct Phase
+    {
+        uint32_t durationMs;
+        Profile profile;
+    };
+
+    constexpr Phase SCHEDULE[] = {
+        {20000, {"clean", 0, 0, 0, 0, false}},
+        {20000, {"slow", 150, 0, 0, 0, false}},
+        {20000, {"narrow", 20, 2048, 0, 0, false}},
+        {20000, {"lossy", 40, 0, 15, 0, false}},
+        {15000, {"tls-fail", 0, 0, 0, 100, false}},
+        {15000, {"half-open", 0, 0, 0, 0, true}},
+    };
+    constexpr size_t PHASE_COUNT = sizeof(SCHEDULE) / sizeof(SCHEDULE[0]);
+
+    constexpr uint32_t scheduleMs(size_t i = 0)
+    {
+        return i == PHASE_COUNT ? 0 : SCHEDULE[i].durationMs + scheduleMs(i + 1);
+    }
+
+    std::atomic<bool> g_running{false};
+    std::atomic<uint32_t> g_startMs{0};
+    std::atomic<uint8_t> g_loggedPhase{UINT8_MAX};
+
+    Metrics::Counter g_delays("robot_net_faults_injected_total", "Network faults injected by kind", "kind=\"delay\"");
+    Metrics::Counter g_throttles("robot_net_faults_injected_total", "Network faults injected by kind", "kind=\"throttle\"");
+    Metrics::Counter g_drops("robot_net_faults_injected_total", "Network faults injected by kind", "kind=\"drop\"");
+    Metrics::Counter g_tlsFailures("robot_net_faults_injected_total", "Network faults injected by kind", "kind=\"tls\"");
+    Metrics::Counter g_halfOpens("robot_net_faults_injected_total", "Network faults injected by kind", "kind=\"half_open\"");
+
+    bool roll(uint8_t pct)
+    {
+        return pct > 0 && (esp_random() % 100) < pct;
+    }
+
+    uint8_t currentPhase()
+    {
+        uint32_t offsetMs = (millis() - g_startMs.load(std::memory_order_relaxed)) % scheduleMs();
+        uint8_t i = 0;
+        while (offsetMs >= SCHEDULE[i].durationMs)
+            offsetMs -= SCHEDULE[i++].durationMs;
+
+        if (g_loggedPhase.exchange(i, std::memory_order_relaxed) != i)
+            Serial.printf("[faults] phase %s\n", SCHEDULE[i].profile.name);
+        return i;
+    }
+}
+
+namespace FaultInjection
+{
+    void start()
+    {
+        if (!AppConfig::NET_FAULT_INJECTION)
+        {
+            Serial.println("[faults] not compiled in (AppConfig::NET_FAULT_INJECTION)");
+            return;
+        }
+
+        g_startMs.store(millis(), std::memory_order_relaxed);
+        g_loggedPhase.store(UINT8_MAX, std::memory_order_relaxed);
+        g_running.store(true, std::memory_order_release);
+        Serial.printf("[faults] schedule started, %lu ms per cycle\n", static_cast<unsigned long>(scheduleMs()));
+    }
+
+    void stop()
+    {
+        if (g_running.exchange(false))
+            Serial.println("[faults] stopped");
+    }
+
+    bool active()
+    {
+        return AppConfig::NET_FAULT_INJECTION && g_running.load(std::memory_order_acquire);
+    }
+
+    Profile profile()
+    {
+        if (!active())
+            return SCHEDULE[0].profile;
+        return SCHEDULE[currentPhase()].profile;
+    }
+
+    bool rollDrop()
+    {
+        if (!active() || !roll(profile().dropPct))
+            return false;
+        g_drops.inc();
+        return true;
+    }
+
+    bool rollTlsFailure()
+    {
+        if (!active() || !roll(profile().tlsFailPct))
+            return false;
+        g_tlsFailures.inc();
+        return true;
+    }
+
+    FaultyClient::FaultyClient(WiFiClient &inner, bool secure)
+        : inner_(inner), secure_(secure)
+    {
+    }
+
+    bool FaultyClient::beforeConnect()
+    {
+        halfOpen_ = false;
+        owedBytes_ = 0;
+        if (!active())
+            return true;
+
+        const Profile p = profile();
+        if (p.delayMs)
+        {
+            g_delays.inc();
+            delay(p.delayMs);
+        }
+        if (secure_ && rollTlsFailure())
+            return false;
+
+        halfOpen_ = p.halfOpen;
+        if (halfOpen_)
+            g_halfOpens.inc();
+        return true;
+    }
+
+    // Latency and loss are charged per write, i.e. per request segment;
+    // both directions share the bandwidth cap. Bytes are accounted until
+    // they add up to a whole millisecond, since HTTPClient reads headers
+    // one byte at a time.
+    void FaultyClient::shape(size_t bytes, bool outgoing)
+    {
+        if (!active())
+            return;
+
+        const Profile p = profile();
+        if (outgoing && p.delayMs)
+        {
+            g_delays.inc();
+            delay(p.delayMs);
+        }
+        if (outgoing && rollDrop())
+            delay(RETRANSMIT_MS);
+
+        if (p.bytesPerSec == 0)
+            return;
+        owedBytes_ += bytes;
+        const uint32_t waitMs = static_cast<uint32_t>((static_cast<uint64_t>(owedBytes_) * 1000U) / p.bytesPerSec);
+        if (waitMs == 0)
+            return;
+        owedBytes_ -= static_cast<uint32_t>((static_cast<uint64_t>(waitMs) * p.bytesPerSec) / 1000U);
+        g_throttles.inc();
+        delay(waitMs);
+    }
+
+    int FaultyClient::connect(IPAddress ip, uint16_t port)
+    {
+        return beforeConnect() ? inner_.connect(ip, port) : 0;
+    }
+
+    int FaultyClient::connect(const char *host, uint16_t port)
+    {
+        return beforeConnect() ? inner_.connect(host, port) : 0;
+    }
+
+    int FaultyClient::connect(IPAddress ip, uint16_t port, int32_t timeout)
+    {
+        return beforeConnect() ? inner_.connect(ip, port, timeout) : 0;
+    }
+
+    int FaultyClient::connect(const char *host, uint16_t port, int32_t timeout)
+    {
+        return beforeConnect() ? inner_.connect(host, port, timeout) : 0;
+    }
+
+    size_t FaultyClient::write(uint8_t b)
+    {
+        return write(&b, 1);
+    }
+
+    size_t FaultyClient::write(const uint8_t *buf, size_t size)
+    {
+        shape(size, true);
+        // The peer is gone but nothing has told our stack yet.
+        if (halfOpen_)
+            return size;
+        return inner_.write(buf, size);
+    }
+
+    int FaultyClient::available()
+    {
+        return halfOpen_ ? 0 : inner_.available();
+    }
+
+    int FaultyClient::read()
+    {
+        uint8_t b;
+        return read(&b, 1) == 1 ? b : -1;
+    }
+
+    int FaultyClient::read(uint8_t *buf, size_t size)
+    {
+        if (halfOpen_)
+            return -1;
+
+        const int n = inner_.read(buf, size);
+        if (n > 0)
+            shape(static_cast<size_t>(n), false);
+        return n;
+    }
+
+    int FaultyClient::peek()
+    {
+        return halfOpen_ ? -1 : inner_.peek();
+    }
+
+    void FaultyClient::flush()
+    {
+        inner_.flush();
+    }
+
+    void FaultyClient::stop()
+    {
+        halfOpen_ = false;
+        inner_.stop();
+    }
+
+    uint8_t FaultyClient::connected()
+    {
+        return halfOpen_ ? 1 : inner_.connected();
+    }
+
+    FaultyClient::operator bool()
+    {
+        return halfOpen_ || static_cast<bool>(inner_);
+    }
+}
@@ -0,0 +1,112 @@
+#include "net/json_pool.h"
+
+#include <cstdlib>
+#include <cstring>
+
+JsonPool::JsonPool(uint8_t *buffer, size_t capacity)
+    : buffer_(buffer), capacity_(capacity)
+{
+}
+
+size_t JsonPool::alignUp(size_t v)
+{
+    return (v + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1);
+}
+
+bool JsonPool::owns(const void *ptr) const
+{
+    const uint8_t *p = static_cast<const uint8_t *>(ptr);
+    return p >= buffer_ && p < (buffer_ + capacity_);
+}
+
+JsonPool::BlockHeader *JsonPool::headerOf(void *ptr) const
+{
+    return reinterpret_cast<BlockHeader *>(static_cast<uint8_t *>(ptr) - sizeof(BlockHeader));
+}
+
+bool JsonPool::isTopBlock(const BlockHeader *header) const
+{
+    const uint8_t *end = reinterpret_cast<const uint8_t *>(header) + sizeof(BlockHeader) + header->size;
+    return end == (buffer_ + top_);
+}
+
+void *JsonPool::allocate(size_t size)
+{
+    const size_t blockSize = alignUp(size);
+    if (top_ + sizeof(BlockHeader) + blockSize <= capacity_)
+    {
+        auto *header = reinterpret_cast<BlockHeader *>(buffer_ + top_);
+        header->size = static_cast<uint32_t>(blockSize);
+        top_ += sizeof(BlockHeader) + blockSize;
+        if (top_ > highWater_)
+            highWater_ = top_;
+        ++liveBlocks_;
+        return header + 1;
+    }
+
+    ++heapFallbacks_;
+    return malloc(size);
+}
+
+void JsonPool::deallocate(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    if (!owns(ptr))
+    {
+        free(ptr);
+        return;
+    }
+
+    BlockHeader *header = headerOf(ptr);
+    if (isTopBlock(header))
+        top_ = static_cast<size_t>(reinterpret_cast<uint8_t *>(header) - buffer_);
+
+    if (liveBlocks_ > 0)
+        --liveBlocks_;
+    if (liveBlocks_ == 0)
+        top_ = 0;
+}
+
+void *JsonPool::reallocate(void *ptr, size_t newSize)
+{
+    if (!ptr)
+        return allocate(newSize);
+
+    if (!owns(ptr))
+        return realloc(ptr, newSize);
+
+    BlockHeader *header = headerOf(ptr);
+    const size_t blockSize = alignUp(newSize);
+
+    if (isTopBlock(header))
+    {
+        const size_t start = static_cast<size_t>(static_cast<uint8_t *>(ptr) - buffer_);
+        if (start + blockSize <= capacity_)
+        {
+            header->size = static_cast<uint32_t>(blockSize);
+            top_ = start + blockSize;
+            if (top_ > highWater_)
+                highWater_ = top_;
+            return ptr;
+        }
+    }
+    else if (blockSize <= header->size)
+    {
+        return ptr;
+    }
+
+    void *moved = allocate(newSize);
+    if (!moved)
+        return nullptr;
+
+    memcpy(moved, ptr, (header->size < newSize) ? header->size : newSize);
+    deallocate(ptr);
+    return moved;
+}
+
+JsonPool::Stats JsonPool::stats() const
+{
+    return Stats{capacity_, highWater_, heapFallbacks_};
+}
@@ -0,0 +1,262 @@
+#include "net/link_monitor.h"
+
+#include "app_config.h"
+#include "net/backend_config.h"
+#include "net/metrics.h"
+#include <WiFi.h>
+#include <cmath>
+#include <freertos/FreeRTOS.h>
+#include <ping/ping_sock.h>
+
+namespace
+{
+    // Quality needs a few probes before it says anything.
+    constexpr uint8_t MIN_PROBES = 3;
+    constexpr uint8_t DOWN_AFTER_LOST = 3;
+
+    constexpr uint8_t DEGRADED_LOSS_PCT = 10;
+    constexpr uint8_t POOR_LOSS_PCT = 30;
+    constexpr uint32_t DEGRADED_RTT_MS = 150;
+    constexpr uint32_t POOR_RTT_MS = 400;
+    constexpr float DEGRADED_JITTER_MS = 50.0f;
+
+    struct Probe
+    {
+        bool replied;
+        uint32_t rttMs;
+    };
+
+    // Written by the esp_ping task, read by whoever asks for stats().
+    portMUX_TYPE g_mux = portMUX_INITIALIZER_UNLOCKED;
+    Probe g_window[AppConfig::LINK_WINDOW];
+    uint8_t g_count = 0;
+    uint8_t g_next = 0;
+    uint8_t g_consecutiveLost = 0;
+    float g_jitterMs = 0.0f;
+    bool g_hasLastRtt = false;
+    uint32_t g_lastRttMs = 0;
+
+    // Control task only.
+    esp_ping_handle_t g_session = nullptr;
+
+    Metrics::Counter g_replies("robot_link_probes_total", "Link monitor ICMP probes by result", "result=\"reply\"");
+    Metrics::Counter g_timeouts("robot_link_probes_total", "Link monitor ICMP probes by result", "result=\"timeout\"");
+
+    void writeLinkMetrics(Metrics::Writer &w)
+    {
+        const LinkMonitor::Stats s = LinkMonitor::stats();
+        w.family("robot_link_quality", "gauge", "0 unknown, 1 good, 2 degraded, 3 poor, 4 down");
+        w.sample("robot_link_quality", nullptr, static_cast<uint32_t>(s.quality));
+        if (s.probes == s.lost)
+            return;
+
+        w.family("robot_link_rtt_ms", "gauge", "ICMP round trip over the probe window");
+        w.sample("robot_link_rtt_ms", "stat=\"min\"", s.rttMinMs);
+        w.sample("robot_link_rtt_ms", "stat=\"avg\"", s.rttAvgMs);
+        w.sample("robot_link_rtt_ms", "stat=\"max\"", s.rttMaxMs);
+        w.family("robot_link_jitter_ms", "gauge", "Smoothed ICMP round trip variation");
+        w.sample("robot_link_jitter_ms", nullptr, s.jitterMs);
+        w.family("robot_link_loss_percent", "gauge", "Lost probes in the window");
+        w.sample("robot_link_loss_percent", nullptr, static_cast<uint32_t>(s.lossPct));
+    }
+    Metrics::Collector g_linkMetrics(writeLinkMetrics);
+
+    void resetWindow()
+    {
+        portENTER_CRITICAL(&g_mux);
+        g_count = 0;
+        g_next = 0;
+        g_consecutiveLost = 0;
+        g_jitterMs = 0.0f;
+        g_hasLastRtt = false;
+        g_lastRttMs = 0;
+        portEXIT_CRITICAL(&g_mux);
+    }
+
+    void record(bool replied, uint32_t rttMs)
+    {
+        portENTER_CRITICAL(&g_mux);
+        g_window[g_next] = Probe{replied, rttMs};
+        g_next = static_cast<uint8_t>((g_next + 1) % AppConfig::LINK_WINDOW);
+        if (g_count < AppConfig::LINK_WINDOW)
+            ++g_count;
+
+        if (replied)
+        {
+            if (g_hasLastRtt)
+            {
+                const float d = std::fabs(static_cast<float>(rttMs) - static_cast<float>(g_lastRttMs));
+                g_jitterMs += (d - g_jitterMs) / 16.0f;
+            }
+            g_lastRttMs = rttMs;
+            g_hasLastRtt = true;
+            g_consecutiveLost = 0;
+        }
+        else if (g_consecutiveLost < UINT8_MAX)
+        {
+            ++g_consecutiveLost;
+        }
+        portEXIT_CRITICAL(&g_mux);
+    }
+
+    void onProbeReply(esp_ping_handle_t hdl, void *)
+    {
+        uint32_t elapsedMs = 0;
+        esp_ping_get_profile(hdl, ESP_PING_PROF_TIMEGAP, &elapsedMs, sizeof(elapsedMs));
+        record(true, elapsedMs);
+        g_replies.inc();
+    }
+
+    void onProbeTimeout(esp_ping_handle_t, void *)
+    {
+        record(false, 0);
+        g_timeouts.inc();
+    }
+
+    LinkMonitor::Quality classify(const LinkMonitor::Stats &s, uint8_t consecutiveLost)
+    {
+        using LinkMonitor::Quality;
+
+        if (!s.running || s.probes < MIN_PROBES)
+            return Quality::Unknown;
+        if (consecutiveLost >= DOWN_AFTER_LOST)
+            return Quality::Down;
+        if (s.lossPct >= POOR_LOSS_PCT || s.rttAvgMs >= POOR_RTT_MS)
+            return Quality::Poor;
+        if (s.lossPct >= DEGRADED_LOSS_PCT || s.rttAvgMs >= DEGRADED_RTT_MS || s.jitterMs >= DEGRADED_JITTER_MS)
+            return Quality::Degraded;
+        return Quality::Good;
+    }
+
+    bool resolveTarget(ip_addr_t &target)
+    {
+        if (ipaddr_aton(BackendConfig::HOST, &target))
+            return true;
+
+        // No blocking DNS lookup on the control task; the first hop is the
+        // part of the path the robot actually influences anyway.
+        return ipaddr_aton(WiFi.gatewayIP().toString().c_str(), &target);
+    }
+}
+
+namespace LinkMonitor
+{
+    void start()
+    {
+        if (g_session)
+            return;
+
+        esp_ping_config_t config = ESP_PING_DEFAULT_CONFIG();
+        config.count = ESP_PING_COUNT_INFINITE;
+        config.interval_ms = AppConfig::LINK_PING_INTERVAL_MS;
+        config.timeout_ms = AppConfig::LINK_PING_TIMEOUT_MS;
+        config.data_size = 32;
+
+        if (!resolveTarget(config.target_addr))
+        {
+            Serial.println("[link] no probe target");
+            return;
+        }
+
+        const esp_ping_callbacks_t callbacks{
+            .cb_args = nullptr,
+            .on_ping_success = onProbeReply,
+            .on_ping_timeout = onProbeTimeout,
+            .on_ping_end = nullptr};
+
+        resetWindow();
+        if (esp_ping_new_session(&config, &callbacks, &g_session) != ESP_OK)
+        {
+            g_session = nullptr;
+            Serial.println("[link] ping session failed");
+            return;
+        }
+
+        if (esp_ping_start(g_session) != ESP_OK)
+        {
+            esp_ping_delete_session(g_session);
+            g_session = nullptr;
+            Serial.println("[link] ping start failed");
+            return;
+        }
+
+        Serial.printf("[link] probing every %lu ms\n", static_cast<unsigned long>(AppConfig::LINK_PING_INTERVAL_MS));
+    }
+
+    void stop()
+    {
+        if (!g_session)
+            return;
+
+        esp_ping_stop(g_session);
+        esp_ping_delete_session(g_session);
+        g_session = nullptr;
+        resetWindow();
+    }
+
+    Stats stats()
+    {
+        Probe window[AppConfig::LINK_WINDOW];
+        uint8_t count;
+        uint8_t consecutiveLost;
+        Stats s{};
+
+        portENTER_CRITICAL(&g_mux);
+        count = g_count;
+        consecutiveLost = g_consecutiveLost;
+        s.jitterMs = g_jitterMs;
+        s.rttLastMs = g_lastRttMs;
+        for (uint8_t i = 0; i < count; ++i)
+            window[i] = g_window[i];
+        portEXIT_CRITICAL(&g_mux);
+
+        s.running = g_session != nullptr;
+        s.probes = count;
+
+        uint32_t sumMs = 0;
+        uint8_t replies = 0;
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            if (!window[i].replied)
+            {
+                ++s.lost;
+                continue;
+            }
+
+            const uint32_t rtt = window[i].rttMs;
+            if (replies == 0 || rtt < s.rttMinMs)
+                s.rttMinMs = rtt;
+            if (rtt > s.rttMaxMs)
+                s.rttMaxMs = rtt;
+            sumMs += rtt;
+            ++replies;
+        }
+
+        s.rttAvgMs = replies ? sumMs / replies : 0;
+        s.lossPct = count ? static_cast<uint8_t>((s.lost * 100U) / count) : 0;
+        s.quality = classify(s, consecutiveLost);
+        return s;
+    }
+
+    Quality quality()
+    {
+        return stats().quality;
+    }
+
+    const char *qualityName(Quality q)
+    {
+        switch (q)
+        {
+        case Quality::Good:
+            return "good";
+        case Quality::Degraded:
+            return "degraded";
+        case Quality::Poor:
+            return "poor";
+        case Quality::Down:
+            return "down";
+        default:
+            return "unknown";
+        }
+    }
+}
@@ -0,0 +1,321 @@
+#include "net/metrics.h"
+
+#include <cstdarg>
+#include <cstring>
+
+namespace
+{
+    constexpr uint8_t MAX_TRACKED_TASKS = 8;
+
+    Metrics::Metric *g_head = nullptr;
+    Metrics::Metric *g_tail = nullptr;
+
+    std::atomic<uint8_t> g_taskCount{0};
+    TaskHandle_t g_tasks[MAX_TRACKED_TASKS];
+
+    Metrics::Counter g_truncated("robot_metrics_truncated_total", "Metrics cut short because they did not fit a /metrics chunk");
+
+    void writeSystem(Metrics::Writer &w)
+    {
+        w.family("robot_uptime_seconds", "gauge", "Seconds since boot");
+        w.sample("robot_uptime_seconds", nullptr, static_cast<uint32_t>(millis() / 1000));
+
+        w.family("robot_heap_free_bytes", "gauge", "Free heap");
+        w.sample("robot_heap_free_bytes", nullptr, ESP.getFreeHeap());
+        w.family("robot_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+        w.sample("robot_heap_min_free_bytes", nullptr, ESP.getMinFreeHeap());
+        w.family("robot_heap_max_alloc_bytes", "gauge", "Largest allocatable heap block");
+        w.sample("robot_heap_max_alloc_bytes", nullptr, ESP.getMaxAllocHeap());
+
+        const uint8_t tasks = g_taskCount.load(std::memory_order_acquire);
+        if (tasks == 0)
+            return;
+
+        w.family("robot_task_stack_free_bytes", "gauge", "Smallest unused stack seen per task");
+        for (uint8_t i = 0; i < tasks; ++i)
+        {
+            // ESP-IDF reports the high-water mark in bytes.
+            w.printf("robot_task_stack_free_bytes{task=\"%s\"} %u\n",
+                     pcTaskGetName(g_tasks[i]),
+                     static_cast<unsigned>(uxTaskGetStackHighWaterMark(g_tasks[i])));
+        }
+    }
+
+    // Name of the family `m` leaves open, for the HELP/TYPE check of the next metric.
+    const char *familyOf(const Metrics::Metric *m)
+    {
+        return m->type() ? m->name() : nullptr;
+    }
+
+    void writeMetric(Metrics::Writer &w, const Metrics::Metric *m, const char *lastFamily)
+    {
+        if (m->type() && (!lastFamily || strcmp(lastFamily, m->name()) != 0))
+            w.family(m->name(), m->type(), m->help());
+        m->write(w);
+    }
+}
+
+namespace Metrics
+{
+    Writer::Writer(char *out, size_t size)
+        : out_(out),
+          size_(size)
+    {
+        if (size_ > 0)
+            out_[0] = '\0';
+    }
+
+    void Writer::family(const char *name, const char *type, const char *help)
+    {
+        printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    }
+
+    void Writer::sample(const char *name, const char *labels, uint32_t value)
+    {
+        if (labels && labels[0])
+            printf("%s{%s} %lu\n", name, labels, static_cast<unsigned long>(value));
+        else
+            printf("%s %lu\n", name, static_cast<unsigned long>(value));
+    }
+
+    void Writer::sample(const char *name, const char *labels, float value)
+    {
+        if (labels && labels[0])
+            printf("%s{%s} %.4g\n", name, labels, static_cast<double>(value));
+        else
+            printf("%s %.4g\n", name, static_cast<double>(value));
+    }
+
+    void Writer::printf(const char *fmt, ...)
+    {
+        if (overflowed_)
+            return;
+
+        va_list args;
+        va_start(args, fmt);
+        const int n = vsnprintf(out_ + length_, size_ - length_, fmt, args);
+        va_end(args);
+
+        if (n < 0 || static_cast<size_t>(n) >= size_ - length_)
+        {
+            // vsnprintf left a partial line behind.
+            out_[length_] = '\0';
+            overflowed_ = true;
+            return;
+        }
+        length_ += static_cast<size_t>(n);
+    }
+
+    size_t Writer::length() const
+    {
+        return length_;
+    }
+
+    bool Writer::overflowed() const
+    {
+        return overflowed_;
+    }
+
+    void Writer::rewind(size_t length)
+    {
+        if (length < length_)
+            length_ = length;
+        if (size_ > 0)
+            out_[length_] = '\0';
+        overflowed_ = false;
+    }
+
+    Metric::Metric(const char *name, const char *help)
+        : name_(name),
+          help_(help)
+    {
+        // Static construction is single-threaded; append keeps families in
+        // definition order.
+        if (g_tail)
+            g_tail->next_ = this;
+        else
+            g_head = this;
+        g_tail = this;
+    }
+
+    const char *Metric::name() const { return name_; }
+    const char *Metric::help() const { return help_; }
+    const Metric *Metric::next() const { return next_; }
+
+    Counter::Counter(const char *name, const char *help, const char *labels)
+        : Metric(name, help),
+          labels_(labels)
+    {
+    }
+
+    void Counter::write(Writer &w) const
+    {
+        w.sample(name(), labels_, value());
+    }
+
+    Gauge::Gauge(const char *name, const char *help, const char *labels)
+        : Metric(name, help),
+          labels_(labels)
+    {
+    }
+
+    void Gauge::write(Writer &w) const
+    {
+        w.sample(name(), labels_, value());
+    }
+
+    Histogram::Histogram(const char *name, const char *help, const float *bounds, uint8_t boundCount)
+        : Metric(name, help),
+          bounds_(bounds),
+          boundCount_(boundCount > MAX_BOUNDS ? MAX_BOUNDS : boundCount)
+    {
+    }
+
+    void Histogram::observe(float v)
+    {
+        uint8_t bucket = 0;
+        while (bucket < boundCount_ && v > bounds_[bucket])
+            ++bucket;
+
+        ++counts_[bucket];
+        ++count_;
+        sum_ += static_cast<double>(v);
+    }
+
+    void Histogram::write(Writer &w) const
+    {
+        uint32_t cumulative = 0;
+        for (uint8_t i = 0; i < boundCount_; ++i)
+        {
+            cumulative += counts_[i];
+            w.printf("%s_bucket{le=\"%g\"} %lu\n", name(), static_cast<double>(bounds_[i]), static_cast<unsigned long>(cumulative));
+        }
+        cumulative += counts_[boundCount_];
+        w.printf("%s_bucket{le=\"+Inf\"} %lu\n", name(), static_cast<unsigned long>(cumulative));
+        w.printf("%s_sum %.1f\n", name(), sum_);
+        w.printf("%s_count %lu\n", name(), static_cast<unsigned long>(count_));
+    }
+
+    StatusTable::StatusTable(const char *name, const char *help, const char *endpointLabel)
+        : Metric(name, help),
+          endpointLabel_(endpointLabel),
+          slots_{}
+    {
+    }
+
+    void StatusTable::inc(const char *endpoint, int code)
+    {
+        const uint8_t used = used_.load(std::memory_order_relaxed);
+        for (uint8_t i = 0; i < used; ++i)
+        {
+            Slot &slot = slots_[i];
+            if (slot.code == code && strcmp(slot.endpoint, endpoint) == 0)
+            {
+                slot.count.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        if (used == SLOTS)
+        {
+            overflow_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        // Single writer: fill the cell, then publish it to scrapes.
+        Slot &slot = slots_[used];
+        slot.endpoint = endpoint;
+        slot.code = code;
+        slot.count.store(1, std::memory_order_relaxed);
+        used_.store(used + 1, std::memory_order_release);
+    }
+
+    void StatusTable::write(Writer &w) const
+    {
+        const uint8_t used = used_.load(std::memory_order_acquire);
+        for (uint8_t i = 0; i < used; ++i)
+        {
+            const Slot &slot = slots_[i];
+            w.printf("%s{%s=\"%s\",code=\"%d\"} %lu\n",
+                     name(), endpointLabel_, slot.endpoint, slot.code,
+                     static_cast<unsigned long>(slot.count.load(std::memory_order_relaxed)));
+        }
+
+        const uint32_t overflow = overflow_.load(std::memory_order_relaxed);
+        if (overflow)
+            w.printf("%s{code=\"other\"} %lu\n", name(), static_cast<unsigned long>(overflow));
+    }
+
+    Collector::Collector(Fn fn)
+        : Metric(nullptr, nullptr),
+          fn_(fn)
+    {
+    }
+
+    void Collector::write(Writer &w) const
+    {
+        fn_(w);
+    }
+
+    void trackTask(TaskHandle_t task)
+    {
+        if (!task)
+            return;
+
+        const uint8_t count = g_taskCount.load(std::memory_order_relaxed);
+        if (count >= MAX_TRACKED_TASKS)
+            return;
+
+        g_tasks[count] = task;
+        g_taskCount.store(count + 1, std::memory_order_release);
+    }
+
+    size_t writeAll(char *out, size_t outSize, uint16_t &cursor)
+    {
+        Writer w(out, outSize);
+
+        // Cursor 0 is the system block, n the n-th registry metric. Walk past
+        // the ones earlier pieces carried to learn the open family.
+        const Metric *m = g_head;
+        const char *lastFamily = nullptr;
+        for (uint16_t i = 1; m && i < cursor; ++i)
+        {
+            lastFamily = familyOf(m);
+            m = m->next();
+        }
+        if (cursor > 0 && !m)
+            cursor = END;
+
+        while (cursor != END)
+        {
+            const size_t start = w.length();
+            if (cursor == 0)
+                writeSystem(w);
+            else
+                writeMetric(w, m, lastFamily);
+
+            if (w.overflowed())
+            {
+                // Opens the next piece instead.
+                if (start > 0)
+                {
+                    w.rewind(start);
+                    break;
+                }
+
+                // Too large for any piece: keep its complete lines.
+                g_truncated.inc();
+                w.rewind(w.length());
+            }
+
+            if (cursor > 0)
+            {
+                lastFamily = familyOf(m);
+                m = m->next();
+            }
+            cursor = m ? static_cast<uint16_t>(cursor + 1) : END;
+        }
+
+        return w.length();
+    }
+}
@@ -1,17 +1,194 @@
 #include "net/robot_http_server.h"
 
-#include <WebServer.h>
+#include "net/json_pool.h"
+#include "net/metrics.h"
+#include "net/spsc_queue.h"
+#include "app_config.h"
 #include <ArduinoJson.h>
+#include <atomic>
+#include <cstring>
+#include <lwip/sockets.h>
 
 namespace RobotHttpServer
 {
-    static WebServer *g_server = nullptr;
+    static constexpr uint32_t SERVER_TASK_STACK = 4096;
+    static constexpr uint32_t SELECT_TIMEOUT_MS = 5;
+    static constexpr uint8_t MAX_REQUESTS_PER_CONNECTION = 100;
+    static constexpr size_t HEAD_BYTES = 160;
+    static constexpr size_t PATH_BYTES = 32;
+    static constexpr size_t QUERY_BYTES = 48;
+
+    static const char JSON_TYPE[] = "application/json";
+    static const char METRICS_TYPE[] = "text/plain; version=0.0.4";
+    static const char HEALTH_BODY[] = "{\"status\":\"ok\",\"message\":\"Robot is online\"}";
+    static const char TOO_LARGE_BODY[] = "{\"ok\":false,\"error\":\"response too large\"}";
+    static const char STREAM_HEAD[] = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: keep-alive\r\n\r\n";
+    static const char STREAM_PING[] = ": ping\n\n";
+
+    // /metrics goes out one chunk per control task pass: "<hex length>\r\n",
+    // the data and "\r\n", then LAST_CHUNK.
+    static constexpr size_t CHUNK_PREFIX_BYTES = 6; // "ffff\r\n"
+    static const char CHUNK_END[] = "\r\n";
+    static const char LAST_CHUNK[] = "0\r\n\r\n";
+    static_assert(AppConfig::HTTP_METRICS_OUT_BYTES <= 0xFFFF, "chunk length must fit CHUNK_PREFIX_BYTES");
+
+    // Every transition is made by the server task, except Deferred -> Ready:
+    // that one belongs to the control task once it wrote the response.
+    enum class ConnState : uint8_t
+    {
+        Free,
+        Reading,
+        Deferred,
+        Ready,
+        Writing,
+        Parked,   // GET /status?since=N waiting for a newer version
+        Streaming // GET /events; rx is reused as the outgoing event buffer
+    };
+
+    enum class Method : uint8_t
+    {
+        Get,
+        Post,
+        Other
+    };
+
+    enum class Route : uint8_t
+    {
+        Status,
+        Health,
+        Mode,
+        Select,
+        Led,
+        Metrics,
+        Events
+    };
+
+    struct RouteEntry
+    {
+        const char *path;
+        Method method;
+        Route route;
+    };
+
+    static const RouteEntry ROUTES[] = {
+        {"/status", Method::Get, Route::Status},
+        {"/health", Method::Get, Route::Health},
+        {"/metrics", Method::Get, Route::Metrics},
+        {"/events", Method::Get, Route::Events},
+        {"/mode", Method::Post, Route::Mode},
+        {"/select", Method::Post, Route::Select},
+        {"/led", Method::Post, Route::Led},
+    };
+
+    struct Connection
+    {
+        int fd;
+        std::atomic<ConnState> state;
+        bool keepAlive;
+        uint8_t requests;
+        uint32_t lastActivityMs;
+
+        // Request: header at rx[0, headerLen), body at rx[headerLen, headerLen + bodyLen).
+        Method method;
+        Route route;
+        const char *routePath; // ROUTES entry, or "other"; the metrics label
+        char path[PATH_BYTES];
+        char query[QUERY_BYTES];
+        size_t rxLen;
+        size_t headerLen;
+        size_t bodyLen;
+        bool pipelined; // rx holds bytes that arrived behind the last request
+        char rx[AppConfig::HTTP_RX_BYTES];
+
+        // Response: body points at out, the /status cache, g_metricsOut or a literal.
+        int code;
+        const char *contentType;
+        const char *body;
+        size_t bodyLength;
+        bool holdsStatus;
+        bool holdsMetrics;
+        // The body goes out in pieces, each rendered by a separate deferral
+        // until metricsCursor is Metrics::END: as HTTP chunks on keep-alive
+        // connections, delimited by the close otherwise.
+        bool chunked;
+        bool headSent;
+        uint16_t metricsCursor;
+        uint32_t stateVersion; // X-State-Version header, 0 = none
+        char head[HEAD_BYTES];
+        size_t headLen;
+        size_t sent;
+        char out[AppConfig::HTTP_CONN_OUT_BYTES];
+
+        // Long-poll
+        uint32_t since;
+        uint32_t deadlineMs;
+
+        // Event stream: pending bytes are rx[streamSent, streamLen).
+        size_t streamLen;
+        size_t streamSent;
+        bool resync; // an event didn't fit; the next one carries the full state
+    };
+
+    struct StatusUpdate
+    {
+        uint32_t version;
+        StateSchema::Snapshot snapshot;
+    };
+
+    struct EventUpdate
+    {
+        char name[32];
+    };
+
+    static int g_listenFd = -1;
+    static TaskHandle_t g_serverTask = nullptr;
+    static Connection g_connections[AppConfig::HTTP_MAX_CONNECTIONS];
+
+    static Metrics::StatusTable g_responses("robot_http_responses_total", "Robot HTTP API responses by path and status code", "path");
 
-    static StatusProvider g_statusProvider;
     static ModeSetter g_modeSetter;
     static RouteSetter g_routeSetter;
+    static LedPatternSetter g_ledPatternSetter;
+
+    // Server task -> control task: connections waiting in Deferred.
+    static SpscQueue<uint8_t, 8> g_deferred;
+    // Control task -> server task: changed snapshots for /status.
+    static SpscQueue<StatusUpdate, 2> g_statusUpdates;
+    // Control task -> server task: named events for /events.
+    static SpscQueue<EventUpdate, 8> g_events;
+
+    // Control task side of /status publishing.
+    static std::atomic<uint32_t> g_statusVersion{0};
+    static StatusUpdate g_statusUpdate;
+    static StateSchema::Snapshot g_lastPublished;
+    static bool g_hasPublished = false;
 
-    static const char *modeToStr(DriveMode m)
+    // Server task side: the newest snapshot and its serialized body. The body
+    // is rebuilt lazily on the next GET /status, and never while a response
+    // is still streaming it out.
+    static StatusUpdate g_latestStatus;
+    static StatusUpdate g_incomingStatus;
+    static bool g_hasLatestStatus = false;
+    static uint32_t g_statusBodyVersion = 0;
+    static int g_statusBodyCode = 503;
+    static size_t g_statusBodyLen = 0;
+    static uint8_t g_statusReaders = 0;
+    static char g_statusBody[AppConfig::HTTP_JSON_OUT_BYTES];
+
+    // One SSE frame is formatted here once and copied to every stream.
+    static char g_eventFrame[AppConfig::HTTP_JSON_OUT_BYTES];
+    static uint32_t g_lastPingMs = 0;
+
+    // One pool per task, so serving a request never touches the heap for JSON.
+    static StaticJsonPool<AppConfig::HTTP_JSON_POOL_BYTES> g_jsonPool;
+    static StaticJsonPool<AppConfig::HTTP_CONTROL_JSON_POOL_BYTES> g_controlJsonPool;
+
+    // Written by the control task while free, released by the server task
+    // once the response that points at it is gone.
+    static char g_metricsOut[AppConfig::HTTP_METRICS_OUT_BYTES];
+    static std::atomic<bool> g_metricsBusy{false};
+
+    const char *driveModeName(DriveMode m)
     {
         switch (m)
         {
@@ -46,109 +223,809 @@ namespace RobotHttpServer
         return false;
     }
 
-    static void sendJson(int code, JsonDocument &doc)
+    static const char *reasonPhrase(int code)
+    {
+        switch (code)
+        {
+        case 200:
+            return "OK";
+        case 400:
+            return "Bad Request";
+        case 404:
+            return "Not Found";
+        case 405:
+            return "Method Not Allowed";
+        case 413:
+            return "Payload Too Large";
+        case 431:
+            return "Request Header Fields Too Large";
+        case 500:
+            return "Internal Server Error";
+        case 503:
+            return "Service Unavailable";
+        default:
+            return "Unknown";
+        }
+    }
+
+    // ---------------------------------------------------------------------
+    // Responses (filled by either task, sent by the server task)
+    // ---------------------------------------------------------------------
+
+    static void setBody(Connection &c, int code, const char *contentType, const char *body, size_t len)
     {
-        if (!g_server)
+        c.code = code;
+        c.contentType = contentType;
+        c.body = body;
+        c.bodyLength = len;
+    }
+
+    static void setJson(Connection &c, int code, JsonDocument &doc)
+    {
+        const size_t len = serializeJson(doc, c.out, sizeof(c.out));
+        if (doc.overflowed() || len == 0 || len >= sizeof(c.out) - 1)
+        {
+            setBody(c, 500, JSON_TYPE, TOO_LARGE_BODY, sizeof(TOO_LARGE_BODY) - 1);
             return;
+        }
+
+        setBody(c, code, JSON_TYPE, c.out, len);
+    }
+
+    static void setError(Connection &c, int code, const char *error)
+    {
+        // Only ever called with literals, which need no JSON escaping.
+        const int len = snprintf(c.out, sizeof(c.out), "{\"ok\":false,\"error\":\"%s\"}", error);
+        setBody(c, code, JSON_TYPE, c.out, static_cast<size_t>(len));
+    }
+
+    // ---------------------------------------------------------------------
+    // Server task
+    // ---------------------------------------------------------------------
+
+    static void releaseBody(Connection &c)
+    {
+        if (c.holdsStatus)
+        {
+            --g_statusReaders;
+            c.holdsStatus = false;
+        }
+        if (c.holdsMetrics)
+        {
+            g_metricsBusy.store(false, std::memory_order_release);
+            c.holdsMetrics = false;
+            c.chunked = false;
+            c.headSent = false;
+        }
+    }
+
+    static void closeConnection(Connection &c)
+    {
+        releaseBody(c);
+        close(c.fd);
+        c.fd = -1;
+        c.state.store(ConnState::Free, std::memory_order_relaxed);
+    }
 
-        String body;
-        serializeJson(doc, body);
-        g_server->send(code, "application/json", body);
+    static bool isExpired(const Connection &c, ConnState state, uint32_t nowMs)
+    {
+        const uint32_t idleMs = nowMs - c.lastActivityMs;
+        if (state == ConnState::Reading && c.rxLen == 0)
+            return idleMs >= AppConfig::HTTP_KEEPALIVE_TIMEOUT_MS;
+        if (state == ConnState::Reading || state == ConnState::Writing)
+            return idleMs >= AppConfig::HTTP_REQUEST_TIMEOUT_MS;
+        if (state == ConnState::Streaming)
+            return c.streamSent < c.streamLen && idleMs >= AppConfig::HTTP_KEEPALIVE_TIMEOUT_MS;
+        return false;
     }
 
-    static void handleStatus()
+    static void finishResponse(Connection &c)
     {
-        if (!g_server)
+        releaseBody(c);
+
+        if (!c.keepAlive)
+        {
+            closeConnection(c);
             return;
+        }
+
+        // Keep whatever the client pipelined behind this request for
+        // serveBuffered(); serving it from here would recurse once per
+        // request that completes at once.
+        const size_t used = c.headerLen + c.bodyLen;
+        c.rxLen -= used;
+        memmove(c.rx, c.rx + used, c.rxLen);
+        c.headerLen = 0;
+        c.bodyLen = 0;
+        c.pipelined = c.rxLen > 0;
+        c.state.store(ConnState::Reading, std::memory_order_relaxed);
+    }
+
+    static void defer(Connection &c, Route route);
 
-        if (!g_statusProvider)
+    static void writeClient(Connection &c)
+    {
+        const size_t total = c.headLen + c.bodyLength;
+        while (c.sent < total)
         {
-            JsonDocument doc;
-            doc["ok"] = false;
-            doc["error"] = "status provider not set";
-            sendJson(500, doc);
+            const bool inHead = c.sent < c.headLen;
+            const char *data = inHead ? c.head + c.sent : c.body + (c.sent - c.headLen);
+            const size_t len = inHead ? c.headLen - c.sent : total - c.sent;
+
+            const int n = send(c.fd, data, len, MSG_DONTWAIT);
+            if (n < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    closeConnection(c);
+                return;
+            }
+
+            c.sent += static_cast<size_t>(n);
+            c.lastActivityMs = millis();
+        }
+
+        // The control task renders the next piece.
+        if (c.chunked && c.metricsCursor != Metrics::END)
+        {
+            defer(c, Route::Metrics);
+            return;
+        }
+
+        finishResponse(c);
+    }
+
+    static void startResponse(Connection &c)
+    {
+        if (c.headSent)
+        {
+            // Later pieces of a chunked body.
+            c.headLen = 0;
+        }
+        else
+        {
+            int len = snprintf(c.head, sizeof(c.head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n",
+                               c.code,
+                               reasonPhrase(c.code),
+                               c.contentType);
+            if (!c.chunked)
+                len += snprintf(c.head + len, sizeof(c.head) - len, "Content-Length: %u\r\n", static_cast<unsigned>(c.bodyLength));
+            else if (c.keepAlive)
+                len += snprintf(c.head + len, sizeof(c.head) - len, "Transfer-Encoding: chunked\r\n");
+            len += snprintf(c.head + len, sizeof(c.head) - len, "Connection: %s\r\n", c.keepAlive ? "keep-alive" : "close");
+            if (c.stateVersion)
+                len += snprintf(c.head + len, sizeof(c.head) - len, "X-State-Version: %lu\r\n", static_cast<unsigned long>(c.stateVersion));
+            len += snprintf(c.head + len, sizeof(c.head) - len, "\r\n");
+            c.headLen = static_cast<size_t>(len);
+            c.headSent = c.chunked;
+            c.stateVersion = 0;
+            g_responses.inc(c.routePath, c.code);
+        }
+        c.sent = 0;
+        c.lastActivityMs = millis();
+        c.state.store(ConnState::Writing, std::memory_order_relaxed);
+
+        // Most responses fit the socket buffer; no need to wait for select().
+        writeClient(c);
+    }
+
+    static void rejectRequest(Connection &c, int code, const char *error)
+    {
+        // The rest of the stream can't be framed any more.
+        c.keepAlive = false;
+        setError(c, code, error);
+        startResponse(c);
+    }
+
+    static void refreshStatusBody()
+    {
+        if (!g_hasLatestStatus || g_latestStatus.version == g_statusBodyVersion || g_statusReaders > 0)
+            return;
+
+        JsonDocument doc(&g_jsonPool);
+        StateSchema::writeJson(g_latestStatus.snapshot, doc.to<JsonObject>(), StateSchema::Target::Status);
+
+        const size_t len = serializeJson(doc, g_statusBody, sizeof(g_statusBody));
+        if (doc.overflowed() || len == 0 || len >= sizeof(g_statusBody) - 1)
+        {
+            memcpy(g_statusBody, TOO_LARGE_BODY, sizeof(TOO_LARGE_BODY) - 1);
+            g_statusBodyLen = sizeof(TOO_LARGE_BODY) - 1;
+            g_statusBodyCode = 500;
+        }
+        else
+        {
+            g_statusBodyLen = len;
+            g_statusBodyCode = 200;
+        }
+        g_statusBodyVersion = g_latestStatus.version;
+    }
+
+    static void serveStatus(Connection &c)
+    {
+        refreshStatusBody();
+        if (g_statusBodyLen == 0)
+        {
+            setError(c, 503, "status not ready");
+            startResponse(c);
+            return;
+        }
+
+        ++g_statusReaders;
+        c.holdsStatus = true;
+        c.stateVersion = g_statusBodyVersion;
+        setBody(c, g_statusBodyCode, JSON_TYPE, g_statusBody, g_statusBodyLen);
+        startResponse(c);
+    }
+
+    static bool queryValue(const char *query, const char *key, uint32_t &out)
+    {
+        const size_t keyLen = strlen(key);
+        for (const char *p = query; p && *p; p = strchr(p, '&'))
+        {
+            if (*p == '&')
+                ++p;
+            if (strncmp(p, key, keyLen) == 0 && p[keyLen] == '=')
+            {
+                out = strtoul(p + keyLen + 1, nullptr, 10);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // GET /status answers at once; GET /status?since=N[&timeoutMs=T] holds the
+    // request until the version differs from N (a reboot restarts the count,
+    // so "differs" rather than "greater") or the timeout passes.
+    static void handleStatusRequest(Connection &c)
+    {
+        uint32_t since = 0;
+        if (!queryValue(c.query, "since", since))
+        {
+            serveStatus(c);
+            return;
+        }
+
+        refreshStatusBody();
+        if (g_statusBodyLen > 0 && g_statusBodyVersion != since)
+        {
+            serveStatus(c);
+            return;
+        }
+
+        uint32_t timeoutMs = AppConfig::HTTP_LONG_POLL_DEFAULT_MS;
+        queryValue(c.query, "timeoutMs", timeoutMs);
+        if (timeoutMs > AppConfig::HTTP_LONG_POLL_MAX_MS)
+            timeoutMs = AppConfig::HTTP_LONG_POLL_MAX_MS;
+
+        c.since = since;
+        c.deadlineMs = millis() + timeoutMs;
+        c.state.store(ConnState::Parked, std::memory_order_relaxed);
+    }
+
+    static void wakeParked(Connection &c, uint32_t nowMs)
+    {
+        refreshStatusBody();
+        const bool changed = g_statusBodyLen > 0 && g_statusBodyVersion != c.since;
+        if (changed || static_cast<int32_t>(nowMs - c.deadlineMs) >= 0)
+            serveStatus(c);
+    }
+
+    // ---------------------------------------------------------------------
+    // Event stream
+    // ---------------------------------------------------------------------
+
+    static void writeStream(Connection &c)
+    {
+        while (c.streamSent < c.streamLen)
+        {
+            const int n = send(c.fd, c.rx + c.streamSent, c.streamLen - c.streamSent, MSG_DONTWAIT);
+            if (n < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    closeConnection(c);
+                return;
+            }
+
+            c.streamSent += static_cast<size_t>(n);
+            c.lastActivityMs = millis();
+        }
+
+        c.streamLen = 0;
+        c.streamSent = 0;
+    }
+
+    static bool appendStream(Connection &c, const char *data, size_t len)
+    {
+        if (c.streamLen + len > sizeof(c.rx) && c.streamSent > 0)
+        {
+            c.streamLen -= c.streamSent;
+            memmove(c.rx, c.rx + c.streamSent, c.streamLen);
+            c.streamSent = 0;
+        }
+        if (c.streamLen + len > sizeof(c.rx))
+            return false;
+
+        if (c.streamLen == c.streamSent)
+            c.lastActivityMs = millis();
+        memcpy(c.rx + c.streamLen, data, len);
+        c.streamLen += len;
+        return true;
+    }
+
+    // Formats "id: <version>\nevent: state\ndata: {...}\n\n" into g_eventFrame.
+    static size_t formatStateEvent(const StatusUpdate &update, StateSchema::FieldMask mask)
+    {
+        const int prefix = snprintf(g_eventFrame, sizeof(g_eventFrame), "id: %lu\nevent: state\ndata: ",
+                                    static_cast<unsigned long>(update.version));
+
+        JsonDocument doc(&g_jsonPool);
+        StateSchema::writeJson(update.snapshot, doc.to<JsonObject>(), StateSchema::Target::Status, mask);
+
+        const size_t room = sizeof(g_eventFrame) - prefix - 2;
+        const size_t len = serializeJson(doc, g_eventFrame + prefix, room);
+        if (doc.overflowed() || len == 0 || len >= room - 1)
+            return 0;
+
+        memcpy(g_eventFrame + prefix + len, "\n\n", 2);
+        return prefix + len + 2;
+    }
+
+    static size_t formatNamedEvent(const EventUpdate &event)
+    {
+        JsonDocument doc(&g_jsonPool);
+        doc["event"] = event.name;
+        doc["version"] = g_latestStatus.version;
+
+        const int prefix = snprintf(g_eventFrame, sizeof(g_eventFrame), "event: event\ndata: ");
+        const size_t room = sizeof(g_eventFrame) - prefix - 2;
+        const size_t len = serializeJson(doc, g_eventFrame + prefix, room);
+        if (doc.overflowed() || len == 0 || len >= room - 1)
+            return 0;
+
+        memcpy(g_eventFrame + prefix + len, "\n\n", 2);
+        return prefix + len + 2;
+    }
+
+    // A stream that fell behind skips the deltas it can't buffer and gets
+    // the full state once it drained.
+    static void resyncStream(Connection &c)
+    {
+        if (!c.resync || c.streamLen != 0 || !g_hasLatestStatus)
+            return;
+
+        const size_t len = formatStateEvent(g_latestStatus, StateSchema::ALL_FIELDS);
+        if (len > 0 && appendStream(c, g_eventFrame, len))
+        {
+            c.resync = false;
+            writeStream(c);
+        }
+    }
+
+    static void broadcast(size_t len, bool isState)
+    {
+        for (Connection &c : g_connections)
+        {
+            if (c.state.load(std::memory_order_relaxed) != ConnState::Streaming)
+                continue;
+
+            if (c.resync && isState)
+                continue;
+            if (len == 0 || !appendStream(c, g_eventFrame, len))
+            {
+                c.resync = c.resync || isState;
+                continue;
+            }
+            writeStream(c);
+        }
+    }
+
+    static bool hasStreams()
+    {
+        for (const Connection &c : g_connections)
+        {
+            if (c.state.load(std::memory_order_relaxed) == ConnState::Streaming)
+                return true;
+        }
+        return false;
+    }
+
+    static void openStream(Connection &c)
+    {
+        // The request is done with; rx now buffers outgoing events.
+        c.keepAlive = false;
+        c.streamLen = 0;
+        c.streamSent = 0;
+        c.resync = true;
+        appendStream(c, STREAM_HEAD, sizeof(STREAM_HEAD) - 1);
+        c.state.store(ConnState::Streaming, std::memory_order_relaxed);
+        g_responses.inc(c.routePath, 200);
+
+        writeStream(c);
+        resyncStream(c);
+    }
+
+    static void drainUpdates(uint32_t nowMs)
+    {
+        const bool streaming = hasStreams();
+
+        while (g_statusUpdates.pop(g_incomingStatus))
+        {
+            if (streaming && g_hasLatestStatus)
+            {
+                const StateSchema::FieldMask changed = StateSchema::diff(g_incomingStatus.snapshot, g_latestStatus.snapshot);
+                if (changed)
+                    broadcast(formatStateEvent(g_incomingStatus, changed), true);
+            }
+
+            g_latestStatus = g_incomingStatus;
+            g_hasLatestStatus = true;
+        }
+
+        EventUpdate event;
+        while (g_events.pop(event))
+        {
+            if (streaming)
+                broadcast(formatNamedEvent(event), false);
+        }
+
+        if (streaming && (nowMs - g_lastPingMs) >= AppConfig::HTTP_EVENTS_PING_MS)
+        {
+            g_lastPingMs = nowMs;
+            memcpy(g_eventFrame, STREAM_PING, sizeof(STREAM_PING) - 1);
+            broadcast(sizeof(STREAM_PING) - 1, false);
+        }
+    }
+
+    static void defer(Connection &c, Route route)
+    {
+        c.route = route;
+        c.state.store(ConnState::Deferred, std::memory_order_relaxed);
+
+        const uint8_t index = static_cast<uint8_t>(&c - g_connections);
+        if (!g_deferred.push(index))
+        {
+            // Halfway through a chunked body there is no way left to say so.
+            if (c.headSent)
+            {
+                closeConnection(c);
+                return;
+            }
+            setError(c, 503, "busy");
+            startResponse(c);
+        }
+    }
+
+    static void routeRequest(Connection &c)
+    {
+        for (const RouteEntry &r : ROUTES)
+        {
+            if (strcmp(c.path, r.path) != 0)
+                continue;
+
+            c.routePath = r.path;
+            if (c.method != r.method)
+            {
+                setError(c, 405, "method not allowed");
+                startResponse(c);
+                return;
+            }
+
+            switch (r.route)
+            {
+            case Route::Status:
+                handleStatusRequest(c);
+                break;
+            case Route::Events:
+                openStream(c);
+                break;
+            case Route::Health:
+                setBody(c, 200, JSON_TYPE, HEALTH_BODY, sizeof(HEALTH_BODY) - 1);
+                startResponse(c);
+                break;
+            default:
+                defer(c, r.route);
+                break;
+            }
             return;
         }
 
-        const StatusSnapshot s = g_statusProvider();
+        c.routePath = "other";
+        JsonDocument doc(&g_jsonPool);
+        doc["ok"] = false;
+        doc["error"] = "not found";
+        doc["path"] = c.path;
+        setJson(c, 404, doc);
+        startResponse(c);
+    }
 
-        JsonDocument doc;
+    // Parses the request line and the headers we care about, in place.
+    static bool parseHead(Connection &c)
+    {
+        c.rx[c.headerLen - 1] = '\0';
+
+        char *save = nullptr;
+        char *line = strtok_r(c.rx, "\r\n", &save);
+        if (!line)
+            return false;
+
+        char *target = strchr(line, ' ');
+        if (!target)
+            return false;
+        *target++ = '\0';
 
-        doc["systemHealth"] = s.systemHealth ? s.systemHealth : "UNKNOWN";
-        doc["batteryLevel"] = s.batteryLevel;
-        doc["driveMode"] = modeToStr(s.driveMode);
-        doc["cargoStatus"] = s.cargoStatus ? s.cargoStatus : "UNKNOWN";
-        doc["batteryVoltage"] = s.powerValid ? s.batteryVoltage : 0.0f;
-        doc["batteryCurrentA"] = s.powerValid ? s.batteryCurrentA : 0.0f;
-        doc["batteryPowerW"] = s.powerValid ? s.batteryPowerW : 0.0f;
+        char *version = strchr(target, ' ');
+        if (!version)
+            return false;
+        *version++ = '\0';
+        if (strncmp(version, "HTTP/1.", 7) != 0)
+            return false;
 
-        JsonObject lastRoute = doc["lastRoute"].to<JsonObject>();
-        lastRoute["startNode"] = s.lastRouteStart ? s.lastRouteStart : "";
-        lastRoute["endNode"] = s.lastRouteEnd ? s.lastRouteEnd : "";
+        char *query = strchr(target, '?');
+        if (query)
+            *query++ = '\0';
+        StateSchema::copyText(c.query, sizeof(c.query), query ? query : "");
 
-        doc["position"] = s.position ? s.position : "";
-        doc["currentNode"] = s.currentNode ? s.currentNode : "";
-        doc["targetNode"] = s.targetNode ? s.targetNode : "";
-        doc["navigationStatus"] = s.navigationStatus ? s.navigationStatus : "IDLE";
+        c.method = (strcmp(line, "GET") == 0) ? Method::Get : (strcmp(line, "POST") == 0) ? Method::Post
+                                                                                            : Method::Other;
+        StateSchema::copyText(c.path, sizeof(c.path), target);
+        c.keepAlive = c.keepAlive && strcmp(version, "HTTP/1.1") == 0;
+        c.bodyLen = 0;
+
+        while ((line = strtok_r(nullptr, "\r\n", &save)) != nullptr)
+        {
+            char *value = strchr(line, ':');
+            if (!value)
+                continue;
+            *value++ = '\0';
+            while (*value == ' ' || *value == '\t')
+                ++value;
 
-        JsonObject sensors = doc["sensors"].to<JsonObject>();
+            if (strcasecmp(line, "Content-Length") == 0)
+                c.bodyLen = strtoul(value, nullptr, 10);
+            else if (strcasecmp(line, "Connection") == 0 && strcasecmp(value, "close") == 0)
+                c.keepAlive = false;
+            else if (strcasecmp(line, "Transfer-Encoding") == 0)
+                return false; // chunked bodies are not supported
+        }
 
-        JsonObject ir = sensors["ir"].to<JsonObject>();
-        ir["left"] = s.irLeft;
-        ir["middle"] = s.irMid;
-        ir["right"] = s.irRight;
+        return true;
+    }
 
-        JsonObject light = sensors["light"].to<JsonObject>();
-        light["luxValid"] = s.luxValid;
-        light["lux"] = s.luxValid ? s.lux : 0.0f;
+    static size_t findHeaderEnd(const char *data, size_t len)
+    {
+        for (size_t i = 3; i < len; ++i)
+        {
+            if (data[i] == '\n' && data[i - 1] == '\r' && data[i - 2] == '\n' && data[i - 3] == '\r')
+                return i + 1;
+        }
+        return 0;
+    }
 
-        JsonObject power = sensors["power"].to<JsonObject>();
-        power["valid"] = s.powerValid;
-        power["batteryVoltage"] = s.powerValid ? s.batteryVoltage : 0.0f;
-        power["currentA"] = s.powerValid ? s.batteryCurrentA : 0.0f;
-        power["powerW"] = s.powerValid ? s.batteryPowerW : 0.0f;
+    static void processRequest(Connection &c)
+    {
+        if (c.headerLen == 0)
+        {
+            c.routePath = "other";
+            const size_t headerLen = findHeaderEnd(c.rx, c.rxLen);
+            if (headerLen == 0)
+            {
+                if (c.rxLen == sizeof(c.rx))
+                    rejectRequest(c, 431, "headers too large");
+                return;
+            }
 
-        JsonObject gyroscope = sensors["gyroscope"].to<JsonObject>();
-        gyroscope["valid"] = s.gyroValid;
-        gyroscope["xDps"] = s.gyroValid ? s.gyroXDps : 0.0f;
-        gyroscope["yDps"] = s.gyroValid ? s.gyroYDps : 0.0f;
-        gyroscope["zDps"] = s.gyroValid ? s.gyroZDps : 0.0f;
+            c.headerLen = headerLen;
+            if (++c.requests >= MAX_REQUESTS_PER_CONNECTION)
+                c.keepAlive = false;
 
-        JsonObject rfid = sensors["rfid"].to<JsonObject>();
-        rfid["lastReadUuid"] = s.lastReadUuid ? s.lastReadUuid : nullptr;
+            if (!parseHead(c))
+            {
+                rejectRequest(c, 400, "malformed request");
+                return;
+            }
+            if (c.bodyLen > sizeof(c.rx) - c.headerLen)
+            {
+                rejectRequest(c, 413, "body too large");
+                return;
+            }
+        }
 
-        JsonObject led = doc["led"].to<JsonObject>();
-        led["enabled"] = s.ledEnabled;
-        led["autoEnabled"] = s.ledAutoEnabled;
+        if (c.rxLen < c.headerLen + c.bodyLen)
+            return;
 
-        JsonObject audio = doc["audio"].to<JsonObject>();
-        audio["volume"] = s.audioVolume;
+        routeRequest(c);
+    }
 
-        sendJson(200, doc);
+    // Serves buffered requests one after another until one is incomplete or
+    // its response can't go out at once; that response's finishResponse()
+    // flags the rest for the next pass of serverTask.
+    static void serveBuffered(Connection &c)
+    {
+        while (c.state.load(std::memory_order_relaxed) == ConnState::Reading && c.rxLen > 0)
+        {
+            c.pipelined = false;
+            const size_t before = c.rxLen;
+            processRequest(c);
+            if (c.rxLen == before)
+                break;
+        }
     }
 
-    static void handleMode()
+    static void readClient(Connection &c, ConnState state)
     {
-        if (!g_server)
+        // Streams only read to notice the peer going away.
+        char sink[32];
+        const int n = (state == ConnState::Streaming) ? recv(c.fd, sink, sizeof(sink), MSG_DONTWAIT)
+                                                      : recv(c.fd, c.rx + c.rxLen, sizeof(c.rx) - c.rxLen, MSG_DONTWAIT);
+        if (n == 0)
+        {
+            closeConnection(c);
             return;
+        }
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                closeConnection(c);
+            return;
+        }
+
+        if (state == ConnState::Streaming)
+            return;
+
+        // A parked long-poll keeps what was pipelined for after its response.
+        c.rxLen += static_cast<size_t>(n);
+        c.lastActivityMs = millis();
+        if (state == ConnState::Reading)
+            serveBuffered(c);
+    }
+
+    static void acceptClient(Connection &c)
+    {
+        const int fd = accept(g_listenFd, nullptr, nullptr);
+        if (fd < 0)
+            return;
+
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+        c.fd = fd;
+        c.keepAlive = true;
+        c.requests = 0;
+        c.rxLen = 0;
+        c.headerLen = 0;
+        c.bodyLen = 0;
+        c.pipelined = false;
+        c.holdsStatus = false;
+        c.holdsMetrics = false;
+        c.chunked = false;
+        c.headSent = false;
+        c.stateVersion = 0;
+        c.lastActivityMs = millis();
+        c.state.store(ConnState::Reading, std::memory_order_relaxed);
+    }
+
+    static void serverTask(void *)
+    {
+        for (;;)
+        {
+            drainUpdates(millis());
+
+            fd_set readSet;
+            fd_set writeSet;
+            FD_ZERO(&readSet);
+            FD_ZERO(&writeSet);
+            int maxFd = -1;
+            Connection *freeSlot = nullptr;
+
+            for (Connection &c : g_connections)
+            {
+                ConnState state = c.state.load(std::memory_order_acquire);
+                if (state == ConnState::Ready)
+                    startResponse(c);
+                else if (state == ConnState::Parked)
+                    wakeParked(c, millis());
+                else if (state == ConnState::Streaming)
+                    resyncStream(c);
+                if (c.pipelined)
+                    serveBuffered(c);
+                state = c.state.load(std::memory_order_relaxed);
 
-        if (!g_server->hasArg("plain"))
+                if (isExpired(c, state, millis()))
+                {
+                    closeConnection(c);
+                    state = ConnState::Free;
+                }
+
+                if (state == ConnState::Free)
+                {
+                    if (!freeSlot)
+                        freeSlot = &c;
+                    continue;
+                }
+
+                if (state == ConnState::Reading || (state == ConnState::Parked && c.rxLen < sizeof(c.rx)))
+                    FD_SET(c.fd, &readSet);
+                else if (state == ConnState::Writing)
+                    FD_SET(c.fd, &writeSet);
+                else if (state == ConnState::Streaming)
+                {
+                    FD_SET(c.fd, &readSet);
+                    if (c.streamSent < c.streamLen)
+                        FD_SET(c.fd, &writeSet);
+                }
+                else
+                    continue;
+
+                if (c.fd > maxFd)
+                    maxFd = c.fd;
+            }
+
+            // A full table leaves new clients in the listen backlog.
+            if (freeSlot)
+            {
+                FD_SET(g_listenFd, &readSet);
+                if (g_listenFd > maxFd)
+                    maxFd = g_listenFd;
+            }
+
+            // The timeout also bounds how long a deferred response waits to go out.
+            timeval timeout;
+            timeout.tv_sec = 0;
+            timeout.tv_usec = SELECT_TIMEOUT_MS * 1000;
+            const int ready = (maxFd >= 0) ? select(maxFd + 1, &readSet, &writeSet, nullptr, &timeout) : -1;
+            if (ready < 0)
+            {
+                vTaskDelay(pdMS_TO_TICKS(SELECT_TIMEOUT_MS));
+                continue;
+            }
+            if (ready == 0)
+                continue;
+
+            for (Connection &c : g_connections)
+            {
+                const ConnState state = c.state.load(std::memory_order_relaxed);
+                if (state == ConnState::Free || state == ConnState::Deferred || state == ConnState::Ready)
+                    continue;
+
+                if (FD_ISSET(c.fd, &readSet))
+                    readClient(c, state);
+
+                if (c.state.load(std::memory_order_relaxed) != state || !FD_ISSET(c.fd, &writeSet))
+                    continue;
+                if (state == ConnState::Writing)
+                    writeClient(c);
+                else if (state == ConnState::Streaming)
+                    writeStream(c);
+            }
+
+            if (freeSlot && FD_ISSET(g_listenFd, &readSet))
+                acceptClient(*freeSlot);
+        }
+    }
+
+    // ---------------------------------------------------------------------
+    // Control task
+    // ---------------------------------------------------------------------
+
+    static void handleMode(Connection &c)
+    {
+        if (c.bodyLen == 0)
         {
-            JsonDocument doc;
+            JsonDocument doc(&g_controlJsonPool);
             doc["ok"] = false;
             doc["error"] = "missing body";
-            sendJson(400, doc);
+            setJson(c, 400, doc);
             return;
         }
 
-        JsonDocument in;
-        const DeserializationError err = deserializeJson(in, g_server->arg("plain"));
+        JsonDocument in(&g_controlJsonPool);
+        const DeserializationError err = deserializeJson(in, c.rx + c.headerLen, c.bodyLen);
         if (err)
         {
-            JsonDocument doc;
+            JsonDocument doc(&g_controlJsonPool);
             doc["ok"] = false;
             doc["error"] = "invalid json";
-            sendJson(400, doc);
+            setJson(c, 400, doc);
             return;
         }
 
@@ -156,44 +1033,41 @@ namespace RobotHttpServer
         DriveMode mode;
         if (!strToMode(modeStr, mode))
         {
-            JsonDocument doc;
+            JsonDocument doc(&g_controlJsonPool);
             doc["ok"] = false;
             doc["error"] = "invalid mode";
-            sendJson(400, doc);
+            setJson(c, 400, doc);
             return;
         }
 
         if (g_modeSetter)
             g_modeSetter(mode);
 
-        JsonDocument doc;
+        JsonDocument doc(&g_controlJsonPool);
         doc["ok"] = true;
         doc["mode"] = modeStr;
-        sendJson(200, doc);
+        setJson(c, 200, doc);
     }
 
-    static void handleSelect()
+    static void handleSelect(Connection &c)
     {
-        if (!g_server)
-            return;
-
-        if (!g_server->hasArg("plain"))
+        if (c.bodyLen == 0)
         {
-            JsonDocument doc;
+            JsonDocument doc(&g_controlJsonPool);
             doc["ok"] = false;
             doc["error"] = "missing body";
-            sendJson(400, doc);
+            setJson(c, 400, doc);
             return;
         }
 
-        JsonDocument in;
-        const DeserializationError err = deserializeJson(in, g_server->arg("plain"));
+        JsonDocument in(&g_controlJsonPool);
+        const DeserializationError err = deserializeJson(in, c.rx + c.headerLen, c.bodyLen);
         if (err)
         {
-            JsonDocument doc;
+            JsonDocument doc(&g_controlJsonPool);
             doc["ok"] = false;
             doc["error"] = "invalid json";
-            sendJson(400, doc);
+            setJson(c, 400, doc);
             return;
         }
 
@@ -202,74 +1076,221 @@ namespace RobotHttpServer
 
         if (startNode.length() == 0 || endNode.length() == 0)
         {
-            JsonDocument doc;
+            JsonDocument doc(&g_controlJsonPool);
             doc["ok"] = false;
             doc["error"] = "startNode/endNode required";
-            sendJson(400, doc);
+            setJson(c, 400, doc);
             return;
         }
 
         String error;
         if (g_routeSetter && !g_routeSetter(startNode, endNode, error))
         {
-            JsonDocument doc;
+            JsonDocument doc(&g_controlJsonPool);
             doc["ok"] = false;
             doc["error"] = error.length() ? error : String("route rejected");
-            sendJson(400, doc);
+            setJson(c, 400, doc);
             return;
         }
 
-        JsonDocument doc;
+        JsonDocument doc(&g_controlJsonPool);
         doc["ok"] = true;
         doc["startNode"] = startNode;
         doc["endNode"] = endNode;
-        sendJson(200, doc);
+        setJson(c, 200, doc);
     }
 
-    static void handleHealth()
+    static void handleLed(Connection &c)
     {
-        JsonDocument doc;
-        doc["status"] = "ok";
-        doc["message"] = "Robot is online";
-        sendJson(200, doc);
+        if (c.bodyLen == 0)
+        {
+            JsonDocument doc(&g_controlJsonPool);
+            doc["ok"] = false;
+            doc["error"] = "missing body";
+            setJson(c, 400, doc);
+            return;
+        }
+
+        JsonDocument in(&g_controlJsonPool);
+        const DeserializationError err = deserializeJson(in, c.rx + c.headerLen, c.bodyLen);
+        if (err)
+        {
+            JsonDocument doc(&g_controlJsonPool);
+            doc["ok"] = false;
+            doc["error"] = "invalid json";
+            setJson(c, 400, doc);
+            return;
+        }
+
+        ControlCommands::LedPatternCommand cmd{};
+        ControlCommands::readLedPattern(in.as<JsonVariantConst>(), cmd);
+
+        String error;
+        if (!g_ledPatternSetter || !g_ledPatternSetter(cmd, error))
+        {
+            JsonDocument doc(&g_controlJsonPool);
+            doc["ok"] = false;
+            doc["error"] = error.length() ? error : String("pattern rejected");
+            setJson(c, 400, doc);
+            return;
+        }
+
+        JsonDocument doc(&g_controlJsonPool);
+        doc["ok"] = true;
+        doc["pattern"] = cmd.pattern;
+        setJson(c, 200, doc);
     }
 
-    void begin(uint16_t port, StatusProvider statusProvider, ModeSetter modeSetter, RouteSetter routeSetter)
+    static void handleMetrics(Connection &c)
+    {
+        static const char ERROR_BODY[] = "# metrics unavailable\n";
+
+        if (!c.chunked)
+        {
+            // A scrape still sending its pieces keeps the buffer.
+            if (g_metricsBusy.load(std::memory_order_acquire))
+            {
+                setBody(c, 503, METRICS_TYPE, ERROR_BODY, sizeof(ERROR_BODY) - 1);
+                return;
+            }
+
+            g_metricsBusy.store(true, std::memory_order_relaxed);
+            c.holdsMetrics = true;
+            c.chunked = true;
+            c.metricsCursor = 0;
+        }
+
+        // Leave room for the chunk framing on both sides of the data.
+        char *data = g_metricsOut + CHUNK_PREFIX_BYTES;
+        const size_t room = sizeof(g_metricsOut) - CHUNK_PREFIX_BYTES - (sizeof(CHUNK_END) - 1) - (sizeof(LAST_CHUNK) - 1);
+        size_t len = Metrics::writeAll(data, room, c.metricsCursor);
+
+        char *body = data;
+        if (c.keepAlive && len > 0)
+        {
+            char prefix[CHUNK_PREFIX_BYTES + 1];
+            const int prefixLen = snprintf(prefix, sizeof(prefix), "%x\r\n", static_cast<unsigned>(len));
+            body -= prefixLen;
+            memcpy(body, prefix, static_cast<size_t>(prefixLen));
+            memcpy(data + len, CHUNK_END, sizeof(CHUNK_END) - 1);
+            len += sizeof(CHUNK_END) - 1;
+        }
+        if (c.keepAlive && c.metricsCursor == Metrics::END)
+        {
+            memcpy(data + len, LAST_CHUNK, sizeof(LAST_CHUNK) - 1);
+            len += sizeof(LAST_CHUNK) - 1;
+        }
+
+        setBody(c, 200, METRICS_TYPE, body, static_cast<size_t>(data - body) + len);
+    }
+
+    void begin(uint16_t port, ModeSetter modeSetter, RouteSetter routeSetter)
     {
-        g_statusProvider = statusProvider;
         g_modeSetter = modeSetter;
         g_routeSetter = routeSetter;
 
-        if (g_server)
+        if (g_serverTask)
         {
             Serial.println("[robot-http] already started");
             return;
         }
 
-        g_server = new WebServer(port);
+        g_listenFd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (g_listenFd < 0)
+        {
+            Serial.println("[robot-http] socket() failed");
+            return;
+        }
+
+        const int one = 1;
+        setsockopt(g_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
 
-        g_server->on("/status", HTTP_GET, handleStatus);
-        g_server->on("/mode", HTTP_POST, handleMode);
-        g_server->on("/select", HTTP_POST, handleSelect);
-        g_server->on("/health", HTTP_GET, handleHealth);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
 
-        g_server->onNotFound([]()
-                             {
-                                 JsonDocument doc;
-                                 doc["ok"] = false;
-                                 doc["error"] = "not found";
-                                 doc["path"] = g_server ? g_server->uri() : "";
-                                 sendJson(404, doc); });
+        if (bind(g_listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            listen(g_listenFd, AppConfig::HTTP_MAX_CONNECTIONS) != 0)
+        {
+            Serial.printf("[robot-http] bind/listen on port %u failed errno=%d\n", static_cast<unsigned>(port), errno);
+            close(g_listenFd);
+            g_listenFd = -1;
+            return;
+        }
+        fcntl(g_listenFd, F_SETFL, fcntl(g_listenFd, F_GETFL, 0) | O_NONBLOCK);
 
-        g_server->begin();
+        xTaskCreatePinnedToCore(serverTask, "robot-http", SERVER_TASK_STACK, nullptr, 1, &g_serverTask, 0);
+        Metrics::trackTask(g_serverTask);
         Serial.printf("[robot-http] listening on port %u\n", static_cast<unsigned>(port));
     }
 
     void handle()
     {
-        if (!g_server)
+        uint8_t index;
+        while (g_deferred.pop(index))
+        {
+            Connection &c = g_connections[index];
+            switch (c.route)
+            {
+            case Route::Mode:
+                handleMode(c);
+                break;
+            case Route::Select:
+                handleSelect(c);
+                break;
+            case Route::Led:
+                handleLed(c);
+                break;
+            case Route::Metrics:
+                handleMetrics(c);
+                break;
+            default:
+                break;
+            }
+            c.state.store(ConnState::Ready, std::memory_order_release);
+        }
+    }
+
+    void publishStatus(const StateSchema::Snapshot &s)
+    {
+        if (g_hasPublished && StateSchema::diff(s, g_lastPublished) == 0)
+            return;
+
+        g_statusUpdate.version = g_statusVersion.load(std::memory_order_relaxed) + 1;
+        g_statusUpdate.snapshot = s;
+
+        // The server task hasn't taken the previous update yet; the next
+        // publish retries against the same baseline.
+        if (!g_statusUpdates.push(g_statusUpdate))
             return;
-        g_server->handleClient();
+
+        g_statusVersion.store(g_statusUpdate.version, std::memory_order_release);
+        g_lastPublished = s;
+        g_hasPublished = true;
+    }
+
+    void publishEvent(const char *name)
+    {
+        EventUpdate event;
+        StateSchema::copyText(event.name, sizeof(event.name), name);
+        if (!g_events.push(event))
+            Serial.printf("[robot-http] event queue full, dropped %s\n", name);
+    }
+
+    uint32_t statusVersion()
+    {
+        return g_statusVersion.load(std::memory_order_acquire);
+    }
+
+    void setLedPatternSetter(LedPatternSetter setter)
+    {
+        g_ledPatternSetter = setter;
+    }
+
+    JsonPool::Stats jsonPoolStats()
+    {
+        return g_jsonPool.stats();
     }
 
 }
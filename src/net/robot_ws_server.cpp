@@ -0,0 +1,366 @@
+#include "net/robot_ws_server.h"
+
+#include "net/metrics.h"
+#include "net/spsc_queue.h"
+#include "net/telemetry_stream.h"
+#include "app_config.h"
+#include "secrets.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WebSocketsServer.h>
+
+namespace
+{
+    using ControlCommands::Command;
+    using ControlCommands::CommandType;
+
+    constexpr uint8_t MAX_CLIENTS = WEBSOCKETS_SERVER_CLIENT_MAX;
+    constexpr uint32_t WS_TASK_STACK = 6144;
+    constexpr uint32_t WS_TASK_IDLE_MS = 2;
+    constexpr uint8_t NO_OWNER = 0xFF;
+
+    struct TxFrame
+    {
+        uint8_t clientId;
+        bool binary;
+        uint16_t length;
+        char data[AppConfig::ROBOT_WS_FRAME_BYTES];
+    };
+
+    // Control-task view of one connected client.
+    struct Subscriber
+    {
+        bool connected;
+        StateSchema::FieldMask mask;
+        uint32_t periodMs;
+        uint32_t lastSentMs;
+        bool hasLastSent;
+        StateSchema::Snapshot lastSent;
+    };
+
+    WebSocketsServer *g_server = nullptr;
+    TaskHandle_t g_serverTask = nullptr;
+
+    ControlCommands::Handlers g_handlers{};
+    ControlCommands::Coalescer g_coalescers[MAX_CLIENTS];
+    Subscriber g_subscribers[MAX_CLIENTS];
+    uint8_t g_clientCount = 0;
+
+    uint8_t g_driveOwner = NO_OWNER;
+    uint32_t g_ownerLastDriveMs = 0;
+    uint32_t g_refusedDrives = 0;
+
+    SpscQueue<Command, 16> g_rxQueue;
+    SpscQueue<TxFrame, 4> g_txQueue;
+
+    // Rx parse runs on the server task; STATE/ack encoding on the control task.
+    StaticJsonPool<AppConfig::WS_JSON_POOL_BYTES> g_rxJsonPool;
+    StaticJsonPool<AppConfig::ROBOT_WS_JSON_POOL_BYTES> g_txJsonPool;
+    TxFrame g_txFrame;
+
+    void enqueue(const Command &cmd)
+    {
+        if (!g_rxQueue.push(cmd))
+            Serial.printf("[robot-ws] rx queue full, dropped command %u\n", static_cast<unsigned>(cmd.type));
+    }
+
+    void serverEvent(uint8_t num, WStype_t type, uint8_t *payload, size_t length)
+    {
+        if (num >= MAX_CLIENTS)
+            return;
+
+        Command cmd{};
+        cmd.clientId = num;
+
+        switch (type)
+        {
+        case WStype_CONNECTED:
+            Serial.printf("[robot-ws] client %u connected from %s\n", static_cast<unsigned>(num), g_server->remoteIP(num).toString().c_str());
+            g_server->sendTXT(num, ControlCommands::HELLO_JSON);
+            cmd.type = CommandType::Connected;
+            enqueue(cmd);
+            break;
+
+        case WStype_DISCONNECTED:
+            Serial.printf("[robot-ws] client %u disconnected\n", static_cast<unsigned>(num));
+            cmd.type = CommandType::Disconnected;
+            enqueue(cmd);
+            break;
+
+        case WStype_TEXT:
+            if (payload && length > 0)
+            {
+                const uint32_t rxUs = micros();
+                JsonDocument doc(&g_rxJsonPool);
+                if (ControlCommands::decode(doc, reinterpret_cast<const char *>(payload), length, rxUs, ControlCommands::Source::Lan, cmd))
+                    enqueue(cmd);
+            }
+            break;
+
+        case WStype_BIN:
+            if (payload && length > 0 && ControlCommands::decodeBinary(payload, length, micros(), ControlCommands::Source::Lan, cmd))
+                enqueue(cmd);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void serverTask(void *)
+    {
+        TxFrame frame;
+        for (;;)
+        {
+            g_server->loop();
+
+            while (g_txQueue.pop(frame))
+            {
+                if (frame.binary)
+                    g_server->sendBIN(frame.clientId, reinterpret_cast<const uint8_t *>(frame.data), frame.length);
+                else
+                    g_server->sendTXT(frame.clientId, frame.data, frame.length);
+            }
+
+            vTaskDelay(pdMS_TO_TICKS(WS_TASK_IDLE_MS));
+        }
+    }
+
+    bool sendDocument(uint8_t clientId, const JsonDocument &doc)
+    {
+        const size_t len = serializeJson(doc, g_txFrame.data, sizeof(g_txFrame.data));
+        if (doc.overflowed() || len == 0 || len >= sizeof(g_txFrame.data) - 1)
+        {
+            Serial.printf("[robot-ws] tx skipped: message exceeds %u bytes\n", static_cast<unsigned>(sizeof(g_txFrame.data)));
+            return false;
+        }
+
+        g_txFrame.clientId = clientId;
+        g_txFrame.binary = false;
+        g_txFrame.length = static_cast<uint16_t>(len);
+        return g_txQueue.push(g_txFrame);
+    }
+
+    uint32_t clampPeriod(uint32_t periodMs)
+    {
+        if (periodMs == 0)
+            return AppConfig::ROBOT_WS_DEFAULT_PERIOD_MS;
+        if (periodMs < AppConfig::ROBOT_WS_MIN_PERIOD_MS)
+            return AppConfig::ROBOT_WS_MIN_PERIOD_MS;
+        if (periodMs > AppConfig::ROBOT_WS_MAX_PERIOD_MS)
+            return AppConfig::ROBOT_WS_MAX_PERIOD_MS;
+        return periodMs;
+    }
+
+    void setConnected(uint8_t clientId, bool connected)
+    {
+        Subscriber &sub = g_subscribers[clientId];
+        if (sub.connected != connected)
+        {
+            if (connected)
+                ++g_clientCount;
+            else
+                --g_clientCount;
+        }
+
+        sub.connected = connected;
+        sub.mask = 0;
+        sub.hasLastSent = false;
+    }
+
+    void subscribe(uint8_t clientId, StateSchema::FieldMask mask, uint32_t periodMs)
+    {
+        Subscriber &sub = g_subscribers[clientId];
+        if (!sub.connected)
+            return;
+
+        sub.mask = mask;
+        sub.periodMs = clampPeriod(periodMs);
+        sub.hasLastSent = false; // next frame carries every subscribed field
+        sub.lastSentMs = millis() - sub.periodMs;
+
+        Serial.printf("[robot-ws] client %u %s every %lu ms\n",
+                      static_cast<unsigned>(clientId),
+                      mask ? "subscribed" : "unsubscribed",
+                      static_cast<unsigned long>(sub.periodMs));
+    }
+
+    bool isDue(const Subscriber &sub, uint32_t nowMs)
+    {
+        return sub.connected && sub.mask && (nowMs - sub.lastSentMs) >= sub.periodMs;
+    }
+
+    // False if another client holds the drive.
+    bool claimDrive(uint8_t clientId, uint32_t nowMs)
+    {
+        if (g_driveOwner != clientId && g_driveOwner != NO_OWNER &&
+            (nowMs - g_ownerLastDriveMs) < AppConfig::ROBOT_WS_DRIVE_OWNER_IDLE_MS)
+            return false;
+
+        if (g_driveOwner != clientId)
+            Serial.printf("[robot-ws] client %u holds the drive\n", static_cast<unsigned>(clientId));
+        g_driveOwner = clientId;
+        g_ownerLastDriveMs = nowMs;
+        return true;
+    }
+}
+
+namespace RobotWsServer
+{
+    void begin(uint16_t port, const ControlCommands::Handlers &handlers)
+    {
+        // LAN clients come and go independently of the backend link, so the
+        // session callbacks stay local to this server.
+        g_handlers = handlers;
+        g_handlers.onConnected = nullptr;
+        g_handlers.onDisconnected = nullptr;
+
+        if (g_server)
+        {
+            Serial.println("[robot-ws] already started");
+            return;
+        }
+
+        g_server = new WebSocketsServer(port);
+        g_server->setAuthorization("robot", Secrets::LAN_API_KEY);
+        g_server->onEvent(serverEvent);
+        g_server->enableHeartbeat(5000, 2000, 2);
+        g_server->begin();
+
+        xTaskCreatePinnedToCore(serverTask, "robot-ws", WS_TASK_STACK, nullptr, 2, &g_serverTask, 0);
+        Metrics::trackTask(g_serverTask);
+        Serial.printf("[robot-ws] listening on port %u\n", static_cast<unsigned>(port));
+    }
+
+    void loop()
+    {
+        const uint32_t nowMs = millis();
+        Command cmd;
+        while (g_rxQueue.pop(cmd))
+        {
+            if (cmd.clientId >= MAX_CLIENTS)
+                continue;
+
+            if (cmd.type == CommandType::Connected || cmd.type == CommandType::Disconnected)
+            {
+                setConnected(cmd.clientId, cmd.type == CommandType::Connected);
+                TelemetryStream::unsubscribe(cmd.clientId);
+                if (cmd.type == CommandType::Connected)
+                    g_coalescers[cmd.clientId].reset(); // a new client under a reused id
+                else if (g_driveOwner == cmd.clientId)
+                    g_driveOwner = NO_OWNER;
+            }
+
+            if (cmd.type == CommandType::Telemetry)
+            {
+                if (g_subscribers[cmd.clientId].connected)
+                    TelemetryStream::subscribe(cmd.clientId, cmd.telemetry.rateHz, cmd.telemetry.batchMs);
+                continue;
+            }
+
+            if (cmd.type == CommandType::Subscribe)
+            {
+                subscribe(cmd.clientId, cmd.subscribe.mask, cmd.subscribe.periodMs);
+                continue;
+            }
+
+            if (cmd.type == CommandType::Drive && !claimDrive(cmd.clientId, nowMs))
+            {
+                ++g_refusedDrives;
+                continue;
+            }
+
+            g_coalescers[cmd.clientId].accept(cmd, g_handlers);
+        }
+
+        for (ControlCommands::Coalescer &c : g_coalescers)
+            c.flush(g_handlers);
+    }
+
+    bool wantsState(uint32_t nowMs)
+    {
+        for (const Subscriber &sub : g_subscribers)
+        {
+            if (isDue(sub, nowMs))
+                return true;
+        }
+        return false;
+    }
+
+    void publishState(const StateSchema::Snapshot &s, uint32_t nowMs)
+    {
+        for (uint8_t id = 0; id < MAX_CLIENTS; ++id)
+        {
+            Subscriber &sub = g_subscribers[id];
+            if (!isDue(sub, nowMs))
+                continue;
+
+            sub.lastSentMs = nowMs;
+
+            const StateSchema::FieldMask changed = sub.hasLastSent ? (StateSchema::diff(s, sub.lastSent) & sub.mask) : sub.mask;
+            if (changed == 0)
+                continue;
+
+            JsonDocument doc(&g_txJsonPool);
+            doc["type"] = "STATE";
+            StateSchema::writeJson(s, doc["state"].to<JsonObject>(), StateSchema::Target::Status, changed);
+
+            // Only a frame that was queued counts as the client's new baseline.
+            if (sendDocument(id, doc))
+            {
+                sub.lastSent = s;
+                sub.hasLastSent = true;
+            }
+        }
+    }
+
+    bool sendDriveAck(uint8_t clientId, const ControlCommands::DriveAck &ack)
+    {
+        if (clientId >= MAX_CLIENTS || !g_subscribers[clientId].connected)
+            return false;
+
+        JsonDocument doc(&g_txJsonPool);
+        ControlCommands::writeDriveAck(ack, doc.to<JsonObject>());
+        return sendDocument(clientId, doc);
+    }
+
+    bool sendBinary(uint8_t clientId, const uint8_t *data, size_t len)
+    {
+        if (clientId >= MAX_CLIENTS || !g_subscribers[clientId].connected)
+            return false;
+        if (len == 0 || len > sizeof(g_txFrame.data))
+            return false;
+
+        g_txFrame.clientId = clientId;
+        g_txFrame.binary = true;
+        g_txFrame.length = static_cast<uint16_t>(len);
+        memcpy(g_txFrame.data, data, len);
+        return g_txQueue.push(g_txFrame);
+    }
+
+    uint8_t clientCount()
+    {
+        return g_clientCount;
+    }
+
+    ControlCommands::DriveStats driveStats()
+    {
+        ControlCommands::DriveStats total{};
+        for (const ControlCommands::Coalescer &c : g_coalescers)
+        {
+            const ControlCommands::DriveStats s = c.stats();
+            total.received += s.received;
+            total.applied += s.applied;
+            total.coalesced += s.coalesced;
+            total.stale += s.stale;
+        }
+        total.received += g_refusedDrives;
+        total.refused = g_refusedDrives;
+        return total;
+    }
+
+    JsonPool::Stats jsonPoolStats()
+    {
+        return g_txJsonPool.stats();
+    }
+}
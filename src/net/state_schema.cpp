@@ -0,0 +1,250 @@
+#include "net/state_schema.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace StateSchema
+{
+    namespace
+    {
+#define SS_ALWAYS ALWAYS_PRESENT
+#define SS_WHEN(field) offsetof(Snapshot, field)
+#define STATE_SCHEMA_INFO(name, type, capacity, presence, deadband, statusGroup, statusKey, backendGroup, backendKey, flags) \
+    {#name,                                                                                                                   \
+     FieldType::type,                                                                                                         \
+     static_cast<uint16_t>(offsetof(Snapshot, name)),                                                                         \
+     static_cast<uint16_t>(sizeof(Snapshot::name)),                                                                           \
+     presence,                                                                                                                \
+     deadband,                                                                                                                \
+     Group::statusGroup,                                                                                                      \
+     statusKey,                                                                                                               \
+     Group::backendGroup,                                                                                                     \
+     backendKey,                                                                                                              \
+     flags},
+
+        const FieldInfo FIELDS[FIELD_COUNT] = {ROBOT_STATE_FIELDS(STATE_SCHEMA_INFO)};
+
+#undef STATE_SCHEMA_INFO
+#undef SS_WHEN
+#undef SS_ALWAYS
+
+        struct GroupInfo
+        {
+            Group parent;
+            const char *key;
+        };
+
+        // Indexed by Group; Root is the document itself.
+        const GroupInfo GROUPS[static_cast<size_t>(Group::Count)] = {
+            {Group::None, nullptr},
+            {Group::None, nullptr},
+            {Group::Root, "lastRoute"},
+            {Group::Root, "sensors"},
+            {Group::Sensors, "ir"},
+            {Group::Sensors, "light"},
+            {Group::Sensors, "power"},
+            {Group::Sensors, "gyroscope"},
+            {Group::Sensors, "rfid"},
+            {Group::Root, "led"},
+            {Group::Root, "audio"},
+            {Group::Root, "gyroscope"},
+            {Group::Root, "infrared"},
+        };
+
+        struct Alias
+        {
+            Field field;
+            const char *key;
+        };
+
+        // Top-level copies of the power readings that older /status clients still read.
+        const Alias STATUS_ROOT_ALIASES[] = {
+            {Field::batteryVoltage, "batteryVoltage"},
+            {Field::batteryCurrentA, "batteryCurrentA"},
+            {Field::batteryPowerW, "batteryPowerW"},
+        };
+
+        const uint8_t BINARY_VERSION = 1;
+
+        const uint8_t *fieldPtr(const Snapshot &s, const FieldInfo &f)
+        {
+            return reinterpret_cast<const uint8_t *>(&s) + f.offset;
+        }
+
+        bool isPresent(const Snapshot &s, const FieldInfo &f)
+        {
+            if (f.presenceOffset == ALWAYS_PRESENT)
+                return true;
+            return *(reinterpret_cast<const bool *>(reinterpret_cast<const uint8_t *>(&s) + f.presenceOffset));
+        }
+
+        JsonObject resolveGroup(JsonObject *cache, Group g)
+        {
+            const size_t index = static_cast<size_t>(g);
+            if (cache[index].isNull())
+            {
+                JsonObject parent = resolveGroup(cache, GROUPS[index].parent);
+                cache[index] = parent[GROUPS[index].key].to<JsonObject>();
+            }
+            return cache[index];
+        }
+
+        void writeValue(JsonObject obj, const char *key, const Snapshot &s, const FieldInfo &f)
+        {
+            const uint8_t *value = fieldPtr(s, f);
+            switch (f.type)
+            {
+            case FieldType::Bool:
+                obj[key] = *reinterpret_cast<const bool *>(value);
+                break;
+            case FieldType::Int:
+                obj[key] = *reinterpret_cast<const int32_t *>(value);
+                break;
+            case FieldType::Float:
+                obj[key] = *reinterpret_cast<const float *>(value);
+                break;
+            case FieldType::Text:
+            {
+                const char *text = reinterpret_cast<const char *>(value);
+                if ((f.flags & NULL_IF_EMPTY) && text[0] == '\0')
+                    obj[key] = nullptr;
+                else
+                    obj[key] = text;
+                break;
+            }
+            }
+        }
+    }
+
+    const FieldInfo &info(Field f)
+    {
+        return FIELDS[static_cast<size_t>(f)];
+    }
+
+    void copyText(char *dest, size_t destSize, const char *src)
+    {
+        if (!dest || destSize == 0)
+            return;
+
+        if (!src)
+            src = "";
+
+        const size_t n = strlen(src);
+        const size_t copyLen = (n < (destSize - 1)) ? n : (destSize - 1);
+        memcpy(dest, src, copyLen);
+        dest[copyLen] = '\0';
+    }
+
+    void writeJson(const Snapshot &s, JsonObject root, Target target, FieldMask mask)
+    {
+        JsonObject groups[static_cast<size_t>(Group::Count)];
+        groups[static_cast<size_t>(Group::Root)] = root;
+
+        for (size_t i = 0; i < FIELD_COUNT; ++i)
+        {
+            if (!(mask & (1ULL << i)))
+                continue;
+
+            const FieldInfo &f = FIELDS[i];
+            const Group group = (target == Target::Status) ? f.statusGroup : f.backendGroup;
+            if (group == Group::None)
+                continue;
+
+            // The backend leaves absent readings out; /status reports them zeroed.
+            if (target == Target::Backend && !isPresent(s, f))
+                continue;
+
+            writeValue(resolveGroup(groups, group), (target == Target::Status) ? f.statusKey : f.backendKey, s, f);
+        }
+
+        if (target != Target::Status)
+            return;
+
+        for (const Alias &alias : STATUS_ROOT_ALIASES)
+        {
+            if (mask & bit(alias.field))
+                writeValue(root, alias.key, s, info(alias.field));
+        }
+    }
+
+    size_t encodeBinary(const Snapshot &s, uint8_t *out, size_t outSize, FieldMask mask)
+    {
+        if (!out || outSize < 9)
+            return 0;
+
+        size_t pos = 0;
+        out[pos++] = BINARY_VERSION;
+        for (uint8_t b = 0; b < 8; ++b)
+            out[pos++] = static_cast<uint8_t>(mask >> (8 * b));
+
+        for (size_t i = 0; i < FIELD_COUNT; ++i)
+        {
+            if (!(mask & (1ULL << i)))
+                continue;
+
+            const FieldInfo &f = FIELDS[i];
+            const uint8_t *value = fieldPtr(s, f);
+
+            if (f.type == FieldType::Text)
+            {
+                const size_t len = strnlen(reinterpret_cast<const char *>(value), f.size);
+                if (pos + 1 + len > outSize)
+                    return 0;
+                out[pos++] = static_cast<uint8_t>(len);
+                memcpy(out + pos, value, len);
+                pos += len;
+                continue;
+            }
+
+            const size_t width = (f.type == FieldType::Bool) ? 1 : 4;
+            if (pos + width > outSize)
+                return 0;
+
+            if (f.type == FieldType::Bool)
+            {
+                out[pos++] = *reinterpret_cast<const bool *>(value) ? 1 : 0;
+                continue;
+            }
+
+            // Xtensa is little-endian, so the in-memory form is already the wire form.
+            memcpy(out + pos, value, width);
+            pos += width;
+        }
+
+        return pos;
+    }
+
+    FieldMask diff(const Snapshot &a, const Snapshot &b)
+    {
+        FieldMask changed = 0;
+
+        for (size_t i = 0; i < FIELD_COUNT; ++i)
+        {
+            const FieldInfo &f = FIELDS[i];
+            const uint8_t *va = fieldPtr(a, f);
+            const uint8_t *vb = fieldPtr(b, f);
+
+            bool same = false;
+            switch (f.type)
+            {
+            case FieldType::Bool:
+                same = *reinterpret_cast<const bool *>(va) == *reinterpret_cast<const bool *>(vb);
+                break;
+            case FieldType::Int:
+                same = *reinterpret_cast<const int32_t *>(va) == *reinterpret_cast<const int32_t *>(vb);
+                break;
+            case FieldType::Float:
+                same = std::fabs(*reinterpret_cast<const float *>(va) - *reinterpret_cast<const float *>(vb)) <= f.deadband;
+                break;
+            case FieldType::Text:
+                same = strncmp(reinterpret_cast<const char *>(va), reinterpret_cast<const char *>(vb), f.size) == 0;
+                break;
+            }
+
+            if (!same)
+                changed |= (1ULL << i);
+        }
+
+        return changed;
+    }
+}
@@ -0,0 +1,296 @@
+#include "net/telemetry_stream.h"
+
+#include "net/robot_ws_server.h"
+#include "app_config.h"
+#include <cstring>
+
+namespace
+{
+    using TelemetryStream::Channel;
+    using TelemetryStream::CHANNEL_COUNT;
+    using TelemetryStream::MAX_VALUES;
+
+    const TelemetryStream::ChannelInfo CHANNELS[CHANNEL_COUNT] = {
+        {"imu", 6, 200},
+        {"motor", 6, 200},
+        {"power", 3, 20},
+        {"light", 1, 4},
+        {"ir", 3, 50},
+    };
+
+    constexpr uint8_t FRAME_MAGIC = 0x54;
+    constexpr uint8_t FRAME_VERSION = 1;
+    constexpr size_t HEADER_BYTES = 6;
+    constexpr size_t RECORD_HEADER_BYTES = 6;
+    constexpr uint16_t DEFAULT_BATCH_MS = 50;
+    constexpr uint16_t MIN_BATCH_MS = 10;
+    constexpr uint16_t MAX_BATCH_MS = 1000;
+
+    struct Accumulator
+    {
+        uint16_t decimation; // 0 = channel off for this subscriber
+        uint16_t count;
+        float sum[MAX_VALUES];
+    };
+
+    struct Subscriber
+    {
+        bool used;
+        uint8_t clientId;
+        uint16_t batchMs;
+        uint16_t seq;
+        uint16_t records;
+        uint32_t batchStartMs;
+        size_t length;
+        Accumulator acc[CHANNEL_COUNT];
+        uint8_t frame[AppConfig::TELEMETRY_FRAME_BYTES];
+    };
+
+    Subscriber g_subscribers[AppConfig::TELEMETRY_MAX_SUBSCRIBERS];
+    uint32_t g_nextSampleUs[CHANNEL_COUNT];
+    TelemetryStream::Stats g_stats{};
+
+    void putU16(uint8_t *p, uint16_t v)
+    {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    void putU32(uint8_t *p, uint32_t v)
+    {
+        for (uint8_t i = 0; i < 4; ++i)
+            p[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    void sendBatch(Subscriber &sub)
+    {
+        if (sub.records == 0)
+            return;
+
+        sub.frame[0] = FRAME_MAGIC;
+        sub.frame[1] = FRAME_VERSION;
+        putU16(sub.frame + 2, sub.seq++);
+        putU16(sub.frame + 4, sub.records);
+
+        if (RobotWsServer::sendBinary(sub.clientId, sub.frame, sub.length))
+        {
+            ++g_stats.framesSent;
+            g_stats.recordsSent += sub.records;
+        }
+        else
+        {
+            ++g_stats.framesDropped;
+        }
+
+        sub.records = 0;
+        sub.length = HEADER_BYTES;
+    }
+
+    void appendRecord(Subscriber &sub, Channel c, const float *values, uint32_t nowUs)
+    {
+        const uint8_t count = CHANNELS[static_cast<size_t>(c)].valueCount;
+        const size_t recordBytes = RECORD_HEADER_BYTES + count * sizeof(float);
+
+        if (sub.length + recordBytes > sizeof(sub.frame))
+            sendBatch(sub);
+        if (sub.records == 0)
+            sub.batchStartMs = millis();
+
+        uint8_t *p = sub.frame + sub.length;
+        p[0] = static_cast<uint8_t>(c);
+        p[1] = count;
+        putU32(p + 2, nowUs);
+        // Xtensa is little-endian, so floats go out as they sit in memory.
+        memcpy(p + RECORD_HEADER_BYTES, values, count * sizeof(float));
+
+        sub.length += recordBytes;
+        ++sub.records;
+    }
+
+    Subscriber *findSubscriber(uint8_t clientId)
+    {
+        for (Subscriber &sub : g_subscribers)
+        {
+            if (sub.used && sub.clientId == clientId)
+                return &sub;
+        }
+        return nullptr;
+    }
+
+    uint8_t countSubscribers()
+    {
+        uint8_t n = 0;
+        for (const Subscriber &sub : g_subscribers)
+            n += sub.used ? 1 : 0;
+        return n;
+    }
+}
+
+namespace TelemetryStream
+{
+    const ChannelInfo &info(Channel c)
+    {
+        return CHANNELS[static_cast<size_t>(c)];
+    }
+
+    bool channelFromName(const char *name, Channel &out)
+    {
+        if (!name)
+            return false;
+
+        for (size_t i = 0; i < CHANNEL_COUNT; ++i)
+        {
+            if (strcmp(CHANNELS[i].name, name) == 0)
+            {
+                out = static_cast<Channel>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void subscribe(uint8_t clientId, const uint16_t *rateHz, uint16_t batchMs)
+    {
+        bool any = false;
+        for (size_t i = 0; i < CHANNEL_COUNT; ++i)
+            any = any || rateHz[i] > 0;
+
+        if (!any)
+        {
+            unsubscribe(clientId);
+            return;
+        }
+
+        Subscriber *sub = findSubscriber(clientId);
+        if (!sub)
+        {
+            for (Subscriber &candidate : g_subscribers)
+            {
+                if (!candidate.used)
+                {
+                    sub = &candidate;
+                    break;
+                }
+            }
+        }
+        if (!sub)
+        {
+            Serial.printf("[telemetry] client %u rejected: %u subscribers max\n",
+                          static_cast<unsigned>(clientId),
+                          static_cast<unsigned>(AppConfig::TELEMETRY_MAX_SUBSCRIBERS));
+            return;
+        }
+
+        memset(sub, 0, sizeof(Subscriber));
+        sub->used = true;
+        sub->clientId = clientId;
+        sub->length = HEADER_BYTES;
+        sub->batchMs = (batchMs == 0) ? DEFAULT_BATCH_MS : batchMs;
+        if (sub->batchMs < MIN_BATCH_MS)
+            sub->batchMs = MIN_BATCH_MS;
+        if (sub->batchMs > MAX_BATCH_MS)
+            sub->batchMs = MAX_BATCH_MS;
+
+        Serial.printf("[telemetry] client %u batch=%ums", static_cast<unsigned>(clientId), static_cast<unsigned>(sub->batchMs));
+        for (size_t i = 0; i < CHANNEL_COUNT; ++i)
+        {
+            if (rateHz[i] == 0)
+                continue;
+
+            const uint16_t source = CHANNELS[i].sourceHz;
+            const uint16_t rate = (rateHz[i] > source) ? source : rateHz[i];
+            const uint16_t decimation = static_cast<uint16_t>((source + rate / 2) / rate);
+            sub->acc[i].decimation = decimation ? decimation : 1;
+            Serial.printf(" %s=%uHz", CHANNELS[i].name, static_cast<unsigned>(source / sub->acc[i].decimation));
+        }
+        Serial.println();
+
+        g_stats.subscribers = countSubscribers();
+    }
+
+    void unsubscribe(uint8_t clientId)
+    {
+        Subscriber *sub = findSubscriber(clientId);
+        if (!sub)
+            return;
+
+        sub->used = false;
+        g_stats.subscribers = countSubscribers();
+        Serial.printf("[telemetry] client %u unsubscribed\n", static_cast<unsigned>(clientId));
+    }
+
+    bool active(Channel c)
+    {
+        const size_t index = static_cast<size_t>(c);
+        for (const Subscriber &sub : g_subscribers)
+        {
+            if (sub.used && sub.acc[index].decimation)
+                return true;
+        }
+        return false;
+    }
+
+    bool due(Channel c, uint32_t nowUs)
+    {
+        if (!active(c))
+            return false;
+
+        const size_t index = static_cast<size_t>(c);
+        if (static_cast<int32_t>(nowUs - g_nextSampleUs[index]) < 0)
+            return false;
+
+        // Keep the source grid steady; after a stall, restart from now
+        // instead of bursting to catch up.
+        const uint32_t periodUs = 1000000UL / CHANNELS[index].sourceHz;
+        g_nextSampleUs[index] += periodUs;
+        if (static_cast<int32_t>(nowUs - g_nextSampleUs[index]) >= 0)
+            g_nextSampleUs[index] = nowUs + periodUs;
+        return true;
+    }
+
+    void offer(Channel c, const float *values, uint32_t nowUs)
+    {
+        const size_t index = static_cast<size_t>(c);
+        const uint8_t count = CHANNELS[index].valueCount;
+
+        for (Subscriber &sub : g_subscribers)
+        {
+            if (!sub.used)
+                continue;
+
+            Accumulator &acc = sub.acc[index];
+            if (!acc.decimation)
+                continue;
+
+            for (uint8_t v = 0; v < count; ++v)
+                acc.sum[v] += values[v];
+
+            if (++acc.count < acc.decimation)
+                continue;
+
+            float mean[MAX_VALUES];
+            for (uint8_t v = 0; v < count; ++v)
+            {
+                mean[v] = acc.sum[v] / static_cast<float>(acc.count);
+                acc.sum[v] = 0.0f;
+            }
+            acc.count = 0;
+
+            appendRecord(sub, c, mean, nowUs);
+        }
+    }
+
+    void flush(uint32_t nowMs)
+    {
+        for (Subscriber &sub : g_subscribers)
+        {
+            if (sub.used && sub.records > 0 && (nowMs - sub.batchStartMs) >= sub.batchMs)
+                sendBatch(sub);
+        }
+    }
+
+    Stats stats()
+    {
+        return g_stats;
+    }
+}
@@ -0,0 +1,326 @@
+#include "net/udp_teleop.h"
+
+#include "net/metrics.h"
+#include "secrets.h"
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <cmath>
+#include <cstring>
+#include <mbedtls/md.h>
+
+namespace
+{
+    constexpr uint16_t MAGIC = 0x5454;
+    constexpr uint8_t VERSION = 2;
+    constexpr uint8_t FLAG_STOP = 0x01;
+    constexpr uint8_t FLAG_NONCE = 0x02;
+    constexpr size_t SIGNED_BYTES = 20;
+    constexpr size_t NONCE_SIGNED_BYTES = 8;
+    constexpr size_t TAG_BYTES = 8;
+
+    // A session with no accepted datagram for this long ends; its nonce is
+    // replaced, so nothing recorded in it is accepted again.
+    constexpr uint32_t SESSION_TIMEOUT_MS = 2000;
+    // How far a datagram's sender timestamp may lag the fastest transit seen
+    // in the session. The baseline follows slowly (1 ms per s) so drift
+    // between the two clocks does not add up.
+    constexpr int32_t MAX_DELAY_MS = 500;
+    // NONCE replies go out at most this often.
+    constexpr uint32_t NONCE_REPLY_GAP_MS = 100;
+    // Bounds the time one poll() can spend on a flooded socket.
+    constexpr uint8_t MAX_DATAGRAMS_PER_POLL = 16;
+
+    struct Packet
+    {
+        uint8_t flags;
+        uint32_t nonce;
+        uint32_t seq;
+        uint32_t senderTs;
+        float throttle;
+        float steer;
+    };
+
+    WiFiUDP g_udp;
+    bool g_started = false;
+    UdpTeleop::Handlers g_handlers{};
+    UdpTeleop::Stats g_stats{};
+
+    uint32_t g_nonce = 0;
+    bool g_hasSession = false;
+    uint32_t g_highestSeq = 0;
+    uint32_t g_lastAcceptMs = 0;
+    bool g_hasTransit = false;
+    int32_t g_lastTransitMs = 0;
+    int32_t g_baseTransitMs = 0;
+    uint32_t g_lastNonceReplyMs = 0;
+
+    uint16_t readU16(const uint8_t *p)
+    {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t readU32(const uint8_t *p)
+    {
+        return static_cast<uint32_t>(p[0]) |
+               (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) |
+               (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    float readAxis(const uint8_t *p)
+    {
+        const int16_t raw = static_cast<int16_t>(readU16(p));
+        const float v = static_cast<float>(raw) / 32767.0f;
+        return (v < -1.0f) ? -1.0f : v;
+    }
+
+    void writeU16(uint8_t *p, uint16_t v)
+    {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    void writeU32(uint8_t *p, uint32_t v)
+    {
+        for (uint8_t i = 0; i < 4; ++i)
+            p[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    bool sign(const uint8_t *buf, size_t len, uint8_t *mac)
+    {
+        const mbedtls_md_info_t *md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+        if (!md)
+            return false;
+
+        const char *key = Secrets::UDP_TELEOP_KEY;
+        return mbedtls_md_hmac(md, reinterpret_cast<const unsigned char *>(key), strlen(key), buf, len, mac) == 0;
+    }
+
+    bool tagValid(const uint8_t *buf)
+    {
+        uint8_t mac[32];
+        if (!sign(buf, SIGNED_BYTES, mac))
+            return false;
+
+        // Constant time, so the tag cannot be guessed byte by byte.
+        uint8_t diff = 0;
+        for (size_t i = 0; i < TAG_BYTES; ++i)
+            diff |= static_cast<uint8_t>(mac[i] ^ buf[SIGNED_BYTES + i]);
+        return diff == 0;
+    }
+
+    // Never 0, which senders use to ask for the nonce.
+    void newSession()
+    {
+        do
+            g_nonce = esp_random();
+        while (g_nonce == 0);
+
+        g_hasSession = false;
+        g_highestSeq = 0;
+        g_hasTransit = false;
+    }
+
+    void replyNonce(uint32_t nowMs)
+    {
+        if (nowMs - g_lastNonceReplyMs < NONCE_REPLY_GAP_MS)
+            return;
+        g_lastNonceReplyMs = nowMs;
+
+        uint8_t reply[UdpTeleop::NONCE_REPLY_BYTES];
+        writeU16(reply, MAGIC);
+        reply[2] = VERSION;
+        reply[3] = FLAG_NONCE;
+        writeU32(reply + 4, g_nonce);
+
+        uint8_t mac[32];
+        if (!sign(reply, NONCE_SIGNED_BYTES, mac))
+            return;
+        memcpy(reply + NONCE_SIGNED_BYTES, mac, TAG_BYTES);
+
+        g_udp.beginPacket(g_udp.remoteIP(), g_udp.remotePort());
+        g_udp.write(reply, sizeof(reply));
+        g_udp.endPacket();
+    }
+
+    bool decode(const uint8_t *buf, size_t len, Packet &out)
+    {
+        if (len != UdpTeleop::PACKET_BYTES || readU16(buf) != MAGIC || buf[2] != VERSION)
+        {
+            ++g_stats.malformed;
+            return false;
+        }
+
+        if (!tagValid(buf))
+        {
+            ++g_stats.authFailed;
+            return false;
+        }
+
+        out.flags = buf[3];
+        out.nonce = readU32(buf + 4);
+        out.seq = readU32(buf + 8);
+        out.senderTs = readU32(buf + 12);
+        out.throttle = readAxis(buf + 16);
+        out.steer = readAxis(buf + 18);
+        return true;
+    }
+
+    // Transit carries an unknown clock offset, but it cancels in the
+    // differences. False if the datagram is too late to be a live one.
+    bool checkTransit(const Packet &p, uint32_t nowMs)
+    {
+        const int32_t transit = static_cast<int32_t>(nowMs - p.senderTs);
+        if (!g_hasTransit)
+        {
+            g_baseTransitMs = transit;
+            g_lastTransitMs = transit;
+            g_hasTransit = true;
+            return true;
+        }
+
+        const int32_t base = g_baseTransitMs + static_cast<int32_t>((nowMs - g_lastAcceptMs) / 1000U);
+        if (transit - base > MAX_DELAY_MS)
+            return false;
+
+        g_baseTransitMs = (transit < base) ? transit : base;
+        const int32_t d = transit - g_lastTransitMs;
+        g_stats.jitterMs += (std::fabs(static_cast<float>(d)) - g_stats.jitterMs) / 16.0f;
+        g_lastTransitMs = transit;
+        return true;
+    }
+}
+
+namespace UdpTeleop
+{
+    bool begin(uint16_t port, const Handlers &handlers)
+    {
+        g_handlers = handlers;
+
+        if (g_started)
+            return true;
+
+        newSession();
+        g_started = g_udp.begin(port) == 1;
+        Serial.printf("[udp-teleop] %s on port %u\n", g_started ? "listening" : "bind failed", static_cast<unsigned>(port));
+        return g_started;
+    }
+
+    void poll()
+    {
+        if (!g_started)
+            return;
+
+        const uint32_t nowMs = millis();
+        if (g_hasSession && (nowMs - g_lastAcceptMs) >= SESSION_TIMEOUT_MS)
+            newSession();
+
+        Packet newest{};
+        bool hasNewest = false;
+        uint32_t newestRxUs = 0;
+        uint8_t buf[PACKET_BYTES + 1];
+
+        for (uint8_t i = 0; i < MAX_DATAGRAMS_PER_POLL; ++i)
+        {
+            const int size = g_udp.parsePacket();
+            if (size <= 0)
+                break;
+
+            const uint32_t rxUs = micros();
+            ++g_stats.received;
+
+            // Oversized datagrams are read short and rejected on length.
+            const int len = g_udp.read(buf, sizeof(buf));
+            Packet p;
+            if (len <= 0 || !decode(buf, (size > len) ? static_cast<size_t>(size) : static_cast<size_t>(len), p))
+                continue;
+
+            if (p.nonce != g_nonce)
+            {
+                ++g_stats.wrongNonce;
+                replyNonce(nowMs);
+                continue;
+            }
+
+            // No wraparound: the session ends at the top of the range.
+            if (g_hasSession && p.seq <= g_highestSeq)
+            {
+                ++g_stats.stale;
+                continue;
+            }
+
+            if (!checkTransit(p, nowMs))
+            {
+                ++g_stats.delayed;
+                continue;
+            }
+
+            if (g_hasSession && (p.seq - g_highestSeq) > 1)
+                g_stats.lost += p.seq - g_highestSeq - 1;
+
+            g_highestSeq = p.seq;
+            g_hasSession = true;
+            g_lastAcceptMs = nowMs;
+
+            if (hasNewest)
+                ++g_stats.superseded;
+            newest = p;
+            newestRxUs = rxUs;
+            hasNewest = true;
+        }
+
+        if (!hasNewest)
+            return;
+
+        ++g_stats.accepted;
+        g_stats.lastSeq = newest.seq;
+
+        // The next datagram gets a NONCE reply and starts a fresh session.
+        if (g_highestSeq == UINT32_MAX)
+            newSession();
+
+        if (newest.flags & FLAG_STOP)
+        {
+            if (g_handlers.onStop)
+                g_handlers.onStop();
+            return;
+        }
+
+        if (g_handlers.onDrive)
+            g_handlers.onDrive(newest.throttle, newest.steer, newestRxUs);
+    }
+
+    bool isActive()
+    {
+        return g_hasSession && (millis() - g_lastAcceptMs) < SESSION_TIMEOUT_MS;
+    }
+
+    Stats stats()
+    {
+        return g_stats;
+    }
+}
+
+namespace
+{
+    void writeMetrics(Metrics::Writer &w)
+    {
+        w.family("robot_udp_teleop_packets_total", "counter", "UDP teleop datagrams by outcome");
+        w.sample("robot_udp_teleop_packets_total", "result=\"received\"", g_stats.received);
+        w.sample("robot_udp_teleop_packets_total", "result=\"accepted\"", g_stats.accepted);
+        w.sample("robot_udp_teleop_packets_total", "result=\"superseded\"", g_stats.superseded);
+        w.sample("robot_udp_teleop_packets_total", "result=\"stale\"", g_stats.stale);
+        w.sample("robot_udp_teleop_packets_total", "result=\"delayed\"", g_stats.delayed);
+        w.sample("robot_udp_teleop_packets_total", "result=\"wrong_nonce\"", g_stats.wrongNonce);
+        w.sample("robot_udp_teleop_packets_total", "result=\"malformed\"", g_stats.malformed);
+        w.sample("robot_udp_teleop_packets_total", "result=\"auth_failed\"", g_stats.authFailed);
+
+        w.family("robot_udp_teleop_lost_total", "counter", "Seq gaps between accepted UDP teleop datagrams");
+        w.sample("robot_udp_teleop_lost_total", nullptr, g_stats.lost);
+        w.family("robot_udp_teleop_jitter_ms", "gauge", "UDP teleop interarrival jitter estimate (RFC 3550)");
+        w.sample("robot_udp_teleop_jitter_ms", nullptr, g_stats.jitterMs);
+        w.family("robot_udp_teleop_active", "gauge", "1 while a UDP teleop session is live");
+        w.sample("robot_udp_teleop_active", nullptr, static_cast<uint32_t>(UdpTeleop::isActive() ? 1 : 0));
+    }
+    Metrics::Collector g_metrics(writeMetrics);
+}
@@ -1,28 +1,283 @@
 #include "net/wifi_manager.h"
+
+#include "app_config.h"
+#include "net/metrics.h"
+#include "net/spsc_queue.h"
+#include <Preferences.h>
 #include <WiFi.h>
+#include <atomic>
+#include <cstring>
+
+namespace
+{
+    constexpr char NVS_NAMESPACE[] = "wifi";
+    constexpr char NVS_AP_KEY[] = "ap";
+
+    enum class LinkState : uint8_t
+    {
+        Idle,
+        Connecting,
+        Connected,
+        Backoff
+    };
+
+    struct SdkEvent
+    {
+        bool gotIp;
+        uint8_t reason; // disconnect reason, 0 for gotIp
+    };
+
+    // NVS record of the last AP joined; only reused for the same SSID.
+    struct ApCache
+    {
+        char ssid[33];
+        uint8_t bssid[6];
+        uint8_t channel;
+    };
+
+    const char *g_ssid = nullptr;
+    const char *g_pass = nullptr;
+    WifiManager::Handlers g_handlers{};
+
+    std::atomic<bool> g_connected{false};
+    SpscQueue<SdkEvent, 8> g_events;
+
+    LinkState g_state = LinkState::Idle;
+    uint32_t g_attemptStartMs = 0;
+    uint32_t g_nextAttemptMs = 0;
+    uint8_t g_failures = 0;
+
+    ApCache g_cache{};
+    bool g_cacheValid = false;
+    bool g_attemptUsedCache = false;
+
+    Metrics::Counter g_attempts("robot_wifi_connect_attempts_total", "WiFi join attempts");
+    Metrics::Counter g_connects("robot_wifi_connects_total", "WiFi joins that obtained an address");
+    Metrics::Counter g_disconnects("robot_wifi_disconnects_total", "WiFi links lost after a successful join");
+
+    constexpr float CONNECT_BUCKETS_MS[] = {250, 500, 1000, 2000, 4000, 8000, 15000};
+    Metrics::Histogram g_connectTime("robot_wifi_connect_ms", "Join attempt start to address assigned",
+                                     CONNECT_BUCKETS_MS, sizeof(CONNECT_BUCKETS_MS) / sizeof(CONNECT_BUCKETS_MS[0]));
+
+    void writeLinkGauges(Metrics::Writer &w)
+    {
+        const bool connected = g_connected.load(std::memory_order_relaxed);
+        w.family("robot_wifi_connected", "gauge", "1 while the station has an address");
+        w.sample("robot_wifi_connected", nullptr, static_cast<uint32_t>(connected ? 1 : 0));
+        if (!connected)
+            return;
+        w.family("robot_wifi_rssi_dbm", "gauge", "Signal strength of the joined AP");
+        w.printf("robot_wifi_rssi_dbm %d\n", static_cast<int>(WiFi.RSSI()));
+    }
+    Metrics::Collector g_linkGauges(writeLinkGauges);
+
+    // WiFi event task: only flips the flag and hands the event on.
+    void onSdkEvent(arduino_event_id_t event, arduino_event_info_t info)
+    {
+        switch (event)
+        {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            g_connected.store(true, std::memory_order_release);
+            g_events.push(SdkEvent{true, 0});
+            break;
+
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            g_connected.store(false, std::memory_order_release);
+            g_events.push(SdkEvent{false, info.wifi_sta_disconnected.reason});
+            break;
+
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            g_connected.store(false, std::memory_order_release);
+            g_events.push(SdkEvent{false, 0});
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void loadCache()
+    {
+        Preferences prefs;
+        if (!prefs.begin(NVS_NAMESPACE, true))
+            return;
+
+        ApCache stored{};
+        const bool read = prefs.getBytes(NVS_AP_KEY, &stored, sizeof(stored)) == sizeof(stored);
+        prefs.end();
+
+        stored.ssid[sizeof(stored.ssid) - 1] = '\0';
+        if (!read || strcmp(stored.ssid, g_ssid) != 0 || stored.channel == 0)
+            return;
+
+        g_cache = stored;
+        g_cacheValid = true;
+    }
+
+    void storeCache()
+    {
+        const uint8_t *bssid = WiFi.BSSID();
+        const int32_t channel = WiFi.channel();
+        if (!bssid || channel <= 0 || channel > 14)
+            return;
+
+        // Flash writes only when the AP actually changed.
+        if (g_cacheValid && g_cache.channel == channel && memcmp(g_cache.bssid, bssid, sizeof(g_cache.bssid)) == 0)
+            return;
+
+        ApCache next{};
+        strncpy(next.ssid, g_ssid, sizeof(next.ssid) - 1);
+        memcpy(next.bssid, bssid, sizeof(next.bssid));
+        next.channel = static_cast<uint8_t>(channel);
+
+        Preferences prefs;
+        if (!prefs.begin(NVS_NAMESPACE, false))
+            return;
+        const bool written = prefs.putBytes(NVS_AP_KEY, &next, sizeof(next)) == sizeof(next);
+        prefs.end();
+
+        if (!written)
+            return;
+        g_cache = next;
+        g_cacheValid = true;
+        Serial.printf("[wifi] cached %02X:%02X:%02X:%02X:%02X:%02X ch=%u\n",
+                      bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5],
+                      static_cast<unsigned>(channel));
+    }
+
+    void startAttempt(uint32_t nowMs)
+    {
+        g_attemptUsedCache = g_cacheValid;
+        if (g_attemptUsedCache)
+            WiFi.begin(g_ssid, g_pass, g_cache.channel, g_cache.bssid);
+        else
+            WiFi.begin(g_ssid, g_pass);
+
+        g_attempts.inc();
+        g_attemptStartMs = nowMs;
+        g_state = LinkState::Connecting;
+    }
+
+    void scheduleRetry(uint32_t nowMs)
+    {
+        // A cached AP that cannot be joined may have moved channel or been
+        // replaced; scan from now on until a join succeeds.
+        if (g_attemptUsedCache)
+            g_cacheValid = false;
+
+        const uint8_t shift = g_failures < 16 ? g_failures : 16;
+        uint32_t delayMs = AppConfig::WIFI_BACKOFF_MIN_MS << shift;
+        if (delayMs > AppConfig::WIFI_BACKOFF_MAX_MS || delayMs < AppConfig::WIFI_BACKOFF_MIN_MS)
+            delayMs = AppConfig::WIFI_BACKOFF_MAX_MS;
+        // Up to +25 % so a room full of robots does not retry in lockstep.
+        delayMs += esp_random() % (delayMs / 4 + 1);
+
+        if (g_failures < UINT8_MAX)
+            ++g_failures;
+        g_nextAttemptMs = nowMs + delayMs;
+        g_state = LinkState::Backoff;
+    }
+
+    void applyEvent(const SdkEvent &event, uint32_t nowMs)
+    {
+        if (event.gotIp)
+        {
+            if (g_state == LinkState::Connected)
+                return;
+
+            const uint32_t tookMs = nowMs - g_attemptStartMs;
+            g_state = LinkState::Connected;
+            g_failures = 0;
+            g_connects.inc();
+            g_connectTime.observe(static_cast<float>(tookMs));
+            Serial.printf("[wifi] connected ip=%s rssi=%d in %lu ms%s\n",
+                          WiFi.localIP().toString().c_str(),
+                          static_cast<int>(WiFi.RSSI()),
+                          static_cast<unsigned long>(tookMs),
+                          g_attemptUsedCache ? " (cached AP)" : "");
+
+            storeCache();
+            if (g_handlers.onConnected)
+                g_handlers.onConnected();
+            return;
+        }
+
+        if (g_state == LinkState::Connected)
+        {
+            g_disconnects.inc();
+            Serial.printf("[wifi] disconnected reason=%u\n", static_cast<unsigned>(event.reason));
+            // The first retry after losing a working link goes out right away.
+            g_failures = 0;
+            g_nextAttemptMs = nowMs;
+            g_state = LinkState::Backoff;
+            if (g_handlers.onDisconnected)
+                g_handlers.onDisconnected(event.reason);
+            return;
+        }
+
+        if (g_state == LinkState::Connecting)
+        {
+            Serial.printf("[wifi] join failed reason=%u\n", static_cast<unsigned>(event.reason));
+            scheduleRetry(nowMs);
+        }
+    }
+}
 
 namespace WifiManager
 {
-    bool begin(const char *ssid, const char *pass, uint32_t timeout_ms)
+    void begin(const char *ssid, const char *pass)
     {
+        g_ssid = ssid;
+        g_pass = pass;
+
+        // Reconnects are ours; the SDK must neither retry on its own nor
+        // rewrite its flash config on every begin().
+        WiFi.persistent(false);
         WiFi.mode(WIFI_STA);
         WiFi.setSleep(false);
+        WiFi.setAutoReconnect(false);
+        WiFi.onEvent(onSdkEvent);
+
+        loadCache();
+        startAttempt(millis());
+        Serial.printf("[wifi] joining %s%s\n", ssid, g_attemptUsedCache ? " (cached AP)" : "");
+    }
 
-        WiFi.begin(ssid, pass);
+    void setHandlers(const Handlers &handlers)
+    {
+        g_handlers = handlers;
+    }
 
-        const uint32_t start = millis();
-        while (WiFi.status() != WL_CONNECTED)
+    void loop(uint32_t nowMs)
+    {
+        SdkEvent event;
+        while (g_events.pop(event))
+            applyEvent(event, nowMs);
+
+        switch (g_state)
         {
-            if (millis() - start > timeout_ms)
-                return false;
-            delay(50);
+        case LinkState::Connecting:
+            if (nowMs - g_attemptStartMs >= AppConfig::WIFI_CONNECT_TIMEOUT_MS)
+            {
+                Serial.println("[wifi] join timed out");
+                WiFi.disconnect();
+                scheduleRetry(nowMs);
+            }
+            break;
+
+        case LinkState::Backoff:
+            if (static_cast<int32_t>(nowMs - g_nextAttemptMs) >= 0)
+                startAttempt(nowMs);
+            break;
+
+        default:
+            break;
         }
-        return true;
     }
 
     bool isConnected()
     {
-        return WiFi.status() == WL_CONNECTED;
+        return g_connected.load(std::memory_order_acquire);
     }
 
     String ip()
@@ -32,4 +287,9 @@ namespace WifiManager
         return WiFi.localIP().toString();
     }
 
+    int8_t rssi()
+    {
+        return isConnected() ? WiFi.RSSI() : 0;
+    }
+
 }
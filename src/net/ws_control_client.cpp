@@ -1,21 +1,62 @@
 #include "net/ws_control_client.h"
 
 #include "net/backend_config.h"
+#include "net/fault_injection.h"
+#include "net/json_pool.h"
+#include "net/metrics.h"
+#include "net/spsc_queue.h"
+#include "net/wifi_manager.h"
 #include "app_config.h"
 #include <Arduino.h>
 #include <ArduinoJson.h>
-#include <WiFi.h>
 #include <WebSocketsClient.h>
+#include <atomic>
 
 namespace
 {
+    using ControlCommands::Command;
+    using ControlCommands::CommandType;
+
+    struct TxFrame
+    {
+        uint16_t length;
+        char data[AppConfig::WS_JSON_OUT_BYTES];
+    };
+
     WebSocketsClient g_ws;
     WsControlClient::Handlers g_handlers{};
-    bool g_connected = false;
+    std::atomic<bool> g_connected{false};
+    std::atomic<bool> g_disconnectRequested{false};
+    // A STOP that found the rx ring full; loop() applies it after the ring.
+    std::atomic<bool> g_stopLatched{false};
+    TaskHandle_t g_wsTask = nullptr;
+
+    // ws-control task -> control task, and back. Each ring has exactly one
+    // producer and one consumer, so neither side ever blocks the other.
+    SpscQueue<Command, 16> g_rxQueue;
+    SpscQueue<TxFrame, 8> g_txQueue;
+
+    // Rx documents are parsed on the ws-control task; tx documents are
+    // serialized by the caller of sendJson on the control task.
+    StaticJsonPool<AppConfig::WS_JSON_POOL_BYTES> g_rxJsonPool;
+    StaticJsonPool<256> g_ackJsonPool;
+    char g_txJsonOut[AppConfig::WS_JSON_OUT_BYTES];
+    TxFrame g_txFrame;
+
+    ControlCommands::Coalescer g_coalescer;
+
+    Metrics::Counter g_connects("robot_backend_ws_connects_total", "Backend WebSocket sessions established");
+    Metrics::Counter g_disconnects("robot_backend_ws_disconnects_total", "Backend WebSocket sessions lost");
+    Metrics::Counter g_reconnectAttempts("robot_backend_ws_reconnect_attempts_total", "Backend WebSocket connection attempts after the first");
 
     uint32_t g_lastReconnectMs = 0;
     constexpr uint32_t RECONNECT_INTERVAL_MS = 3000;
 
+    // WiFi/lwIP live on core 0; the Arduino loop (motor control) stays on core 1.
+    constexpr BaseType_t WS_TASK_CORE = 0;
+    constexpr uint32_t WS_TASK_STACK = 8192; // TLS handshake runs on this stack
+    constexpr uint32_t WS_TASK_IDLE_MS = 2;
+
     void beginWsConnection()
     {
         if (BackendConfig::USE_TLS)
@@ -30,92 +71,32 @@ namespace
         g_ws.begin(BackendConfig::HOST, BackendConfig::PORT, BackendConfig::WS_PATH);
     }
 
-    void handleJsonMessage(const char *payload, size_t len)
+    void enqueue(const Command &cmd)
     {
-        JsonDocument doc;
-        DeserializationError err = deserializeJson(doc, payload, len);
-        if (err)
-        {
-            Serial.printf("[ws] json parse error: %s\n", err.c_str());
-            return;
-        }
-
-        const char *cmd = doc["command"] | "";
-        if (!cmd || cmd[0] == '\0')
-        {
-            Serial.println("[ws] missing 'command'");
+        if (g_rxQueue.push(cmd))
             return;
-        }
 
-        if (strcmp(cmd, "NAVIGATE") == 0)
+        if (cmd.type == CommandType::Stop)
         {
-            const String start = String((const char *)(doc["start"] | ""));
-            const String dest = String((const char *)(doc["destination"] | ""));
-
-            if (g_handlers.onNavigate)
-                g_handlers.onNavigate(start, dest);
-            return;
-        }
-
-        if (strcmp(cmd, "DRIVE_COMMAND") == 0)
-        {
-            const float linear = doc["linear_velocity"] | 0.0f;
-            const float angular = doc["angular_velocity"] | 0.0f;
-
-            if (g_handlers.onDriveCommand)
-                g_handlers.onDriveCommand(linear, angular);
-            return;
-        }
-        if (strcmp(cmd, "LED") == 0)
-        {
-            const bool enabled = doc["enabled"] | false;
-            const uint8_t r = static_cast<uint8_t>(doc["r"] | 0);
-            const uint8_t g = static_cast<uint8_t>(doc["g"] | 0);
-            const uint8_t b = static_cast<uint8_t>(doc["b"] | 0);
-            const uint8_t brightness = static_cast<uint8_t>(doc["brightness"] | 0);
-
-            if (g_handlers.onLed)
-                g_handlers.onLed(enabled, r, g, b, brightness);
-            return;
-        }
-
-        if (strcmp(cmd, "AUDIO_BEEP") == 0)
-        {
-            const uint32_t hz = doc["hz"] | 0;
-            const uint32_t ms = doc["ms"] | 0;
-
-            if (g_handlers.onAudioBeep)
-                g_handlers.onAudioBeep(hz, ms);
-            return;
-        }
-
-        if (strcmp(cmd, "AUDIO_VOLUME") == 0)
-        {
-            const float value = doc["value"] | 0.0f;
-
-            if (g_handlers.onAudioVolume)
-                g_handlers.onAudioVolume(value);
-            return;
-        }
-
-        if (strcmp(cmd, "STOP") == 0)
-        {
-            if (g_handlers.onStop)
-                g_handlers.onStop();
+            g_stopLatched.store(true, std::memory_order_release);
             return;
         }
+        Serial.printf("[ws] rx queue full, dropped command %u\n", static_cast<unsigned>(cmd.type));
+    }
 
-        if (strcmp(cmd, "SET_MODE") == 0)
-        {
-            const String mode = String((const char *)(doc["mode"] | ""));
-            if (g_handlers.onSetMode)
-                g_handlers.onSetMode(mode);
-            return;
-        }
+    void enqueueSimple(CommandType type)
+    {
+        Command cmd{};
+        cmd.type = type;
+        enqueue(cmd);
+    }
 
-        Serial.printf("[ws] unknown command: %s\n", cmd);
-        if (g_handlers.onUnknownCommand)
-            g_handlers.onUnknownCommand(String(cmd), doc);
+    void handleJsonMessage(const char *payload, size_t len, uint32_t rxUs)
+    {
+        JsonDocument doc(&g_rxJsonPool);
+        Command out{};
+        if (ControlCommands::decode(doc, payload, len, rxUs, ControlCommands::Source::Backend, out))
+            enqueue(out);
     }
 
     void wsEvent(WStype_t type, uint8_t *payload, size_t length)
@@ -124,24 +105,39 @@ namespace
         {
         case WStype_CONNECTED:
             g_connected = true;
+            g_connects.inc();
             Serial.println("[ws] connected");
-            if (g_handlers.onConnected)
-                g_handlers.onConnected();
+            g_ws.sendTXT(ControlCommands::HELLO_JSON);
+            enqueueSimple(CommandType::Connected);
             break;
 
         case WStype_DISCONNECTED:
-            g_connected = false;
-            Serial.println("[ws] disconnected");
-            if (g_handlers.onDisconnected)
-                g_handlers.onDisconnected();
+            // The library reports every failed reconnect attempt; only the
+            // transition is interesting to the control task.
+            if (g_connected.exchange(false))
+            {
+                g_disconnects.inc();
+                Serial.println("[ws] disconnected");
+                enqueueSimple(CommandType::Disconnected);
+            }
             break;
 
         case WStype_TEXT:
-            if (payload && length > 0)
+            if (payload && length > 0 && !FaultInjection::rollDrop())
             {
+                const uint32_t rxUs = micros();
                 if (AppConfig::WS_LOG_RX)
                     Serial.printf("[ws] rx: %.*s\n", (int)length, (const char *)payload);
-                handleJsonMessage((const char *)payload, length);
+                handleJsonMessage((const char *)payload, length, rxUs);
+            }
+            break;
+
+        case WStype_BIN:
+            if (payload && length > 0 && !FaultInjection::rollDrop())
+            {
+                Command out{};
+                if (ControlCommands::decodeBinary(payload, length, micros(), ControlCommands::Source::Backend, out))
+                    enqueue(out);
             }
             break;
 
@@ -153,6 +149,85 @@ namespace
             break;
         }
     }
+
+    void flushTx()
+    {
+        TxFrame frame;
+        while (g_txQueue.pop(frame))
+        {
+            if (g_connected)
+                g_ws.sendTXT(frame.data, frame.length);
+        }
+    }
+
+    // Under fault injection the socket is serviced late (delay), not at all
+    // (half-open: nothing read, queued frames never leave), and reconnects
+    // can fail their handshake.
+    bool serviceSocket()
+    {
+        if (!FaultInjection::active())
+            return true;
+
+        const FaultInjection::Profile p = FaultInjection::profile();
+        if (p.halfOpen)
+            return false;
+        if (p.delayMs)
+            vTaskDelay(pdMS_TO_TICKS(p.delayMs));
+        return true;
+    }
+
+    void wsTask(void *)
+    {
+        for (;;)
+        {
+            if (g_disconnectRequested.exchange(false))
+            {
+                g_ws.disconnect();
+                g_connected = false;
+            }
+
+            if (serviceSocket())
+            {
+                g_ws.loop();
+                flushTx();
+            }
+
+            const uint32_t nowMs = millis();
+            if (WifiManager::isConnected() && !g_connected && (nowMs - g_lastReconnectMs) >= RECONNECT_INTERVAL_MS)
+            {
+                g_lastReconnectMs = nowMs;
+                g_reconnectAttempts.inc();
+                g_ws.disconnect();
+                if (!(BackendConfig::USE_TLS && FaultInjection::rollTlsFailure()))
+                    beginWsConnection();
+            }
+
+            vTaskDelay(pdMS_TO_TICKS(WS_TASK_IDLE_MS));
+        }
+    }
+
+    bool enqueueTx(const char *data, size_t len)
+    {
+        if (!g_connected)
+            return false;
+
+        if (len == 0 || len >= sizeof(g_txFrame.data))
+        {
+            Serial.printf("[ws] tx skipped: message exceeds %u bytes\n", static_cast<unsigned>(sizeof(g_txFrame.data) - 1));
+            return false;
+        }
+
+        g_txFrame.length = static_cast<uint16_t>(len);
+        memcpy(g_txFrame.data, data, len);
+        g_txFrame.data[len] = '\0';
+
+        if (!g_txQueue.push(g_txFrame))
+        {
+            Serial.println("[ws] tx queue full, frame dropped");
+            return false;
+        }
+        return true;
+    }
 }
 
 namespace WsControlClient
@@ -165,22 +240,28 @@ namespace WsControlClient
         g_ws.onEvent(wsEvent);
         g_ws.setReconnectInterval(RECONNECT_INTERVAL_MS);
         g_ws.enableHeartbeat(15000, 3000, 2);
+
+        if (!g_wsTask)
+        {
+            xTaskCreatePinnedToCore(wsTask, "ws-control", WS_TASK_STACK, nullptr, 2, &g_wsTask, WS_TASK_CORE);
+            Metrics::trackTask(g_wsTask);
+        }
     }
 
     void loop()
     {
-        g_ws.loop();
-
-        if (WiFi.status() != WL_CONNECTED)
-            return;
+        Command cmd;
+        while (g_rxQueue.pop(cmd))
+            g_coalescer.accept(cmd, g_handlers);
 
-        const uint32_t nowMs = millis();
-        if (!g_connected && (nowMs - g_lastReconnectMs) >= RECONNECT_INTERVAL_MS)
+        // Last, so it also overrides any drive queued behind it.
+        if (g_stopLatched.exchange(false, std::memory_order_acquire))
         {
-            g_lastReconnectMs = nowMs;
-            g_ws.disconnect();
-            beginWsConnection();
+            Command stop{};
+            stop.type = CommandType::Stop;
+            g_coalescer.accept(stop, g_handlers);
         }
+        g_coalescer.flush(g_handlers);
     }
 
     bool isConnected()
@@ -193,24 +274,43 @@ namespace WsControlClient
         if (!g_connected)
             return false;
 
-        String out;
-        serializeJson(doc, out);
-        g_ws.sendTXT(out.c_str());
-        return true;
+        const size_t len = serializeJson(doc, g_txJsonOut, sizeof(g_txJsonOut));
+        if (len == 0 || len >= sizeof(g_txJsonOut) - 1)
+        {
+            Serial.printf("[ws] tx skipped: message exceeds %u bytes\n", static_cast<unsigned>(sizeof(g_txJsonOut)));
+            return false;
+        }
+
+        return enqueueTx(g_txJsonOut, len);
     }
 
     bool sendText(const String &text)
+    {
+        return enqueueTx(text.c_str(), text.length());
+    }
+
+    bool sendDriveAck(const DriveAck &ack)
     {
         if (!g_connected)
             return false;
 
-        g_ws.sendTXT(text.c_str());
-        return true;
+        JsonDocument doc(&g_ackJsonPool);
+        ControlCommands::writeDriveAck(ack, doc.to<JsonObject>());
+        return sendJson(doc);
     }
 
     void disconnect()
     {
-        g_ws.disconnect();
-        g_connected = false;
+        g_disconnectRequested = true;
+    }
+
+    JsonPool::Stats jsonPoolStats()
+    {
+        return g_rxJsonPool.stats();
+    }
+
+    DriveStats driveStats()
+    {
+        return g_coalescer.stats();
     }
 }
@@ -0,0 +1,825 @@
+// Host-side stand-in for the TeleTable backend, for integration, load and
+// soak runs without the real server. It speaks plain HTTP and WS (no TLS):
+// point BackendConfig::HOST at the machine running it, PORT at --port and
+// set USE_TLS = false.
+//
+//   g++ -std=gnu++11 -O2 -pthread -o backend_standin tools/backend_standin/backend_standin.cpp
+//   ./backend_standin --port 8000 --latency-ms 80 --jitter-ms 40 --error-pct 5 --drive-hz 20
+//
+// Serves POST /table/register, /table/state, /table/event, GET /health and
+// the /ws/robot/control socket. Faults are scripted from the command line
+// (see usage()); every second one summary line is printed, and a final one
+// when --duration ends the run, so runs with the same flags and --seed can
+// be compared.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace
+{
+    const char WS_PATH[] = "/ws/robot/control";
+    const char WS_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    constexpr size_t MAX_HEADER_BYTES = 8192;
+    constexpr size_t MAX_BODY_BYTES = 64 * 1024;
+
+    struct Options
+    {
+        uint16_t port = 8000;
+        const char *apiKey = nullptr; // X-Api-Key to require, any if unset
+        uint32_t latencyMs = 0;       // added before every HTTP reply
+        uint32_t jitterMs = 0;        // uniform 0..jitter on top
+        uint32_t lossPct = 0;         // request read, connection closed unanswered
+        uint32_t errorPct = 0;        // 503 instead of 200
+        uint32_t outageEverySec = 0;  // start of each outage window
+        uint32_t outageForSec = 0;    // 503 for HTTP, refused WS upgrades, live sessions closed
+        uint32_t wsDropEverySec = 0;  // close every WS session after this long
+        uint32_t driveHz = 0;         // DRIVE_COMMAND frames pushed to each robot
+        bool binaryDrive = false;     // binary frames once the robot's HELLO offers them
+        uint32_t durationSec = 0;     // 0 = run until interrupted
+        uint32_t seed = 1;
+        bool verbose = false;
+    };
+
+    struct Counters
+    {
+        std::atomic<uint32_t> registers{0};
+        std::atomic<uint32_t> states{0};
+        std::atomic<uint32_t> events{0};
+        std::atomic<uint32_t> health{0};
+        std::atomic<uint32_t> injectedErrors{0};
+        std::atomic<uint32_t> injectedLosses{0};
+        std::atomic<uint32_t> rejected{0}; // auth, unknown path, bad request
+        std::atomic<uint32_t> wsSessions{0};
+        std::atomic<uint32_t> wsOpen{0};
+        std::atomic<uint32_t> wsDrops{0};
+        std::atomic<uint32_t> driveSent{0};
+        std::atomic<uint32_t> framesReceived{0};
+        std::atomic<uint32_t> acks{0};
+        std::atomic<uint64_t> ackRttSumMs{0};
+    };
+
+    Options g_options;
+    Counters g_counters;
+    std::chrono::steady_clock::time_point g_startTime;
+
+    std::mutex g_rngMutex;
+    std::mt19937 g_rng;
+    std::mutex g_logMutex;
+
+    uint32_t nowMs()
+    {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - g_startTime).count());
+    }
+
+    // 0..n-1
+    uint32_t roll(uint32_t n)
+    {
+        if (n == 0)
+            return 0;
+        std::lock_guard<std::mutex> lock(g_rngMutex);
+        return std::uniform_int_distribution<uint32_t>(0, n - 1)(g_rng);
+    }
+
+    bool chance(uint32_t pct)
+    {
+        return pct > 0 && roll(100) < pct;
+    }
+
+    bool inOutage()
+    {
+        if (g_options.outageEverySec == 0 || g_options.outageForSec == 0)
+            return false;
+        const uint32_t sec = nowMs() / 1000;
+        return sec >= g_options.outageEverySec && (sec % g_options.outageEverySec) < g_options.outageForSec;
+    }
+
+    void log(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+    void log(const char *fmt, ...)
+    {
+        std::lock_guard<std::mutex> lock(g_logMutex);
+        std::printf("%7.3f ", static_cast<double>(nowMs()) / 1000.0);
+        va_list args;
+        va_start(args, fmt);
+        std::vprintf(fmt, args);
+        va_end(args);
+        std::fflush(stdout);
+    }
+
+    void sleepMs(uint32_t ms)
+    {
+        if (ms)
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+
+    // ---- SHA-1 and base64, only for Sec-WebSocket-Accept ----
+
+    uint32_t rol(uint32_t v, int n)
+    {
+        return (v << n) | (v >> (32 - n));
+    }
+
+    void sha1(const std::string &msg, uint8_t out[20])
+    {
+        uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+        std::string data = msg;
+        const uint64_t bits = static_cast<uint64_t>(msg.size()) * 8;
+        data.push_back(static_cast<char>(0x80));
+        while (data.size() % 64 != 56)
+            data.push_back('\0');
+        for (int i = 7; i >= 0; --i)
+            data.push_back(static_cast<char>((bits >> (i * 8)) & 0xFF));
+
+        for (size_t chunk = 0; chunk < data.size(); chunk += 64)
+        {
+            uint32_t w[80];
+            for (int i = 0; i < 16; ++i)
+            {
+                const uint8_t *p = reinterpret_cast<const uint8_t *>(data.data() + chunk + i * 4);
+                w[i] = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                       (static_cast<uint32_t>(p[2]) << 8) | p[3];
+            }
+            for (int i = 16; i < 80; ++i)
+                w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; ++i)
+            {
+                uint32_t f, k;
+                if (i < 20)
+                {
+                    f = (b & c) | (~b & d);
+                    k = 0x5A827999;
+                }
+                else if (i < 40)
+                {
+                    f = b ^ c ^ d;
+                    k = 0x6ED9EBA1;
+                }
+                else if (i < 60)
+                {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8F1BBCDC;
+                }
+                else
+                {
+                    f = b ^ c ^ d;
+                    k = 0xCA62C1D6;
+                }
+                const uint32_t t = rol(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = rol(b, 30);
+                b = a;
+                a = t;
+            }
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+        }
+
+        for (int i = 0; i < 5; ++i)
+        {
+            out[i * 4] = static_cast<uint8_t>(h[i] >> 24);
+            out[i * 4 + 1] = static_cast<uint8_t>(h[i] >> 16);
+            out[i * 4 + 2] = static_cast<uint8_t>(h[i] >> 8);
+            out[i * 4 + 3] = static_cast<uint8_t>(h[i]);
+        }
+    }
+
+    std::string base64(const uint8_t *data, size_t len)
+    {
+        static const char TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+        for (size_t i = 0; i < len; i += 3)
+        {
+            const uint32_t v = (static_cast<uint32_t>(data[i]) << 16) |
+                               (i + 1 < len ? static_cast<uint32_t>(data[i + 1]) << 8 : 0) |
+                               (i + 2 < len ? static_cast<uint32_t>(data[i + 2]) : 0);
+            out.push_back(TABLE[(v >> 18) & 0x3F]);
+            out.push_back(TABLE[(v >> 12) & 0x3F]);
+            out.push_back(i + 1 < len ? TABLE[(v >> 6) & 0x3F] : '=');
+            out.push_back(i + 2 < len ? TABLE[v & 0x3F] : '=');
+        }
+        return out;
+    }
+
+    // ---- sockets ----
+
+    bool sendAll(int fd, const void *data, size_t len)
+    {
+        const char *p = static_cast<const char *>(data);
+        while (len > 0)
+        {
+            const ssize_t n = ::send(fd, p, len, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+            p += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Appends whatever arrives within timeoutMs; false on EOF or error.
+    bool receiveSome(int fd, std::string &buf, int timeoutMs)
+    {
+        pollfd pfd{fd, POLLIN, 0};
+        const int ready = ::poll(&pfd, 1, timeoutMs);
+        if (ready < 0)
+            return false;
+        if (ready == 0)
+            return true;
+
+        char chunk[4096];
+        const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+            return false;
+        buf.append(chunk, static_cast<size_t>(n));
+        return true;
+    }
+
+    // ---- HTTP ----
+
+    struct Request
+    {
+        std::string method;
+        std::string path;
+        std::string apiKey;
+        std::string wsKey;
+        bool upgrade = false;
+        bool close = false;
+        size_t contentLength = 0;
+        std::string body;
+    };
+
+    std::string lower(std::string s)
+    {
+        for (char &c : s)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return s;
+    }
+
+    std::string trim(const std::string &s)
+    {
+        const size_t a = s.find_first_not_of(" \t");
+        const size_t b = s.find_last_not_of(" \t\r");
+        return a == std::string::npos ? std::string() : s.substr(a, b - a + 1);
+    }
+
+    // Reads one request from `buf` (refilled from fd as needed). False when
+    // the peer closed or sent something unusable.
+    bool readRequest(int fd, std::string &buf, Request &req)
+    {
+        size_t headerEnd;
+        while ((headerEnd = buf.find("\r\n\r\n")) == std::string::npos)
+        {
+            if (buf.size() > MAX_HEADER_BYTES)
+                return false;
+            if (!receiveSome(fd, buf, 30000))
+                return false;
+        }
+
+        const std::string head = buf.substr(0, headerEnd);
+        buf.erase(0, headerEnd + 4);
+
+        size_t lineEnd = head.find("\r\n");
+        const std::string requestLine = head.substr(0, lineEnd);
+        const size_t sp1 = requestLine.find(' ');
+        const size_t sp2 = requestLine.find(' ', sp1 + 1);
+        if (sp1 == std::string::npos || sp2 == std::string::npos)
+            return false;
+        req.method = requestLine.substr(0, sp1);
+        req.path = requestLine.substr(sp1 + 1, sp2 - sp1 - 1);
+
+        while (lineEnd != std::string::npos)
+        {
+            const size_t start = lineEnd + 2;
+            lineEnd = head.find("\r\n", start);
+            const std::string line = head.substr(start, lineEnd == std::string::npos ? std::string::npos : lineEnd - start);
+            const size_t colon = line.find(':');
+            if (colon == std::string::npos)
+                continue;
+
+            const std::string name = lower(trim(line.substr(0, colon)));
+            const std::string value = trim(line.substr(colon + 1));
+            if (name == "content-length")
+                req.contentLength = static_cast<size_t>(std::strtoul(value.c_str(), nullptr, 10));
+            else if (name == "x-api-key")
+                req.apiKey = value;
+            else if (name == "sec-websocket-key")
+                req.wsKey = value;
+            else if (name == "upgrade")
+                req.upgrade = lower(value) == "websocket";
+            else if (name == "connection")
+                req.close = lower(value).find("close") != std::string::npos;
+        }
+
+        if (req.contentLength > MAX_BODY_BYTES)
+            return false;
+        while (buf.size() < req.contentLength)
+        {
+            if (!receiveSome(fd, buf, 30000))
+                return false;
+        }
+        req.body = buf.substr(0, req.contentLength);
+        buf.erase(0, req.contentLength);
+        return true;
+    }
+
+    bool reply(int fd, int code, const char *reason, const std::string &body, bool close)
+    {
+        char head[256];
+        const int len = std::snprintf(head, sizeof(head),
+                                      "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+                                      code, reason, body.size(), close ? "close" : "keep-alive");
+        return sendAll(fd, head, static_cast<size_t>(len)) && sendAll(fd, body.data(), body.size());
+    }
+
+    // ---- WebSocket ----
+
+    enum Opcode : uint8_t
+    {
+        OP_TEXT = 0x1,
+        OP_BINARY = 0x2,
+        OP_CLOSE = 0x8,
+        OP_PING = 0x9,
+        OP_PONG = 0xA,
+    };
+
+    bool sendFrame(int fd, uint8_t opcode, const void *data, size_t len)
+    {
+        uint8_t head[10];
+        size_t headLen = 2;
+        head[0] = static_cast<uint8_t>(0x80 | opcode);
+        if (len < 126)
+        {
+            head[1] = static_cast<uint8_t>(len);
+        }
+        else if (len <= 0xFFFF)
+        {
+            head[1] = 126;
+            head[2] = static_cast<uint8_t>(len >> 8);
+            head[3] = static_cast<uint8_t>(len);
+            headLen = 4;
+        }
+        else
+        {
+            head[1] = 127;
+            for (int i = 0; i < 8; ++i)
+                head[2 + i] = static_cast<uint8_t>(static_cast<uint64_t>(len) >> (56 - i * 8));
+            headLen = 10;
+        }
+        return sendAll(fd, head, headLen) && (len == 0 || sendAll(fd, data, len));
+    }
+
+    // Takes one complete frame off the front of `buf`; false if it is not
+    // all there yet. Client frames are always masked.
+    bool takeFrame(std::string &buf, uint8_t &opcode, std::string &payload)
+    {
+        if (buf.size() < 2)
+            return false;
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(buf.data());
+        opcode = p[0] & 0x0F;
+        const bool masked = (p[1] & 0x80) != 0;
+        uint64_t len = p[1] & 0x7F;
+        size_t pos = 2;
+
+        if (len == 126)
+        {
+            if (buf.size() < 4)
+                return false;
+            len = (static_cast<uint64_t>(p[2]) << 8) | p[3];
+            pos = 4;
+        }
+        else if (len == 127)
+        {
+            if (buf.size() < 10)
+                return false;
+            len = 0;
+            for (int i = 0; i < 8; ++i)
+                len = (len << 8) | p[2 + i];
+            pos = 10;
+        }
+
+        const size_t maskPos = pos;
+        if (masked)
+            pos += 4;
+        if (buf.size() < pos + len)
+            return false;
+
+        payload.assign(buf, pos, static_cast<size_t>(len));
+        if (masked)
+        {
+            for (size_t i = 0; i < payload.size(); ++i)
+                payload[i] = static_cast<char>(payload[i] ^ p[maskPos + (i % 4)]);
+        }
+        buf.erase(0, pos + static_cast<size_t>(len));
+        return true;
+    }
+
+    // Pulls an unsigned number out of a flat JSON object; good enough for
+    // the robot's own frames.
+    bool jsonNumber(const std::string &json, const char *key, uint32_t &out)
+    {
+        const std::string needle = std::string("\"") + key + "\":";
+        const size_t at = json.find(needle);
+        if (at == std::string::npos)
+            return false;
+        out = static_cast<uint32_t>(std::strtoul(json.c_str() + at + needle.size(), nullptr, 10));
+        return true;
+    }
+
+    int16_t axis(float v)
+    {
+        return static_cast<int16_t>(v * 32767.0f);
+    }
+
+    bool sendDrive(int fd, bool binary, uint32_t seq, float linear, float angular)
+    {
+        const uint32_t ts = nowMs();
+        if (binary)
+        {
+            // Layout: ControlCommands BINARY_OP_DRIVE frame.
+            uint8_t frame[14];
+            const int16_t lin = axis(linear);
+            const int16_t ang = axis(angular);
+            frame[0] = 0x01;
+            frame[1] = 0x03;
+            frame[2] = static_cast<uint8_t>(lin);
+            frame[3] = static_cast<uint8_t>(lin >> 8);
+            frame[4] = static_cast<uint8_t>(ang);
+            frame[5] = static_cast<uint8_t>(ang >> 8);
+            for (int i = 0; i < 4; ++i)
+            {
+                frame[6 + i] = static_cast<uint8_t>(seq >> (i * 8));
+                frame[10 + i] = static_cast<uint8_t>(ts >> (i * 8));
+            }
+            return sendFrame(fd, OP_BINARY, frame, sizeof(frame));
+        }
+
+        char text[192];
+        const int len = std::snprintf(text, sizeof(text),
+                                      "{\"command\":\"DRIVE_COMMAND\",\"linear_velocity\":%.3f,\"angular_velocity\":%.3f,\"seq\":%u,\"ts\":%u}",
+                                      static_cast<double>(linear), static_cast<double>(angular), seq, ts);
+        return sendFrame(fd, OP_TEXT, text, static_cast<size_t>(len));
+    }
+
+    void handleRobotFrame(uint8_t opcode, const std::string &payload, bool &peerOffersBinary)
+    {
+        g_counters.framesReceived++;
+        if (opcode != OP_TEXT)
+            return;
+
+        if (payload.find("\"HELLO\"") != std::string::npos)
+        {
+            peerOffersBinary = payload.find("\"DRIVE_COMMAND\"") != std::string::npos;
+            log("[ws] robot hello: %s\n", payload.c_str());
+            return;
+        }
+
+        uint32_t ts = 0;
+        if (payload.find("\"DRIVE_ACK\"") != std::string::npos && jsonNumber(payload, "ts", ts))
+        {
+            g_counters.acks++;
+            g_counters.ackRttSumMs += nowMs() - ts;
+            return;
+        }
+
+        if (g_options.verbose)
+            log("[ws] rx: %s\n", payload.c_str());
+    }
+
+    void runWebSocket(int fd, std::string &buf, const Request &req)
+    {
+        uint8_t digest[20];
+        sha1(req.wsKey + WS_GUID, digest);
+        const std::string head = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: " +
+                                 base64(digest, sizeof(digest)) + "\r\n\r\n";
+        if (!sendAll(fd, head.data(), head.size()))
+            return;
+
+        g_counters.wsSessions++;
+        g_counters.wsOpen++;
+        log("[ws] robot connected\n");
+
+        const uint32_t openedMs = nowMs();
+        const uint32_t drivePeriodMs = g_options.driveHz ? 1000 / g_options.driveHz : 0;
+        uint32_t nextDriveMs = openedMs;
+        uint32_t seq = 0;
+        bool peerOffersBinary = false;
+        const char *why = "closed by robot";
+
+        for (;;)
+        {
+            const uint32_t now = nowMs();
+            if (g_options.wsDropEverySec && now - openedMs >= g_options.wsDropEverySec * 1000)
+            {
+                why = "scripted drop";
+                g_counters.wsDrops++;
+                break;
+            }
+            if (inOutage())
+            {
+                why = "outage";
+                g_counters.wsDrops++;
+                break;
+            }
+
+            if (drivePeriodMs && static_cast<int32_t>(now - nextDriveMs) >= 0)
+            {
+                // A slow sweep, so the motors would visibly follow on a bench.
+                const float phase = static_cast<float>(now % 4000) / 4000.0f;
+                const float linear = phase < 0.5f ? phase : 1.0f - phase;
+                if (!sendDrive(fd, g_options.binaryDrive && peerOffersBinary, ++seq, linear, 0.0f))
+                    break;
+                g_counters.driveSent++;
+                nextDriveMs += drivePeriodMs;
+                if (static_cast<int32_t>(now - nextDriveMs) > static_cast<int32_t>(drivePeriodMs))
+                    nextDriveMs = now + drivePeriodMs; // fell behind; do not burst
+            }
+
+            const int waitMs = drivePeriodMs ? static_cast<int>(drivePeriodMs / 2 + 1) : 100;
+            if (!receiveSome(fd, buf, waitMs))
+                break;
+
+            uint8_t opcode;
+            std::string payload;
+            bool closed = false;
+            while (takeFrame(buf, opcode, payload))
+            {
+                if (opcode == OP_PING)
+                {
+                    sendFrame(fd, OP_PONG, payload.data(), payload.size());
+                    continue;
+                }
+                if (opcode == OP_CLOSE)
+                {
+                    sendFrame(fd, OP_CLOSE, payload.data(), payload.size());
+                    closed = true;
+                    break;
+                }
+                if (opcode == OP_PONG)
+                    continue;
+                handleRobotFrame(opcode, payload, peerOffersBinary);
+            }
+            if (closed)
+                break;
+        }
+
+        if (std::strcmp(why, "closed by robot") != 0)
+        {
+            const uint8_t goingAway[] = {0x03, 0xE9}; // 1001
+            sendFrame(fd, OP_CLOSE, goingAway, sizeof(goingAway));
+        }
+        g_counters.wsOpen--;
+        log("[ws] robot disconnected (%s) after %u ms\n", why, nowMs() - openedMs);
+    }
+
+    // ---- connection ----
+
+    void handleConnection(int fd)
+    {
+        std::string buf;
+        for (;;)
+        {
+            Request req;
+            if (!readRequest(fd, buf, req))
+                break;
+
+            if (req.upgrade)
+            {
+                if (req.path != WS_PATH || req.wsKey.empty() || inOutage())
+                {
+                    g_counters.rejected++;
+                    reply(fd, inOutage() ? 503 : 400, "Rejected", "{\"error\":\"upgrade refused\"}", true);
+                    break;
+                }
+                runWebSocket(fd, buf, req);
+                break;
+            }
+
+            sleepMs(g_options.latencyMs + roll(g_options.jitterMs + 1));
+
+            if (chance(g_options.lossPct))
+            {
+                g_counters.injectedLosses++;
+                break;
+            }
+
+            if (g_options.apiKey && req.apiKey != g_options.apiKey)
+            {
+                g_counters.rejected++;
+                if (!reply(fd, 401, "Unauthorized", "{\"error\":\"bad api key\"}", req.close))
+                    break;
+                continue;
+            }
+
+            if (inOutage() || chance(g_options.errorPct))
+            {
+                g_counters.injectedErrors++;
+                if (!reply(fd, 503, "Service Unavailable", "{\"error\":\"injected\"}", req.close))
+                    break;
+                continue;
+            }
+
+            int code = 200;
+            if (req.method == "GET" && req.path == "/health")
+            {
+                g_counters.health++;
+            }
+            else if (req.method == "POST" && req.path == "/table/register")
+            {
+                g_counters.registers++;
+                log("[http] register %s\n", req.body.c_str());
+            }
+            else if (req.method == "POST" && req.path == "/table/state")
+            {
+                g_counters.states++;
+                if (g_options.verbose)
+                    log("[http] state %s\n", req.body.c_str());
+            }
+            else if (req.method == "POST" && req.path == "/table/event")
+            {
+                g_counters.events++;
+                log("[http] event %s\n", req.body.c_str());
+            }
+            else
+            {
+                code = 404;
+                g_counters.rejected++;
+            }
+
+            const bool ok = code == 200;
+            if (!reply(fd, code, ok ? "OK" : "Not Found", ok ? "{\"ok\":true}" : "{\"error\":\"not found\"}", req.close) || req.close)
+                break;
+        }
+        ::close(fd);
+    }
+
+    void printSummary(const char *tag, uint32_t statesBefore)
+    {
+        const uint32_t acks = g_counters.acks.load();
+        log("[%s] register=%u state=%u (+%u/s) event=%u health=%u | 503=%u lost=%u rejected=%u | ws open=%u sessions=%u drops=%u drive=%u rx=%u acks=%u rtt=%.1fms\n",
+            tag,
+            g_counters.registers.load(),
+            g_counters.states.load(),
+            g_counters.states.load() - statesBefore,
+            g_counters.events.load(),
+            g_counters.health.load(),
+            g_counters.injectedErrors.load(),
+            g_counters.injectedLosses.load(),
+            g_counters.rejected.load(),
+            g_counters.wsOpen.load(),
+            g_counters.wsSessions.load(),
+            g_counters.wsDrops.load(),
+            g_counters.driveSent.load(),
+            g_counters.framesReceived.load(),
+            acks,
+            acks ? static_cast<double>(g_counters.ackRttSumMs.load()) / acks : 0.0);
+    }
+
+    void reporter()
+    {
+        uint32_t statesBefore = 0;
+        for (;;)
+        {
+            sleepMs(1000);
+            printSummary(inOutage() ? "stats*" : "stats", statesBefore);
+            statesBefore = g_counters.states.load();
+
+            if (g_options.durationSec && nowMs() >= g_options.durationSec * 1000)
+            {
+                printSummary("final", statesBefore);
+                std::exit(0);
+            }
+        }
+    }
+
+    void usage(const char *argv0)
+    {
+        std::printf("usage: %s [options]\n"
+                    "  --port N            listen port (8000)\n"
+                    "  --api-key KEY       require this X-Api-Key\n"
+                    "  --latency-ms N      delay before every HTTP reply\n"
+                    "  --jitter-ms N       extra uniform 0..N ms per reply\n"
+                    "  --loss-pct N        close N%% of requests unanswered\n"
+                    "  --error-pct N       answer N%% of requests with 503\n"
+                    "  --outage S:L        every S seconds, L seconds of 503s and WS refusals\n"
+                    "  --ws-drop-sec N     close each WS session after N seconds\n"
+                    "  --drive-hz N        push DRIVE_COMMAND at N Hz to each robot\n"
+                    "  --binary            send binary drive frames when the robot offers them\n"
+                    "  --duration N        exit after N seconds with a final summary\n"
+                    "  --seed N            fault RNG seed (1)\n"
+                    "  --verbose           log every state body and WS frame\n",
+                    argv0);
+    }
+
+    bool parseOptions(int argc, char **argv)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            auto number = [&]() -> uint32_t
+            { return static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); };
+
+            if (arg == "--binary")
+                g_options.binaryDrive = true;
+            else if (arg == "--verbose")
+                g_options.verbose = true;
+            else if (!hasValue)
+                return false;
+            else if (arg == "--port")
+                g_options.port = static_cast<uint16_t>(number());
+            else if (arg == "--api-key")
+                g_options.apiKey = argv[++i];
+            else if (arg == "--latency-ms")
+                g_options.latencyMs = number();
+            else if (arg == "--jitter-ms")
+                g_options.jitterMs = number();
+            else if (arg == "--loss-pct")
+                g_options.lossPct = number();
+            else if (arg == "--error-pct")
+                g_options.errorPct = number();
+            else if (arg == "--outage")
+            {
+                const char *spec = argv[++i];
+                if (std::sscanf(spec, "%u:%u", &g_options.outageEverySec, &g_options.outageForSec) != 2)
+                    return false;
+            }
+            else if (arg == "--ws-drop-sec")
+                g_options.wsDropEverySec = number();
+            else if (arg == "--drive-hz")
+                g_options.driveHz = number();
+            else if (arg == "--duration")
+                g_options.durationSec = number();
+            else if (arg == "--seed")
+                g_options.seed = number();
+            else
+                return false;
+        }
+        return g_options.driveHz <= 1000;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (!parseOptions(argc, argv))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    g_startTime = std::chrono::steady_clock::now();
+    g_rng.seed(g_options.seed);
+
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    const int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(g_options.port);
+    if (::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(listener, 16) != 0)
+    {
+        std::perror("listen");
+        return 1;
+    }
+
+    log("[standin] listening on :%u latency=%u+%ums loss=%u%% 503=%u%% outage=%u:%u ws-drop=%us drive=%uHz%s\n",
+        static_cast<unsigned>(g_options.port), g_options.latencyMs, g_options.jitterMs, g_options.lossPct,
+        g_options.errorPct, g_options.outageEverySec, g_options.outageForSec, g_options.wsDropEverySec,
+        g_options.driveHz, g_options.binaryDrive ? " (binary)" : "");
+
+    std::thread(reporter).detach();
+
+    for (;;)
+    {
+        const int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        std::thread(handleConnection, fd).detach();
+    }
+}
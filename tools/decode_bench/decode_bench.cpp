@@ -0,0 +1,116 @@
+// Host benchmark for WS command decoding (net/control_commands.h): a
+// DRIVE_COMMAND frame through an unfiltered parse (the cost before the
+// per-command filters), through decode() as clients send it and with
+// "command" moved last, and the same setpoint as a binary frame.
+//
+// ArduinoJson is header-only; point -I at the copy PlatformIO fetched for
+// the firmware (any 7.x works):
+//
+//   g++ -std=gnu++11 -O2 -Iinclude -Itools/host_shim -I.pio/libdeps/esp32dev/ArduinoJson/src -o decode_bench tools/decode_bench/decode_bench.cpp src/net/control_commands.cpp src/net/state_schema.cpp src/net/json_pool.cpp src/net/metrics.cpp src/net/telemetry_stream.cpp tools/host_shim/host_stubs.cpp
+//   ./decode_bench [frames]
+//
+// Prints ns per frame and the pool peak per case. The host is far faster
+// than the ESP32: compare runs against each other, not against the budget.
+#include "net/control_commands.h"
+#include "net/json_pool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // A joystick frame as the web client sends it, extra members included.
+    const char DRIVE_FRAME[] =
+        "{\"command\":\"DRIVE_COMMAND\",\"linear_velocity\":0.42,\"angular_velocity\":-0.13,\"seq\":123456,\"ts\":987654321,"
+        "\"client\":\"web-joystick\",\"gamepad\":{\"id\":\"xbox\",\"deadzone\":0.08}}";
+
+    // Same frame with "command" last: cannot be sniffed, parses twice.
+    const char DRIVE_FRAME_REORDERED[] =
+        "{\"linear_velocity\":0.42,\"angular_velocity\":-0.13,\"seq\":123456,\"ts\":987654321,"
+        "\"client\":\"web-joystick\",\"gamepad\":{\"id\":\"xbox\",\"deadzone\":0.08},\"command\":\"DRIVE_COMMAND\"}";
+
+    // The same setpoint as a binary frame (see ControlCommands::decodeBinary).
+    const uint8_t DRIVE_BINARY[ControlCommands::BINARY_DRIVE_BYTES] = {
+        ControlCommands::BINARY_OP_DRIVE, 0x03,
+        0xC2, 0x35, // 13762 ~ 0.42
+        0x5C, 0xEF, // -4260 ~ -0.13
+        0x40, 0xE2, 0x01, 0x00,
+        0xB1, 0x68, 0xDE, 0x3A};
+
+    enum class Mode : uint8_t
+    {
+        Parse, // unfiltered deserializeJson only
+        Decode,
+        Binary
+    };
+
+    struct Case
+    {
+        const char *name;
+        const char *frame;
+        Mode mode;
+    };
+
+    const Case CASES[] = {
+        {"full parse", DRIVE_FRAME, Mode::Parse},
+        {"decode", DRIVE_FRAME, Mode::Decode},
+        {"decode, cmd last", DRIVE_FRAME_REORDERED, Mode::Decode},
+        {"binary", nullptr, Mode::Binary},
+    };
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t frames = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 200000U;
+
+    uint32_t totalFailures = 0;
+    for (const Case &c : CASES)
+    {
+        StaticJsonPool<1024> pool;
+        const size_t len = c.frame ? strlen(c.frame) : sizeof(DRIVE_BINARY);
+        uint32_t failures = 0;
+        ControlCommands::Command cmd{};
+
+        const Clock::time_point start = Clock::now();
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            if (c.mode == Mode::Binary)
+            {
+                if (!ControlCommands::decodeBinary(DRIVE_BINARY, len, 0, ControlCommands::Source::Lan, cmd))
+                    ++failures;
+                continue;
+            }
+
+            JsonDocument doc(&pool);
+            if (c.mode == Mode::Decode)
+            {
+                if (!ControlCommands::decode(doc, c.frame, len, 0, ControlCommands::Source::Lan, cmd))
+                    ++failures;
+            }
+            else if (deserializeJson(doc, c.frame, len))
+            {
+                ++failures;
+            }
+        }
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        if (c.mode != Mode::Parse && (cmd.type != ControlCommands::CommandType::Drive || cmd.drive.seq != 123456))
+            ++failures;
+
+        const JsonPool::Stats stats = pool.stats();
+        printf("%-16s %3u B %8.1f ns/frame pool peak %4u/%u heap_fallbacks=%lu failures=%lu\n",
+               c.name,
+               static_cast<unsigned>(len),
+               ns / frames,
+               static_cast<unsigned>(stats.highWater),
+               static_cast<unsigned>(stats.capacity),
+               static_cast<unsigned long>(stats.heapFallbacks),
+               static_cast<unsigned long>(failures));
+        totalFailures += failures;
+    }
+    return totalFailures ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+#pragma once
+// Host stand-in for the parts of Arduino.h (and the FreeRTOS/ESP calls that
+// come with it) that the firmware sources built by tools/ use. Only what
+// those sources call is here. The clock only moves when a tool sets it.
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace HostShim
+{
+    inline uint32_t &nowMs()
+    {
+        static uint32_t ms = 0;
+        return ms;
+    }
+
+    inline uint32_t &randomState()
+    {
+        static uint32_t state = 0x9e3779b9;
+        return state;
+    }
+}
+
+inline uint32_t millis()
+{
+    return HostShim::nowMs();
+}
+
+inline uint32_t micros()
+{
+    return HostShim::nowMs() * 1000U;
+}
+
+// xorshift32; the tools only need distinct values.
+inline uint32_t esp_random()
+{
+    uint32_t &x = HostShim::randomState();
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+struct HostSerial
+{
+    void printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        va_list args;
+        va_start(args, fmt);
+        std::vprintf(fmt, args);
+        va_end(args);
+    }
+
+    void print(const char *s)
+    {
+        std::fputs(s, stdout);
+    }
+
+    void println(const char *s = "")
+    {
+        std::puts(s);
+    }
+};
+
+static HostSerial Serial __attribute__((unused));
+
+struct IPAddress
+{
+    uint32_t addr = 0;
+};
+
+class String
+{
+public:
+    String(const char *s = "") : s_(s ? s : "") {}
+
+    const char *c_str() const
+    {
+        return s_.c_str();
+    }
+
+    unsigned int length() const
+    {
+        return static_cast<unsigned int>(s_.size());
+    }
+
+    bool operator==(const char *other) const
+    {
+        return s_ == other;
+    }
+
+private:
+    std::string s_;
+};
+
+typedef void *TaskHandle_t;
+
+inline const char *pcTaskGetName(TaskHandle_t)
+{
+    return "host";
+}
+
+inline unsigned uxTaskGetStackHighWaterMark(TaskHandle_t)
+{
+    return 0;
+}
+
+struct HostEsp
+{
+    uint32_t getFreeHeap() const
+    {
+        return 0;
+    }
+
+    uint32_t getMinFreeHeap() const
+    {
+        return 0;
+    }
+
+    uint32_t getMaxAllocHeap() const
+    {
+        return 0;
+    }
+};
+
+static HostEsp ESP __attribute__((unused));
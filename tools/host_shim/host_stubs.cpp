@@ -0,0 +1,12 @@
+// Link-time stand-ins for firmware modules the host tools don't build.
+// net/telemetry_stream.cpp comes in for TelemetryStream::channelFromName
+// (used by ControlCommands::decode) and references the WS server's send path.
+#include "net/robot_ws_server.h"
+
+namespace RobotWsServer
+{
+    bool sendBinary(uint8_t, const uint8_t *, size_t)
+    {
+        return false;
+    }
+}
@@ -0,0 +1,258 @@
+// Host check that the hot-path JSON messages build without touching the
+// heap (net/json_pool.h). Every malloc/calloc/realloc/free in the process is
+// counted while a message is built. Each case repeats the firmware's steps:
+// the same pool and output buffer sizes, StateSchema::writeJson,
+// ControlCommands::decode and ControlCommands::dispatch themselves.
+//
+//   backend state post   StateSchema::writeJson(Backend) -> BACKEND_JSON_OUT_BYTES
+//   backend event post   {"event","timestamp"}           -> BACKEND_JSON_OUT_BYTES
+//   HTTP /status body    StateSchema::writeJson(Status)  -> HTTP_JSON_OUT_BYTES
+//   WS handleJsonMessage ControlCommands::decode + dispatch, every command
+//
+// ArduinoJson is header-only; point -I at the copy PlatformIO fetched for
+// the firmware. The malloc hooks need glibc.
+//
+//   g++ -std=gnu++11 -O2 -Iinclude -Itools/host_shim -I.pio/libdeps/esp32dev/ArduinoJson/src -o json_alloc_test tools/json_alloc_test/json_alloc_test.cpp src/net/control_commands.cpp src/net/state_schema.cpp src/net/json_pool.cpp src/net/metrics.cpp src/net/telemetry_stream.cpp tools/host_shim/host_stubs.cpp
+//   ./json_alloc_test [messages]
+//
+// The first message of each case (one of each command for the WS case) is
+// a warm-up and is not counted: decode() parses its per-command filters
+// once, on first use. Every later message must allocate nothing, and no
+// pool may fall back to the heap. Exits non-zero otherwise.
+#include "app_config.h"
+#include "net/control_commands.h"
+#include "net/json_pool.h"
+#include "net/state_schema.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void __libc_free(void *ptr);
+}
+
+namespace
+{
+    bool g_counting = false;
+    unsigned long g_allocs = 0;
+    unsigned long g_frees = 0;
+}
+
+extern "C"
+{
+    void *malloc(size_t size)
+    {
+        if (g_counting)
+            ++g_allocs;
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        if (g_counting)
+            ++g_allocs;
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *ptr, size_t size)
+    {
+        if (g_counting)
+            ++g_allocs;
+        return __libc_realloc(ptr, size);
+    }
+
+    void free(void *ptr)
+    {
+        if (g_counting && ptr)
+            ++g_frees;
+        __libc_free(ptr);
+    }
+}
+
+namespace
+{
+    // The WS rx pool of WsControlClient; the backend worker's pool and
+    // output buffer; the HTTP server's pool and /status body.
+    StaticJsonPool<AppConfig::WS_JSON_POOL_BYTES> g_wsRxPool;
+    StaticJsonPool<AppConfig::BACKEND_JSON_POOL_BYTES> g_backendPool;
+    char g_backendOut[AppConfig::BACKEND_JSON_OUT_BYTES];
+    StaticJsonPool<AppConfig::HTTP_JSON_POOL_BYTES> g_httpPool;
+    char g_statusBody[AppConfig::HTTP_JSON_OUT_BYTES];
+
+    StateSchema::Snapshot g_snapshot;
+
+    // Every handler set, as the coordinator does; each only counts the call.
+    uint32_t g_dispatched = 0;
+    ControlCommands::Handlers g_handlers;
+
+    void setHandlers()
+    {
+        g_handlers.onConnected = []() { ++g_dispatched; };
+        g_handlers.onDisconnected = []() { ++g_dispatched; };
+        g_handlers.onNavigate = [](const char *, const char *) { ++g_dispatched; };
+        g_handlers.onDriveCommand = [](const ControlCommands::DriveCommand &) { ++g_dispatched; };
+        g_handlers.onLed = [](bool, uint8_t, uint8_t, uint8_t, uint8_t) { ++g_dispatched; };
+        g_handlers.onLedPattern = [](const ControlCommands::LedPatternCommand &) { ++g_dispatched; };
+        g_handlers.onAudioBeep = [](uint32_t, uint32_t, bool) { ++g_dispatched; };
+        g_handlers.onAudioVolume = [](float) { ++g_dispatched; };
+        g_handlers.onStop = []() { ++g_dispatched; };
+        g_handlers.onSetMode = [](const char *) { ++g_dispatched; };
+        g_handlers.onUnknownCommand = [](const char *) { ++g_dispatched; };
+    }
+
+    const char *const WS_FRAMES[] = {
+        "{\"command\":\"DRIVE_COMMAND\",\"linear_velocity\":0.42,\"angular_velocity\":-0.13,\"seq\":123456,\"ts\":987654321}",
+        "{\"command\":\"NAVIGATE\",\"start\":\"dock-a\",\"destination\":\"table-12\"}",
+        "{\"command\":\"LED\",\"enabled\":true,\"r\":255,\"g\":136,\"b\":0,\"brightness\":120}",
+        "{\"command\":\"LED_PATTERN\",\"pattern\":\"TURN\",\"select\":true,\"r\":0,\"g\":255,\"b\":0,\"width\":12,\"periodMs\":600}",
+        "{\"command\":\"AUDIO_BEEP\",\"hz\":880,\"ms\":120,\"mode\":\"queue\"}",
+        "{\"command\":\"AUDIO_VOLUME\",\"value\":0.4}",
+        "{\"command\":\"STOP\"}",
+        "{\"command\":\"UNSUBSCRIBE\"}",
+        "{\"command\":\"SET_MODE\",\"mode\":\"MANUAL\"}",
+        "{\"command\":\"SUBSCRIBE\",\"fields\":[\"batteryLevel\",\"position\",\"lux\"],\"periodMs\":200}",
+        "{\"command\":\"TELEMETRY\",\"channels\":{\"imu\":100,\"power\":10},\"batchMs\":50}",
+        "{\"command\":\"SOMETHING_NEW\",\"x\":1}",
+    };
+
+    void fillText(char *dest, size_t size, char c)
+    {
+        memset(dest, c, size - 1);
+        dest[size - 1] = '\0';
+    }
+
+    // Every field present, every text at capacity: the largest messages.
+    void fillSnapshot(StateSchema::Snapshot &s)
+    {
+        memset(&s, 0, sizeof(s));
+        fillText(s.systemHealth, sizeof(s.systemHealth), 'h');
+        s.batteryLevel = 87;
+        fillText(s.driveMode, sizeof(s.driveMode), 'd');
+        fillText(s.backendDriveMode, sizeof(s.backendDriveMode), 'b');
+        fillText(s.cargoStatus, sizeof(s.cargoStatus), 'c');
+        fillText(s.lastRouteStart, sizeof(s.lastRouteStart), 's');
+        fillText(s.lastRouteEnd, sizeof(s.lastRouteEnd), 'e');
+        fillText(s.position, sizeof(s.position), 'p');
+        fillText(s.currentNode, sizeof(s.currentNode), 'n');
+        fillText(s.targetNode, sizeof(s.targetNode), 't');
+        fillText(s.navigationStatus, sizeof(s.navigationStatus), 'v');
+        s.irLeft = true;
+        s.irMid = false;
+        s.irRight = true;
+        s.luxValid = true;
+        s.lux = 1234.5f;
+        s.powerValid = true;
+        s.batteryVoltage = 11.87f;
+        s.batteryCurrentA = -1.234f;
+        s.batteryPowerW = 14.65f;
+        s.gyroValid = true;
+        s.gyroXDps = -123.4f;
+        s.gyroYDps = 56.7f;
+        s.gyroZDps = 890.1f;
+        s.rfidValid = true;
+        fillText(s.lastReadUuid, sizeof(s.lastReadUuid), 'u');
+        s.ledEnabled = true;
+        s.ledAutoEnabled = false;
+        s.audioVolume = 0.35f;
+    }
+
+    bool serialized(const JsonDocument &doc, char *out, size_t outSize)
+    {
+        const size_t len = serializeJson(doc, out, outSize);
+        return !doc.overflowed() && len > 0 && len < outSize - 1;
+    }
+
+    bool backendState(uint32_t)
+    {
+        JsonDocument doc(&g_backendPool);
+        StateSchema::writeJson(g_snapshot, doc.to<JsonObject>(), StateSchema::Target::Backend);
+        return serialized(doc, g_backendOut, sizeof(g_backendOut));
+    }
+
+    bool backendEvent(uint32_t i)
+    {
+        static const char *const NAMES[] = {"OBSTACLE", "ROUTE_DONE", "LOW_BATTERY"};
+        JsonDocument doc(&g_backendPool);
+        doc["event"] = NAMES[i % 3];
+        doc["timestamp"] = i * 37U;
+        return serialized(doc, g_backendOut, sizeof(g_backendOut));
+    }
+
+    bool httpStatus(uint32_t)
+    {
+        JsonDocument doc(&g_httpPool);
+        StateSchema::writeJson(g_snapshot, doc.to<JsonObject>(), StateSchema::Target::Status);
+        return serialized(doc, g_statusBody, sizeof(g_statusBody));
+    }
+
+    bool wsMessage(uint32_t i)
+    {
+        const char *frame = WS_FRAMES[i % (sizeof(WS_FRAMES) / sizeof(WS_FRAMES[0]))];
+        JsonDocument doc(&g_wsRxPool);
+        ControlCommands::Command out{};
+        if (!ControlCommands::decode(doc, frame, strlen(frame), 0, ControlCommands::Source::Backend, out))
+            return false;
+
+        const uint32_t before = g_dispatched;
+        ControlCommands::dispatch(out, g_handlers);
+        return g_dispatched == before + 1;
+    }
+
+    struct Case
+    {
+        const char *name;
+        bool (*build)(uint32_t i);
+        const JsonPool *pool;
+        uint32_t warmup; // messages before counting starts
+    };
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t messages = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 1000U;
+    fillSnapshot(g_snapshot);
+    setHandlers();
+
+    const uint32_t wsFrames = static_cast<uint32_t>(sizeof(WS_FRAMES) / sizeof(WS_FRAMES[0]));
+    const Case cases[] = {
+        {"backend state post", backendState, &g_backendPool, 1},
+        {"backend event post", backendEvent, &g_backendPool, 1},
+        {"http status body", httpStatus, &g_httpPool, 1},
+        {"ws handleJsonMessage", wsMessage, &g_wsRxPool, wsFrames}, // one of each command
+    };
+
+    bool ok = true;
+    for (const Case &c : cases)
+    {
+        uint32_t failures = 0;
+        for (uint32_t i = 0; i < c.warmup; ++i)
+            failures += c.build(i) ? 0 : 1;
+
+        g_allocs = 0;
+        g_frees = 0;
+        g_counting = true;
+        for (uint32_t i = c.warmup; i < c.warmup + messages; ++i)
+            failures += c.build(i) ? 0 : 1;
+        g_counting = false;
+
+        const JsonPool::Stats pool = c.pool->stats();
+        const bool pass = g_allocs == 0 && g_frees == 0 && pool.heapFallbacks == 0 && failures == 0;
+        printf("%s %-20s %5lu msgs mallocs=%lu frees=%lu pool peak %4u/%u heap_fallbacks=%lu failures=%lu\n",
+               pass ? "ok  " : "FAIL",
+               c.name,
+               static_cast<unsigned long>(messages),
+               g_allocs,
+               g_frees,
+               static_cast<unsigned>(pool.highWater),
+               static_cast<unsigned>(pool.capacity),
+               static_cast<unsigned long>(pool.heapFallbacks),
+               static_cast<unsigned long>(failures));
+        ok = ok && pass;
+    }
+    return ok ? 0 : 1;
+}
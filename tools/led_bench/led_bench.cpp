@@ -0,0 +1,105 @@
+// Host benchmark for the LED render stage (app/led_renderer.h): canvas
+// edits plus the gamma/brightness/dither pass, per frame, at the strip's
+// 144 LEDs.
+//
+//   g++ -std=gnu++11 -O2 -Iinclude -o led_bench tools/led_bench/led_bench.cpp src/app/led_renderer.cpp
+//   ./led_bench [frames] [leds]
+//
+// Prints mean and worst frame cost and the share of a 100 Hz frame (10 ms)
+// it would take. The host is far faster than the ESP32, so read the result
+// as a regression check on the loop and scale it before comparing with the
+// budget; the first line reports the operations per frame that dominate
+// on the target. The last line checks that a static scene above the
+// dither range settles into identical frames (exit code 1 if not), which
+// is what lets the strip skip resending it.
+#include "app/led_renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    constexpr double FRAME_BUDGET_NS = 10e6; // 100 Hz
+
+    using Clock = std::chrono::steady_clock;
+
+    // Roughly what the status patterns draw: a moving segment over a dim
+    // bar, with brightness moving every few frames so the table is rebuilt.
+    void drawFrame(LedRenderer &r, uint16_t leds, uint32_t frame)
+    {
+        r.clear();
+        const uint16_t bar = static_cast<uint16_t>((frame * 3U) % leds);
+        for (uint16_t i = 0; i < bar; ++i)
+            r.setPixel(i, 0, 60, 12);
+        for (uint16_t i = 0; i < 24; ++i)
+            r.setPixel(static_cast<uint16_t>((frame + i) % leds), 255, 110, 0);
+        if (frame % 8 == 0)
+            r.setBrightness(static_cast<uint8_t>(frame / 8));
+    }
+
+    // A solid status color at the default brightness, rendered for a while:
+    // true if the last frames stayed identical.
+    bool staticSceneSettles(uint16_t leds)
+    {
+        LedRenderer r(leds);
+        r.setBrightness(128);
+        r.fill(255, 136, 0);
+
+        std::vector<uint8_t> previous(static_cast<size_t>(leds) * 3);
+        std::vector<uint8_t> current(previous.size());
+        r.render(previous.data());
+        uint32_t changed = 0;
+        for (uint32_t f = 0; f < 256; ++f)
+        {
+            r.render(current.data());
+            if (memcmp(previous.data(), current.data(), current.size()) != 0)
+                ++changed;
+            previous.swap(current);
+        }
+        return changed == 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t frames = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 200000U;
+    const uint16_t leds = argc > 2 ? static_cast<uint16_t>(strtoul(argv[2], nullptr, 10)) : 144U;
+
+    LedRenderer renderer(leds);
+    std::vector<uint8_t> wire(static_cast<size_t>(leds) * 3);
+    std::vector<double> costNs;
+    costNs.reserve(frames);
+
+    uint32_t checksum = 0;
+    for (uint32_t f = 0; f < frames; ++f)
+    {
+        const Clock::time_point start = Clock::now();
+        drawFrame(renderer, leds, f);
+        checksum += renderer.render(wire.data());
+        const Clock::time_point end = Clock::now();
+
+        costNs.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+
+    std::sort(costNs.begin(), costNs.end());
+    double sum = 0;
+    for (double ns : costNs)
+        sum += ns;
+    const double mean = sum / costNs.size();
+    const double p99 = costNs[static_cast<size_t>(costNs.size() * 0.99)];
+    const double worst = costNs.back();
+
+    printf("leds=%u frames=%u subpixels/frame=%u (1 table lookup each, plus a residue update in dim pixels)\n",
+           static_cast<unsigned>(leds), static_cast<unsigned>(frames), static_cast<unsigned>(wire.size()));
+    printf("frame cost: mean %.0f ns, p99 %.0f ns, worst %.0f ns\n", mean, p99, worst);
+    printf("share of a 100 Hz frame: mean %.3f%%, p99 %.3f%%\n", 100.0 * mean / FRAME_BUDGET_NS, 100.0 * p99 / FRAME_BUDGET_NS);
+    printf("(checksum %u)\n", static_cast<unsigned>(checksum));
+
+    const bool settles = staticSceneSettles(leds);
+    printf("static scene: %s\n", settles ? "identical frames" : "frames keep changing");
+    return settles ? 0 : 1;
+}
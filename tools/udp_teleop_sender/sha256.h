@@ -0,0 +1,115 @@
+#pragma once
+// SHA-256 and HMAC-SHA256 for the UDP teleop sender and its mbedtls shim,
+// so the tool builds with nothing but a compiler.
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace HostSha256
+{
+    inline uint32_t ror(uint32_t v, int n)
+    {
+        return (v >> n) | (v << (32 - n));
+    }
+
+    inline void sha256(const uint8_t *msg, size_t len, uint8_t out[32])
+    {
+        static const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+        uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+        std::string data(reinterpret_cast<const char *>(msg), len);
+        const uint64_t bits = static_cast<uint64_t>(len) * 8;
+        data.push_back(static_cast<char>(0x80));
+        while (data.size() % 64 != 56)
+            data.push_back('\0');
+        for (int i = 7; i >= 0; --i)
+            data.push_back(static_cast<char>((bits >> (i * 8)) & 0xFF));
+
+        for (size_t chunk = 0; chunk < data.size(); chunk += 64)
+        {
+            uint32_t w[64];
+            for (int i = 0; i < 16; ++i)
+            {
+                const uint8_t *p = reinterpret_cast<const uint8_t *>(data.data() + chunk + i * 4);
+                w[i] = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                       (static_cast<uint32_t>(p[2]) << 8) | p[3];
+            }
+            for (int i = 16; i < 64; ++i)
+            {
+                const uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                const uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+            for (int i = 0; i < 64; ++i)
+            {
+                const uint32_t s1 = ror(e, 6) ^ ror(e, 11) ^ ror(e, 25);
+                const uint32_t ch = (e & f) ^ (~e & g);
+                const uint32_t t1 = hh + s1 + ch + K[i] + w[i];
+                const uint32_t s0 = ror(a, 2) ^ ror(a, 13) ^ ror(a, 22);
+                const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+                const uint32_t t2 = s0 + maj;
+                hh = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+            h[5] += f;
+            h[6] += g;
+            h[7] += hh;
+        }
+
+        for (int i = 0; i < 8; ++i)
+        {
+            out[i * 4] = static_cast<uint8_t>(h[i] >> 24);
+            out[i * 4 + 1] = static_cast<uint8_t>(h[i] >> 16);
+            out[i * 4 + 2] = static_cast<uint8_t>(h[i] >> 8);
+            out[i * 4 + 3] = static_cast<uint8_t>(h[i]);
+        }
+    }
+
+    // RFC 2104 with a 64-byte block.
+    inline void hmac(const uint8_t *key, size_t keyLen, const uint8_t *msg, size_t len, uint8_t out[32])
+    {
+        uint8_t block[64] = {};
+        if (keyLen > sizeof(block))
+            sha256(key, keyLen, block);
+        else
+            memcpy(block, key, keyLen);
+
+        std::string inner(64, '\0');
+        std::string outer(64, '\0');
+        for (int i = 0; i < 64; ++i)
+        {
+            inner[i] = static_cast<char>(block[i] ^ 0x36);
+            outer[i] = static_cast<char>(block[i] ^ 0x5c);
+        }
+
+        inner.append(reinterpret_cast<const char *>(msg), len);
+        uint8_t innerDigest[32];
+        sha256(reinterpret_cast<const uint8_t *>(inner.data()), inner.size(), innerDigest);
+
+        outer.append(reinterpret_cast<const char *>(innerDigest), sizeof(innerDigest));
+        sha256(reinterpret_cast<const uint8_t *>(outer.data()), outer.size(), out);
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+// In-memory WiFiUDP: the self test queues datagrams in inbox() and reads
+// what the robot sent back from outbox().
+#include <Arduino.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+class WiFiUDP
+{
+public:
+    static std::deque<std::string> &inbox()
+    {
+        static std::deque<std::string> q;
+        return q;
+    }
+
+    static std::vector<std::string> &outbox()
+    {
+        static std::vector<std::string> v;
+        return v;
+    }
+
+    uint8_t begin(uint16_t)
+    {
+        return 1;
+    }
+
+    int parsePacket()
+    {
+        if (inbox().empty())
+            return 0;
+        current = inbox().front();
+        inbox().pop_front();
+        readPos = 0;
+        return static_cast<int>(current.size());
+    }
+
+    int read(uint8_t *buf, size_t len)
+    {
+        const size_t n = (current.size() - readPos < len) ? current.size() - readPos : len;
+        memcpy(buf, current.data() + readPos, n);
+        readPos += n;
+        return static_cast<int>(n);
+    }
+
+    IPAddress remoteIP() const
+    {
+        return IPAddress{};
+    }
+
+    uint16_t remotePort() const
+    {
+        return 0;
+    }
+
+    int beginPacket(IPAddress, uint16_t)
+    {
+        pending.clear();
+        return 1;
+    }
+
+    size_t write(const uint8_t *buf, size_t len)
+    {
+        pending.append(reinterpret_cast<const char *>(buf), len);
+        return len;
+    }
+
+    int endPacket()
+    {
+        outbox().push_back(pending);
+        return 1;
+    }
+
+private:
+    std::string current;
+    size_t readPos = 0;
+    std::string pending;
+};
@@ -0,0 +1,26 @@
+#pragma once
+// The one mbedtls call net/udp_teleop.cpp makes, on top of ../sha256.h.
+#include "../../sha256.h"
+
+typedef enum
+{
+    MBEDTLS_MD_SHA256 = 6,
+} mbedtls_md_type_t;
+
+struct mbedtls_md_info_t
+{
+    mbedtls_md_type_t type;
+};
+
+inline const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t type)
+{
+    static const mbedtls_md_info_t sha256{MBEDTLS_MD_SHA256};
+    return type == MBEDTLS_MD_SHA256 ? &sha256 : nullptr;
+}
+
+inline int mbedtls_md_hmac(const mbedtls_md_info_t *, const unsigned char *key, size_t keyLen,
+                           const unsigned char *input, size_t len, unsigned char *output)
+{
+    HostSha256::hmac(key, keyLen, input, len, output);
+    return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+// Self-test key; a real run passes the robot's key with --key.
+namespace Secrets
+{
+    static const char *UDP_TELEOP_KEY = "udp-teleop-selftest";
+}
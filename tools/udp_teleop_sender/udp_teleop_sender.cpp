@@ -0,0 +1,488 @@
+// Host-side sender for the UDP teleop channel (net/udp_teleop.h), signing
+// datagrams the same way the robot checks them. Two modes:
+//
+//   g++ -std=gnu++11 -O2 -Iinclude -Itools/host_shim -Itools/udp_teleop_sender/shim -o udp_teleop_sender tools/udp_teleop_sender/udp_teleop_sender.cpp src/net/udp_teleop.cpp src/net/metrics.cpp
+//
+//   ./udp_teleop_sender --selftest
+//       Runs the firmware's receiver (src/net/udp_teleop.cpp, on tools/host_shim
+//       and shim/) against datagrams built here: HMAC format, nonce handshake,
+//       newest-wins, stale/delayed rejection, loss and jitter statistics,
+//       session rotation. Exits non-zero on any failure.
+//
+//   ./udp_teleop_sender --host 192.168.1.50 --key KEY --hz 50 --throttle 0.3 --loss-pct 10 --jitter-ms 30
+//       Drives a real robot: asks for the session nonce, streams setpoints
+//       at --hz with simulated loss and jitter, follows nonce rotations and
+//       ends with STOP. The channel is off by default; build the firmware
+//       with AppConfig::UDP_TELEOP_ENABLED set. Compare its summary with the robot's
+//       robot_udp_teleop_packets_total, robot_udp_teleop_lost_total and
+//       robot_udp_teleop_jitter_ms.
+#include "net/udp_teleop.h"
+#include "secrets.h"
+#include "sha256.h"
+#include <WiFiUdp.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr uint16_t MAGIC = 0x5454;
+    constexpr uint8_t VERSION = 2;
+    constexpr uint8_t FLAG_STOP = 0x01;
+    constexpr uint8_t FLAG_NONCE = 0x02;
+    constexpr size_t SIGNED_BYTES = 20;
+    constexpr size_t NONCE_SIGNED_BYTES = 8;
+    constexpr size_t TAG_BYTES = 8;
+    constexpr uint32_t HELLO_RETRY_MS = 200;
+
+    struct Options
+    {
+        const char *host = nullptr;
+        uint16_t port = 8081;
+        const char *key = nullptr;
+        uint32_t hz = 50;
+        uint32_t durationSec = 10;
+        float throttle = 0.0f;
+        float steer = 0.0f;
+        uint32_t lossPct = 0;  // datagrams built but never sent
+        uint32_t jitterMs = 0; // uniform 0..N ms send delay, reorders too
+        uint32_t seed = 1;
+        bool selftest = false;
+    };
+
+    Options g_options;
+    std::chrono::steady_clock::time_point g_startTime;
+
+    uint32_t nowMs()
+    {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - g_startTime).count());
+    }
+
+    void writeU16(uint8_t *p, uint16_t v)
+    {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    void writeU32(uint8_t *p, uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            p[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    uint32_t readU32(const uint8_t *p)
+    {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    int16_t axis(float v)
+    {
+        v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+        return static_cast<int16_t>(std::lround(v * 32767.0f));
+    }
+
+    void tag(const std::string &key, const uint8_t *buf, size_t len, uint8_t *out)
+    {
+        uint8_t mac[32];
+        HostSha256::hmac(reinterpret_cast<const uint8_t *>(key.data()), key.size(), buf, len, mac);
+        memcpy(out, mac, TAG_BYTES);
+    }
+
+    std::string buildPacket(const std::string &key, uint32_t nonce, uint32_t seq, uint32_t ts,
+                            float throttle, float steer, bool stop)
+    {
+        uint8_t buf[UdpTeleop::PACKET_BYTES];
+        writeU16(buf, MAGIC);
+        buf[2] = VERSION;
+        buf[3] = stop ? FLAG_STOP : 0;
+        writeU32(buf + 4, nonce);
+        writeU32(buf + 8, seq);
+        writeU32(buf + 12, ts);
+        writeU16(buf + 16, static_cast<uint16_t>(axis(throttle)));
+        writeU16(buf + 18, static_cast<uint16_t>(axis(steer)));
+        tag(key, buf, SIGNED_BYTES, buf + SIGNED_BYTES);
+        return std::string(reinterpret_cast<const char *>(buf), sizeof(buf));
+    }
+
+    // False unless reply is a correctly signed NONCE datagram.
+    bool parseNonceReply(const std::string &key, const std::string &reply, uint32_t &nonce)
+    {
+        if (reply.size() != UdpTeleop::NONCE_REPLY_BYTES)
+            return false;
+
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(reply.data());
+        if ((p[0] | (p[1] << 8)) != MAGIC || p[2] != VERSION || p[3] != FLAG_NONCE)
+            return false;
+
+        uint8_t expected[TAG_BYTES];
+        tag(key, p, NONCE_SIGNED_BYTES, expected);
+        if (memcmp(expected, p + NONCE_SIGNED_BYTES, TAG_BYTES) != 0)
+            return false;
+
+        nonce = readU32(p + 4);
+        return nonce != 0;
+    }
+
+    // ---- self test against src/net/udp_teleop.cpp ----
+
+    struct Received
+    {
+        uint32_t drives = 0;
+        uint32_t stops = 0;
+        float throttle = 0.0f;
+        float steer = 0.0f;
+    };
+
+    Received g_received;
+    uint32_t g_failures = 0;
+
+    void expect(bool ok, const char *what)
+    {
+        std::printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+        if (!ok)
+            ++g_failures;
+    }
+
+    void deliver(const std::vector<std::string> &datagrams)
+    {
+        for (const std::string &d : datagrams)
+            WiFiUDP::inbox().push_back(d);
+        UdpTeleop::poll();
+    }
+
+    void advance(uint32_t ms)
+    {
+        HostShim::nowMs() += ms;
+    }
+
+    bool lastReply(const std::string &key, uint32_t &nonce)
+    {
+        return !WiFiUDP::outbox().empty() && parseNonceReply(key, WiFiUDP::outbox().back(), nonce);
+    }
+
+    int runSelftest()
+    {
+        // RFC 4231 test case 2.
+        {
+            const char key[] = "Jefe";
+            const char data[] = "what do ya want for nothing?";
+            const uint8_t expected[32] = {0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24,
+                                          0x26, 0x08, 0x95, 0x75, 0xc7, 0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27,
+                                          0x39, 0x83, 0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43};
+            uint8_t mac[32];
+            HostSha256::hmac(reinterpret_cast<const uint8_t *>(key), strlen(key),
+                             reinterpret_cast<const uint8_t *>(data), strlen(data), mac);
+            expect(memcmp(mac, expected, sizeof(mac)) == 0, "HMAC-SHA256 matches RFC 4231 case 2");
+        }
+
+        const std::string key = Secrets::UDP_TELEOP_KEY;
+        HostShim::nowMs() = 1000;
+
+        UdpTeleop::Handlers handlers;
+        handlers.onDrive = [](float throttle, float steer, uint32_t)
+        {
+            ++g_received.drives;
+            g_received.throttle = throttle;
+            g_received.steer = steer;
+        };
+        handlers.onStop = []()
+        { ++g_received.stops; };
+        expect(UdpTeleop::begin(8081, handlers), "begin");
+
+        // Handshake.
+        deliver({buildPacket(key, 0, 0, 0, 0, 0, true)});
+        uint32_t nonce = 0;
+        expect(UdpTeleop::stats().wrongNonce == 1 && lastReply(key, nonce), "nonce 0 gets a signed NONCE reply");
+        expect(g_received.drives == 0 && g_received.stops == 0, "nothing applied before the handshake");
+
+        deliver({buildPacket(key, 0, 0, 0, 0, 0, true)});
+        expect(UdpTeleop::stats().wrongNonce == 2 && WiFiUDP::outbox().size() == 1, "NONCE replies are rate limited");
+        advance(100);
+
+        // Format errors.
+        std::string wrongKey = buildPacket("not-the-key", nonce, 1, 0, 0.5f, 0, false);
+        deliver({wrongKey});
+        expect(UdpTeleop::stats().authFailed == 1, "tag under another key fails auth");
+        std::string flipped = buildPacket(key, nonce, 1, 0, 0.5f, 0, false);
+        flipped[17] ^= 0x01;
+        deliver({flipped});
+        expect(UdpTeleop::stats().authFailed == 2, "any signed byte changed fails auth");
+        deliver({buildPacket(key, nonce, 1, 0, 0.5f, 0, false).substr(0, UdpTeleop::PACKET_BYTES - 1)});
+        expect(UdpTeleop::stats().malformed == 1, "short datagram is malformed");
+        expect(g_received.drives == 0, "rejected datagrams are not applied");
+
+        // Sender clock runs 5000 ms behind the robot; only differences matter.
+        const uint32_t skew = 5000;
+        auto ts = [&]()
+        { return HostShim::nowMs() - skew; };
+
+        deliver({buildPacket(key, nonce, 1, ts(), 0.5f, -0.25f, false)});
+        expect(UdpTeleop::stats().accepted == 1 && g_received.drives == 1, "first datagram of the session applied");
+        expect(std::fabs(g_received.throttle - 0.5f) < 1e-3f && std::fabs(g_received.steer + 0.25f) < 1e-3f, "axes decode");
+
+        advance(20);
+        deliver({buildPacket(key, nonce, 2, ts(), 0.2f, 0, false),
+                 buildPacket(key, nonce, 4, ts(), 0.4f, 0, false),
+                 buildPacket(key, nonce, 3, ts(), 0.3f, 0, false)});
+        UdpTeleop::Stats s = UdpTeleop::stats();
+        expect(s.accepted == 2 && g_received.drives == 2 && std::fabs(g_received.throttle - 0.4f) < 1e-3f,
+               "newest of one poll wins");
+        expect(s.superseded == 1 && s.stale == 1 && s.lastSeq == 4, "older in the same poll: superseded or stale");
+
+        advance(20);
+        const std::string seq4 = buildPacket(key, nonce, 4, ts(), 0.4f, 0, false);
+        deliver({seq4});
+        expect(UdpTeleop::stats().stale == 2 && g_received.drives == 2, "duplicate seq is stale");
+
+        advance(20);
+        const std::string seq10 = buildPacket(key, nonce, 10, ts(), 0.1f, 0, false);
+        deliver({seq10});
+        // 3 counted lost when 4 overtook it, then 5..9.
+        expect(UdpTeleop::stats().lost == 6 && g_received.drives == 3, "seq gaps counted as lost");
+
+        // Transit alternating by 20 ms: RFC 3550 jitter converges on 20.
+        uint32_t seq = 11;
+        for (int i = 0; i < 96; ++i, ++seq)
+        {
+            advance(20);
+            deliver({buildPacket(key, nonce, seq, ts() - ((i & 1) ? 20 : 0), 0.1f, 0, false)});
+        }
+        s = UdpTeleop::stats();
+        std::printf("     jitter %.2f ms\n", static_cast<double>(s.jitterMs));
+        expect(s.jitterMs > 18.0f && s.jitterMs <= 20.0f, "jitter estimate tracks 20 ms transit swings");
+
+        advance(20);
+        deliver({buildPacket(key, nonce, seq++, ts() - 600, 0.9f, 0, false)});
+        expect(UdpTeleop::stats().delayed == 1 && std::fabs(g_received.throttle - 0.1f) < 1e-3f,
+               "datagram 600 ms late is delayed, not applied");
+
+        advance(20);
+        deliver({buildPacket(key, nonce, seq++, ts(), 0, 0, true)});
+        expect(g_received.stops == 1, "stop flag");
+
+        // Session lapse: everything from the old session is worthless.
+        advance(2001);
+        const uint32_t wrongBefore = UdpTeleop::stats().wrongNonce;
+        deliver({seq10});
+        uint32_t next = 0;
+        expect(UdpTeleop::stats().wrongNonce == wrongBefore + 1 && lastReply(key, next) && next != nonce,
+               "after a lapse the old nonce is refused and a new one announced");
+        deliver({buildPacket(key, nonce, seq++, ts(), 0.7f, 0, false)});
+        expect(std::fabs(g_received.throttle - 0.7f) > 1e-3f, "fresh seq under the old nonce is refused");
+        nonce = next;
+
+        advance(100);
+        const uint32_t drivesBefore = g_received.drives;
+        deliver({buildPacket(key, nonce, 1, ts(), 0.6f, 0, false)});
+        expect(g_received.drives == drivesBefore + 1 && std::fabs(g_received.throttle - 0.6f) < 1e-3f,
+               "new session starts from any seq");
+
+        // Top of the seq range ends the session.
+        advance(20);
+        deliver({buildPacket(key, nonce, UINT32_MAX, ts(), 0.5f, 0, false)});
+        expect(g_received.drives == drivesBefore + 2, "seq UINT32_MAX accepted");
+        advance(100);
+        deliver({buildPacket(key, nonce, 2, ts(), 0.3f, 0, false)});
+        expect(lastReply(key, next) && next != nonce && g_received.drives == drivesBefore + 2,
+               "no wraparound: the next datagram needs a new nonce");
+
+        std::printf("%s (%u failure%s)\n", g_failures ? "FAILED" : "PASSED",
+                    static_cast<unsigned>(g_failures), g_failures == 1 ? "" : "s");
+        return g_failures ? 1 : 0;
+    }
+
+    // ---- real sender ----
+
+    struct Scheduled
+    {
+        uint32_t atMs;
+        std::string bytes;
+    };
+
+    int runSender()
+    {
+        const std::string key = g_options.key;
+        const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(g_options.port);
+        if (fd < 0 || inet_pton(AF_INET, g_options.host, &addr.sin_addr) != 1 ||
+            ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+        {
+            std::perror("socket");
+            return 1;
+        }
+
+        std::mt19937 rng(g_options.seed);
+        auto roll = [&](uint32_t n) -> uint32_t
+        { return n ? std::uniform_int_distribution<uint32_t>(0, n - 1)(rng) : 0; };
+
+        uint32_t nonce = 0;
+        uint32_t seq = 1;
+        uint32_t nonces = 0, badReplies = 0, built = 0, dropped = 0, sent = 0;
+        uint32_t lastHelloMs = 0;
+        bool helloSent = false;
+        std::vector<Scheduled> pending;
+
+        const uint32_t periodMs = 1000 / g_options.hz;
+        const uint32_t endMs = g_options.durationSec * 1000;
+        uint32_t nextMs = 0;
+
+        while (nowMs() < endMs)
+        {
+            const uint32_t now = nowMs();
+
+            uint8_t in[64];
+            ssize_t n;
+            while ((n = ::recv(fd, in, sizeof(in), MSG_DONTWAIT)) > 0)
+            {
+                uint32_t announced = 0;
+                if (!parseNonceReply(key, std::string(reinterpret_cast<char *>(in), static_cast<size_t>(n)), announced))
+                {
+                    ++badReplies;
+                    continue;
+                }
+                if (announced != nonce)
+                {
+                    std::printf("%7.3f nonce %08x\n", now / 1000.0, static_cast<unsigned>(announced));
+                    nonce = announced;
+                    seq = 1;
+                    ++nonces;
+                    pending.clear(); // signed for the old session
+                }
+            }
+
+            if (nonce == 0)
+            {
+                if (!helloSent || now - lastHelloMs >= HELLO_RETRY_MS)
+                {
+                    const std::string hello = buildPacket(key, 0, 0, now, 0, 0, true);
+                    ::send(fd, hello.data(), hello.size(), 0);
+                    helloSent = true;
+                    lastHelloMs = now;
+                }
+            }
+            else if (now >= nextMs)
+            {
+                nextMs = now + periodMs;
+                ++built;
+                const std::string d = buildPacket(key, nonce, seq++, now, g_options.throttle, g_options.steer, false);
+                if (roll(100) < g_options.lossPct)
+                    ++dropped;
+                else
+                    pending.push_back(Scheduled{now + roll(g_options.jitterMs + 1), d});
+            }
+
+            for (size_t i = 0; i < pending.size();)
+            {
+                if (pending[i].atMs > now)
+                {
+                    ++i;
+                    continue;
+                }
+                ::send(fd, pending[i].bytes.data(), pending[i].bytes.size(), 0);
+                ++sent;
+                pending.erase(pending.begin() + static_cast<long>(i));
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        if (nonce != 0)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                const std::string stop = buildPacket(key, nonce, seq++, nowMs(), 0, 0, true);
+                ::send(fd, stop.data(), stop.size(), 0);
+            }
+        }
+        ::close(fd);
+
+        std::printf("final built=%u sent=%u dropped=%u (expect robot lost ~%u) nonces=%u bad_replies=%u\n",
+                    static_cast<unsigned>(built), static_cast<unsigned>(sent), static_cast<unsigned>(dropped),
+                    static_cast<unsigned>(dropped), static_cast<unsigned>(nonces), static_cast<unsigned>(badReplies));
+        return nonce != 0 ? 0 : 1;
+    }
+
+    void usage(const char *argv0)
+    {
+        std::printf("usage: %s --selftest\n"
+                    "       %s --host IP --key KEY [options]\n"
+                    "  --port N            robot UDP port (8081)\n"
+                    "  --hz N              datagrams per second (50)\n"
+                    "  --duration N        seconds before STOP (10)\n"
+                    "  --throttle X        -1..1 (0)\n"
+                    "  --steer X           -1..1 (0)\n"
+                    "  --loss-pct N        build N%% of datagrams but never send them\n"
+                    "  --jitter-ms N       delay each send by a uniform 0..N ms\n"
+                    "  --seed N            loss/jitter RNG seed (1)\n",
+                    argv0, argv0);
+    }
+
+    bool parseOptions(int argc, char **argv)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            auto number = [&]() -> uint32_t
+            { return static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); };
+
+            if (arg == "--selftest")
+                g_options.selftest = true;
+            else if (!hasValue)
+                return false;
+            else if (arg == "--host")
+                g_options.host = argv[++i];
+            else if (arg == "--key")
+                g_options.key = argv[++i];
+            else if (arg == "--port")
+                g_options.port = static_cast<uint16_t>(number());
+            else if (arg == "--hz")
+                g_options.hz = number();
+            else if (arg == "--duration")
+                g_options.durationSec = number();
+            else if (arg == "--throttle")
+                g_options.throttle = std::strtof(argv[++i], nullptr);
+            else if (arg == "--steer")
+                g_options.steer = std::strtof(argv[++i], nullptr);
+            else if (arg == "--loss-pct")
+                g_options.lossPct = number();
+            else if (arg == "--jitter-ms")
+                g_options.jitterMs = number();
+            else if (arg == "--seed")
+                g_options.seed = number();
+            else
+                return false;
+        }
+        if (g_options.selftest)
+            return true;
+        return g_options.host && g_options.key && g_options.hz > 0 && g_options.hz <= 1000;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (!parseOptions(argc, argv))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    g_startTime = std::chrono::steady_clock::now();
+    return g_options.selftest ? runSelftest() : runSender();
+}